@@ -0,0 +1,148 @@
+#include "address-plan.h"
+#include "tree-routing.h"
+
+#include "ns3/log.h"
+#include "ns3/fatal-error.h"
+
+NS_LOG_COMPONENT_DEFINE ("AddressPlan");
+
+namespace ns3 {
+
+static const char *tierNames[AddressPlan::N_TIERS] = { "tree", "gateway", "backbone", "server" };
+
+AddressPlan::AddressPlan ()
+    : m_tree (0),
+      m_segmentLength (32)
+{
+    m_pool[TREE] = Ipv4Prefix::FromString("10.0.0.0/8");
+    m_pool[GATEWAY] = Ipv4Prefix::FromString("172.16.0.0/12");
+    m_pool[BACKBONE] = Ipv4Prefix::FromString("100.64.0.0/10");
+    m_pool[SERVER] = Ipv4Prefix::FromString("194.80.39.0/24");
+    for (int i = 0; i < N_TIERS; i++) {
+        m_next[i] = 0;
+    }
+}
+
+void
+AddressPlan::SetPool (Tier tier, Ipv4Prefix pool)
+{
+    if (m_next[tier] != 0) {
+        NS_FATAL_ERROR ("Cannot change the " << tierNames[tier] << " pool after allocating from it");
+    }
+    m_pool[tier] = pool;
+}
+
+Ipv4Prefix
+AddressPlan::GetPool (Tier tier) const
+{
+    return m_pool[tier];
+}
+
+Ipv4Prefix
+AddressPlan::Allocate (Tier tier, uint8_t length)
+{
+    const Ipv4Prefix &pool = m_pool[tier];
+    if (length < pool.length || length > 32) {
+        NS_FATAL_ERROR ("Cannot allocate a /" << (uint32_t)length << " from the "
+                        << tierNames[tier] << " pool " << pool.ToString());
+    }
+
+    uint64_t size = (uint64_t)1 << (32 - length);
+    uint64_t offset = (m_next[tier] + size - 1) & ~(size - 1);
+    if (offset + size > ((uint64_t)1 << (32 - pool.length))) {
+        NS_FATAL_ERROR ("The " << tierNames[tier] << " pool " << pool.ToString()
+                        << " has no room left for a /" << (uint32_t)length);
+    }
+    m_next[tier] = offset + size;
+
+    return Ipv4Prefix (pool.network + (uint32_t)offset, length);
+}
+
+void
+AddressPlan::AssignTree (const TreeTopology &tree)
+{
+    m_tree = &tree;
+    m_segmentIndex.assign(tree.GetN(), TreeRouting::NO_SEGMENT);
+
+    /* network, the node itself, up to stride children and broadcast */
+    uint32_t hostBits = 2;
+    while (((uint64_t)1 << hostBits) < (uint64_t)tree.GetStride() + 3) {
+        hostBits++;
+    }
+    m_segmentLength = 32 - hostBits;
+
+    uint32_t nSegments = 0;
+    for (uint32_t pos = 0; pos < tree.GetN(); pos++) {
+        uint32_t node = tree.GetNodeAtPreorder(pos);
+        if (!tree.IsLeaf(node)) {
+            m_segmentIndex[node] = nSegments++;
+        }
+    }
+
+    uint32_t blockBits = hostBits;
+    while (((uint64_t)1 << (blockBits - hostBits)) < nSegments) {
+        blockBits++;
+    }
+    if (blockBits > 32) {
+        NS_FATAL_ERROR ("Tree of " << tree.GetN() << " nodes does not fit in IPv4");
+    }
+    m_treePrefix = Allocate(TREE, 32 - blockBits);
+
+    NS_LOG_DEBUG (nSegments << " tree segments of /" << (uint32_t)m_segmentLength
+                  << " in " << m_treePrefix.ToString());
+}
+
+Ipv4Prefix
+AddressPlan::GetTreePrefix (void) const
+{
+    return m_treePrefix;
+}
+
+uint8_t
+AddressPlan::GetSegmentLength (void) const
+{
+    return m_segmentLength;
+}
+
+const std::vector<uint32_t> &
+AddressPlan::GetSegmentIndices (void) const
+{
+    return m_segmentIndex;
+}
+
+bool
+AddressPlan::HasSegment (uint32_t node) const
+{
+    return m_segmentIndex[node] != TreeRouting::NO_SEGMENT;
+}
+
+Ipv4Prefix
+AddressPlan::GetSegment (uint32_t node) const
+{
+    if (!HasSegment(node)) {
+        NS_FATAL_ERROR ("Tree node " << node << " has no children and so no segment");
+    }
+    return Ipv4Prefix (m_treePrefix.network + (m_segmentIndex[node] << (32 - m_segmentLength)),
+                       m_segmentLength);
+}
+
+uint32_t
+AddressPlan::GetSegmentHost (void) const
+{
+    return 1;
+}
+
+uint32_t
+AddressPlan::GetUplinkHost (uint32_t node) const
+{
+    int32_t parent = m_tree->GetParent(node);
+    return node - m_tree->GetFirstChild(parent) + 2;
+}
+
+uint32_t
+AddressPlan::GetUplinkAddress (uint32_t node) const
+{
+    return GetSegment(m_tree->GetParent(node)).GetHost(GetUplinkHost(node));
+}
+
+}
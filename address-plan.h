@@ -0,0 +1,79 @@
+#ifndef ADDRESS_PLAN_H
+#define ADDRESS_PLAN_H
+
+#include "ipv4-prefix.h"
+#include "tree-topology.h"
+
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * Hands out non-overlapping subnets from one prefix pool per tier of a
+ * scenario, and lays out the tree segments so they scale to tens of
+ * thousands of nodes.
+ *
+ * Default pools:
+ *   TREE      10.0.0.0/8      one segment per node that has children
+ *   GATEWAY   172.16.0.0/12   /30 per tree node <-> gateway router link
+ *   BACKBONE  100.64.0.0/10   /30 per router <-> server gateway link
+ *   SERVER    194.80.39.0/24  server LANs
+ *
+ * Allocation is a bump allocator per pool; running out of a pool is a
+ * fatal error instead of silently wrapping an octet.
+ */
+class AddressPlan
+{
+public:
+    enum Tier {
+        TREE = 0,
+        GATEWAY,
+        BACKBONE,
+        SERVER,
+        N_TIERS
+    };
+
+    AddressPlan ();
+
+    void SetPool (Tier tier, Ipv4Prefix pool);
+    Ipv4Prefix GetPool (Tier tier) const;
+
+    /* Next free, aligned subnet of the given length from tier's pool. */
+    Ipv4Prefix Allocate (Tier tier, uint8_t length);
+
+    /**
+    * Give every node of tree that has children a segment sized for the
+    * node itself (host 1) plus its children (hosts 2..stride+1).
+    * Segments are handed out in preorder, so the segments of any subtree
+    * are contiguous and summarise to very few prefixes.
+    */
+    void AssignTree (const TreeTopology &tree);
+
+    /* Block holding every tree segment, e.g. for a single route to the whole tree. */
+    Ipv4Prefix GetTreePrefix (void) const;
+    uint8_t GetSegmentLength (void) const;
+    /* Pool indices for TreeRouting; TreeRouting::NO_SEGMENT for leaves. */
+    const std::vector<uint32_t> &GetSegmentIndices (void) const;
+
+    bool HasSegment (uint32_t node) const;
+    /* Segment shared by node and its children. */
+    Ipv4Prefix GetSegment (uint32_t node) const;
+    /* Host number of node on its own segment, and on its parent's. */
+    uint32_t GetSegmentHost (void) const;
+    uint32_t GetUplinkHost (uint32_t node) const;
+    /* Node's address on its parent's segment. */
+    uint32_t GetUplinkAddress (uint32_t node) const;
+
+private:
+    Ipv4Prefix m_pool[N_TIERS];
+    uint64_t m_next[N_TIERS];
+
+    const TreeTopology *m_tree;
+    Ipv4Prefix m_treePrefix;
+    uint8_t m_segmentLength;
+    std::vector<uint32_t> m_segmentIndex;
+};
+
+}
+
+#endif /* ADDRESS_PLAN_H */
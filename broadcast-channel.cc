@@ -0,0 +1,397 @@
+#include "broadcast-channel.h"
+
+#include "ns3/log.h"
+#include "ns3/fatal-error.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+#include "ns3/pointer.h"
+#include "ns3/trace-source-accessor.h"
+#include "ns3/ethernet-header.h"
+
+NS_LOG_COMPONENT_DEFINE ("BroadcastChannel");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (BroadcastChannel);
+NS_OBJECT_ENSURE_REGISTERED (BroadcastNetDevice);
+
+TypeId
+BroadcastChannel::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::BroadcastChannel")
+        .SetParent<Channel> ()
+        .AddConstructor<BroadcastChannel> ()
+        .AddAttribute ("DataRate",
+                       "Rate frames are sent at.",
+                       DataRateValue (DataRate ("10Mbps")),
+                       MakeDataRateAccessor (&BroadcastChannel::m_rate),
+                       MakeDataRateChecker ())
+        .AddAttribute ("Delay",
+                       "Propagation delay from a sender to every receiver.",
+                       TimeValue (Seconds (0)),
+                       MakeTimeAccessor (&BroadcastChannel::m_delay),
+                       MakeTimeChecker ())
+        ;
+    return tid;
+}
+
+BroadcastChannel::BroadcastChannel ()
+    : m_busyUntil (Seconds (0)),
+      m_nFrames (0),
+      m_nDeliveries (0)
+{
+}
+
+void
+BroadcastChannel::Attach (Ptr<BroadcastNetDevice> device)
+{
+    m_devices.push_back(device);
+}
+
+void
+BroadcastChannel::Transmit (Ptr<const Packet> frame, Ptr<BroadcastNetDevice> sender)
+{
+    if (IsBusy()) {
+        NS_FATAL_ERROR ("BroadcastChannel: transmit while another frame is on the channel");
+    }
+    Time txTime = m_rate.CalculateBytesTxTime(frame->GetSize());
+    m_busyUntil = Simulator::Now() + txTime;
+    /* In the receiving node's context, as the stack above the device expects */
+    for (std::vector<Ptr<BroadcastNetDevice> >::const_iterator it = m_devices.begin(); it != m_devices.end(); ++it) {
+        if (*it != sender) {
+            Simulator::ScheduleWithContext((*it)->GetNode()->GetId(), txTime + m_delay,
+                                           &BroadcastNetDevice::Receive, *it, frame);
+            m_nDeliveries++;
+        }
+    }
+    m_nFrames++;
+}
+
+bool
+BroadcastChannel::IsBusy (void) const
+{
+    return Simulator::Now() < m_busyUntil;
+}
+
+Time
+BroadcastChannel::GetBusyUntil (void) const
+{
+    return m_busyUntil;
+}
+
+uint32_t
+BroadcastChannel::GetNDevices (void) const
+{
+    return m_devices.size();
+}
+
+Ptr<NetDevice>
+BroadcastChannel::GetDevice (uint32_t i) const
+{
+    return m_devices[i];
+}
+
+uint64_t
+BroadcastChannel::GetNFrames (void) const
+{
+    return m_nFrames;
+}
+
+uint64_t
+BroadcastChannel::GetNDeliveries (void) const
+{
+    return m_nDeliveries;
+}
+
+TypeId
+BroadcastNetDevice::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::BroadcastNetDevice")
+        .SetParent<NetDevice> ()
+        .AddConstructor<BroadcastNetDevice> ()
+        .AddAttribute ("Mtu", "The MAC-level Maximum Transmission Unit.",
+                       UintegerValue (1500),
+                       MakeUintegerAccessor (&BroadcastNetDevice::SetMtu,
+                                             &BroadcastNetDevice::GetMtu),
+                       MakeUintegerChecker<uint16_t> ())
+        .AddAttribute ("MaxQueue", "Frames queued while the device is sending, beyond which they are dropped.",
+                       UintegerValue (100),
+                       MakeUintegerAccessor (&BroadcastNetDevice::m_maxQueue),
+                       MakeUintegerChecker<uint32_t> ())
+        .AddTraceSource ("MacTx", "A packet from above, before it is framed.",
+                         MakeTraceSourceAccessor (&BroadcastNetDevice::m_macTxTrace))
+        .AddTraceSource ("MacTxDrop", "A frame dropped because the queue was full.",
+                         MakeTraceSourceAccessor (&BroadcastNetDevice::m_macTxDropTrace))
+        .AddTraceSource ("MacRx", "A frame for this device, before it goes up.",
+                         MakeTraceSourceAccessor (&BroadcastNetDevice::m_macRxTrace))
+        .AddTraceSource ("MacPromiscRx", "Any frame, before it goes up promiscuously.",
+                         MakeTraceSourceAccessor (&BroadcastNetDevice::m_macPromiscRxTrace))
+        .AddTraceSource ("PhyTxBegin", "A frame put on the channel.",
+                         MakeTraceSourceAccessor (&BroadcastNetDevice::m_phyTxBeginTrace))
+        .AddTraceSource ("PhyRxEnd", "A frame taken off the channel.",
+                         MakeTraceSourceAccessor (&BroadcastNetDevice::m_phyRxEndTrace))
+        .AddTraceSource ("Sniffer", "Frames sent and frames for this device, for pcaps.",
+                         MakeTraceSourceAccessor (&BroadcastNetDevice::m_snifferTrace))
+        .AddTraceSource ("PromiscSniffer", "Every frame sent or seen, for pcaps.",
+                         MakeTraceSourceAccessor (&BroadcastNetDevice::m_promiscSnifferTrace))
+        ;
+    return tid;
+}
+
+BroadcastNetDevice::BroadcastNetDevice ()
+    : m_ifIndex (0),
+      m_mtu (1500),
+      m_maxQueue (100)
+{
+}
+
+void
+BroadcastNetDevice::Attach (Ptr<BroadcastChannel> channel)
+{
+    m_channel = channel;
+    channel->Attach(this);
+    m_linkChangeCallbacks();
+}
+
+bool
+BroadcastNetDevice::Send (Ptr<Packet> packet, const Address &dest, uint16_t protocolNumber)
+{
+    return SendFrom(packet, m_address, dest, protocolNumber);
+}
+
+bool
+BroadcastNetDevice::SendFrom (Ptr<Packet> packet, const Address &source, const Address &dest,
+                              uint16_t protocolNumber)
+{
+    m_macTxTrace(packet);
+
+    EthernetHeader header (false);
+    header.SetSource(Mac48Address::ConvertFrom(source));
+    header.SetDestination(Mac48Address::ConvertFrom(dest));
+    header.SetLengthType(protocolNumber);
+    packet->AddHeader(header);
+
+    if (m_queue.empty() && !m_channel->IsBusy()) {
+        TransmitStart(packet);
+        return true;
+    }
+    if (m_queue.size() >= m_maxQueue) {
+        m_macTxDropTrace(packet);
+        return false;
+    }
+    m_queue.push_back(packet);
+    if (!m_next.IsRunning()) {
+        ScheduleNext();
+    }
+    return true;
+}
+
+void
+BroadcastNetDevice::TransmitStart (Ptr<Packet> frame)
+{
+    m_phyTxBeginTrace(frame);
+    m_snifferTrace(frame);
+    m_promiscSnifferTrace(frame);
+    m_channel->Transmit(frame, this);
+}
+
+void
+BroadcastNetDevice::TransmitNext (void)
+{
+    /* Another device may have taken the channel as it went idle; wait for that frame too. */
+    if (!m_channel->IsBusy()) {
+        Ptr<Packet> frame = m_queue.front();
+        m_queue.pop_front();
+        TransmitStart(frame);
+    }
+    if (!m_queue.empty()) {
+        ScheduleNext();
+    }
+}
+
+void
+BroadcastNetDevice::ScheduleNext (void)
+{
+    m_next = Simulator::Schedule(m_channel->GetBusyUntil() - Simulator::Now(), &BroadcastNetDevice::TransmitNext, this);
+}
+
+void
+BroadcastNetDevice::Receive (Ptr<const Packet> frame)
+{
+    m_phyRxEndTrace(frame);
+
+    Ptr<Packet> packet = frame->Copy();
+    EthernetHeader header (false);
+    packet->RemoveHeader(header);
+
+    Mac48Address dest = header.GetDestination();
+    PacketType type;
+    if (dest.IsBroadcast()) {
+        type = PACKET_BROADCAST;
+    } else if (dest.IsGroup()) {
+        type = PACKET_MULTICAST;
+    } else if (dest == m_address) {
+        type = PACKET_HOST;
+    } else {
+        type = PACKET_OTHERHOST;
+    }
+
+    /* As CsmaNetDevice: everything to the promiscuous side, only our frames up the stack */
+    m_promiscSnifferTrace(frame);
+    if (!m_promiscRxCallback.IsNull()) {
+        m_macPromiscRxTrace(frame);
+        m_promiscRxCallback(this, packet, header.GetLengthType(), header.GetSource(), dest, type);
+    }
+    if (type != PACKET_OTHERHOST) {
+        m_snifferTrace(frame);
+        m_macRxTrace(frame);
+        m_rxCallback(this, packet, header.GetLengthType(), header.GetSource());
+    }
+}
+
+void
+BroadcastNetDevice::DoDispose (void)
+{
+    m_next.Cancel();
+    m_queue.clear();
+    m_node = 0;
+    m_channel = 0;
+    m_rxCallback.Nullify();
+    m_promiscRxCallback.Nullify();
+    NetDevice::DoDispose();
+}
+
+void
+BroadcastNetDevice::SetIfIndex (const uint32_t index)
+{
+    m_ifIndex = index;
+}
+
+uint32_t
+BroadcastNetDevice::GetIfIndex (void) const
+{
+    return m_ifIndex;
+}
+
+Ptr<Channel>
+BroadcastNetDevice::GetChannel (void) const
+{
+    return m_channel;
+}
+
+void
+BroadcastNetDevice::SetAddress (Address address)
+{
+    m_address = Mac48Address::ConvertFrom(address);
+}
+
+Address
+BroadcastNetDevice::GetAddress (void) const
+{
+    return m_address;
+}
+
+bool
+BroadcastNetDevice::SetMtu (const uint16_t mtu)
+{
+    m_mtu = mtu;
+    return true;
+}
+
+uint16_t
+BroadcastNetDevice::GetMtu (void) const
+{
+    return m_mtu;
+}
+
+bool
+BroadcastNetDevice::IsLinkUp (void) const
+{
+    return m_channel != 0;
+}
+
+void
+BroadcastNetDevice::AddLinkChangeCallback (Callback<void> callback)
+{
+    m_linkChangeCallbacks.ConnectWithoutContext(callback);
+}
+
+bool
+BroadcastNetDevice::IsBroadcast (void) const
+{
+    return true;
+}
+
+Address
+BroadcastNetDevice::GetBroadcast (void) const
+{
+    return Mac48Address::GetBroadcast();
+}
+
+bool
+BroadcastNetDevice::IsMulticast (void) const
+{
+    return true;
+}
+
+Address
+BroadcastNetDevice::GetMulticast (Ipv4Address multicastGroup) const
+{
+    return Mac48Address::GetMulticast(multicastGroup);
+}
+
+Address
+BroadcastNetDevice::GetMulticast (Ipv6Address addr) const
+{
+    return Mac48Address::GetMulticast(addr);
+}
+
+bool
+BroadcastNetDevice::IsBridge (void) const
+{
+    return false;
+}
+
+bool
+BroadcastNetDevice::IsPointToPoint (void) const
+{
+    return false;
+}
+
+Ptr<Node>
+BroadcastNetDevice::GetNode (void) const
+{
+    return m_node;
+}
+
+void
+BroadcastNetDevice::SetNode (Ptr<Node> node)
+{
+    m_node = node;
+}
+
+bool
+BroadcastNetDevice::NeedsArp (void) const
+{
+    return true;
+}
+
+void
+BroadcastNetDevice::SetReceiveCallback (NetDevice::ReceiveCallback cb)
+{
+    m_rxCallback = cb;
+}
+
+void
+BroadcastNetDevice::SetPromiscReceiveCallback (NetDevice::PromiscReceiveCallback cb)
+{
+    m_promiscRxCallback = cb;
+}
+
+bool
+BroadcastNetDevice::SupportsSendFrom (void) const
+{
+    return true;
+}
+
+}
@@ -0,0 +1,151 @@
+#ifndef BROADCAST_CHANNEL_H
+#define BROADCAST_CHANNEL_H
+
+#include "ns3/channel.h"
+#include "ns3/net-device.h"
+#include "ns3/node.h"
+#include "ns3/packet.h"
+#include "ns3/address.h"
+#include "ns3/mac48-address.h"
+#include "ns3/nstime.h"
+#include "ns3/data-rate.h"
+#include "ns3/event-id.h"
+#include "ns3/traced-callback.h"
+
+#include <deque>
+#include <vector>
+
+namespace ns3 {
+
+class BroadcastNetDevice;
+
+/**
+ * A shared segment without collisions, in place of a CsmaChannel where
+ * medium access is not what is being studied.
+ *
+ * A frame takes its transmission time at "DataRate" plus "Delay" to
+ * arrive. The medium is shared: it carries one frame at a time, so all
+ * devices together send at most "DataRate". A device that finds it busy
+ * waits for it to go idle, with no collisions, backoff or transmit state
+ * machine as CSMA has.
+ *
+ * Delivery still costs one event per receiver, as on CSMA: the stack
+ * above a device expects to run in its own node's context
+ * (Node::ReceiveFromDevice checks it), so each receiver gets its own
+ * ScheduleWithContext. The saving over CSMA is on the sender's side: at
+ * most one event to send a frame from the queue, where CSMA schedules
+ * its transmit complete and ready events and any backoff.
+ */
+class BroadcastChannel : public Channel
+{
+public:
+    static TypeId GetTypeId (void);
+
+    BroadcastChannel ();
+
+    void Attach (Ptr<BroadcastNetDevice> device);
+
+    /* Send frame, with its Ethernet header, to every device but sender; the channel must be idle. */
+    void Transmit (Ptr<const Packet> frame, Ptr<BroadcastNetDevice> sender);
+    bool IsBusy (void) const;
+    /* End of the frame being sent, or the last one sent if idle. */
+    Time GetBusyUntil (void) const;
+
+    virtual uint32_t GetNDevices (void) const;
+    virtual Ptr<NetDevice> GetDevice (uint32_t i) const;
+
+    /* Frames sent, and the deliveries they made. */
+    uint64_t GetNFrames (void) const;
+    uint64_t GetNDeliveries (void) const;
+
+private:
+    std::vector<Ptr<BroadcastNetDevice> > m_devices;
+    DataRate m_rate;
+    Time m_delay;
+    Time m_busyUntil;
+    uint64_t m_nFrames;
+    uint64_t m_nDeliveries;
+};
+
+/**
+ * Ethernet device of a BroadcastChannel. Frames carry the same Ethernet
+ * header as CsmaNetDevice's (no trailer), and the device has the trace
+ * sources pcaps, FlowStats and RingPcap use on CSMA devices.
+ *
+ * A frame is sent at once when the channel is idle and queued otherwise,
+ * up to "MaxQueue" frames; the queue is drained by one event per frame
+ * sent from it, or per time the channel was taken by another device
+ * first, so an idle device costs nothing but the deliveries.
+ */
+class BroadcastNetDevice : public NetDevice
+{
+public:
+    static TypeId GetTypeId (void);
+
+    BroadcastNetDevice ();
+
+    void Attach (Ptr<BroadcastChannel> channel);
+    /* Called by the channel with every frame another device sent. */
+    void Receive (Ptr<const Packet> frame);
+
+    virtual void SetIfIndex (const uint32_t index);
+    virtual uint32_t GetIfIndex (void) const;
+    virtual Ptr<Channel> GetChannel (void) const;
+    virtual void SetAddress (Address address);
+    virtual Address GetAddress (void) const;
+    virtual bool SetMtu (const uint16_t mtu);
+    virtual uint16_t GetMtu (void) const;
+    virtual bool IsLinkUp (void) const;
+    virtual void AddLinkChangeCallback (Callback<void> callback);
+    virtual bool IsBroadcast (void) const;
+    virtual Address GetBroadcast (void) const;
+    virtual bool IsMulticast (void) const;
+    virtual Address GetMulticast (Ipv4Address multicastGroup) const;
+    virtual Address GetMulticast (Ipv6Address addr) const;
+    virtual bool IsBridge (void) const;
+    virtual bool IsPointToPoint (void) const;
+    virtual bool Send (Ptr<Packet> packet, const Address &dest, uint16_t protocolNumber);
+    virtual bool SendFrom (Ptr<Packet> packet, const Address &source, const Address &dest,
+                           uint16_t protocolNumber);
+    virtual Ptr<Node> GetNode (void) const;
+    virtual void SetNode (Ptr<Node> node);
+    virtual bool NeedsArp (void) const;
+    virtual void SetReceiveCallback (NetDevice::ReceiveCallback cb);
+    virtual void SetPromiscReceiveCallback (NetDevice::PromiscReceiveCallback cb);
+    virtual bool SupportsSendFrom (void) const;
+
+protected:
+    virtual void DoDispose (void);
+
+private:
+    void TransmitStart (Ptr<Packet> frame);
+    void TransmitNext (void);
+    void ScheduleNext (void);
+
+    Ptr<Node> m_node;
+    Ptr<BroadcastChannel> m_channel;
+    Mac48Address m_address;
+    uint32_t m_ifIndex;
+    uint16_t m_mtu;
+    uint32_t m_maxQueue;
+
+    std::deque<Ptr<Packet> > m_queue;
+    EventId m_next;
+
+    NetDevice::ReceiveCallback m_rxCallback;
+    NetDevice::PromiscReceiveCallback m_promiscRxCallback;
+
+    TracedCallback<Ptr<const Packet> > m_macTxTrace;
+    TracedCallback<Ptr<const Packet> > m_macTxDropTrace;
+    TracedCallback<Ptr<const Packet> > m_macRxTrace;
+    TracedCallback<Ptr<const Packet> > m_macPromiscRxTrace;
+    TracedCallback<Ptr<const Packet> > m_phyTxBeginTrace;
+    TracedCallback<Ptr<const Packet> > m_phyRxEndTrace;
+    TracedCallback<Ptr<const Packet> > m_snifferTrace;
+    TracedCallback<Ptr<const Packet> > m_promiscSnifferTrace;
+    TracedCallback<> m_linkChangeCallbacks;
+};
+
+}
+
+#endif /* BROADCAST_CHANNEL_H */
@@ -0,0 +1,129 @@
+#include "bulk-sender.h"
+
+#include "ns3/log.h"
+#include "ns3/node.h"
+#include "ns3/packet.h"
+#include "ns3/string.h"
+#include "ns3/uinteger.h"
+#include "ns3/fatal-error.h"
+
+#include <algorithm>
+
+NS_LOG_COMPONENT_DEFINE ("BulkSender");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (BulkSender);
+
+TypeId
+BulkSender::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::BulkSender")
+        .SetParent<Application> ()
+        .AddConstructor<BulkSender> ()
+        .AddAttribute ("Remote", "Address to connect to.",
+                       AddressValue (),
+                       MakeAddressAccessor (&BulkSender::m_remote),
+                       MakeAddressChecker ())
+        .AddAttribute ("Local", "Address to bind to before connecting; unset to let routing choose.",
+                       AddressValue (),
+                       MakeAddressAccessor (&BulkSender::m_local),
+                       MakeAddressChecker ())
+        .AddAttribute ("Protocol", "Socket factory type.",
+                       StringValue ("ns3::LinuxTcpSocketFactory"),
+                       MakeStringAccessor (&BulkSender::m_protocol),
+                       MakeStringChecker ())
+        .AddAttribute ("SendSize", "Bytes per send call.",
+                       UintegerValue (128 * 1024),
+                       MakeUintegerAccessor (&BulkSender::m_sendSize),
+                       MakeUintegerChecker<uint32_t> (1))
+        ;
+    return tid;
+}
+
+BulkSender::BulkSender ()
+    : m_connected (false),
+      m_totalTx (0)
+{
+}
+
+uint64_t
+BulkSender::GetTotalTx (void) const
+{
+    return m_totalTx;
+}
+
+void
+BulkSender::DoDispose (void)
+{
+    m_socket = 0;
+    Application::DoDispose();
+}
+
+void
+BulkSender::StartApplication (void)
+{
+    if (!m_socket) {
+        m_socket = Socket::CreateSocket(GetNode(), TypeId::LookupByName(m_protocol));
+        int bound = m_local.IsInvalid() ? m_socket->Bind() : m_socket->Bind(m_local);
+        if (bound != 0) {
+            NS_FATAL_ERROR ("BulkSender on node " << GetNode()->GetId() << ": bind failed");
+        }
+        m_socket->Connect(m_remote);
+        m_socket->ShutdownRecv();
+        m_socket->SetConnectCallback(MakeCallback (&BulkSender::ConnectionSucceeded, this),
+                                     MakeCallback (&BulkSender::ConnectionFailed, this));
+        m_socket->SetSendCallback(MakeCallback (&BulkSender::DataSend, this));
+    }
+    if (m_connected) {
+        Fill();
+    }
+}
+
+void
+BulkSender::StopApplication (void)
+{
+    if (m_socket) {
+        m_socket->Close();
+        m_connected = false;
+    }
+    NS_LOG_INFO ("node " << GetNode()->GetId() << ": sent " << m_totalTx << " bytes");
+}
+
+void
+BulkSender::ConnectionSucceeded (Ptr<Socket> socket)
+{
+    NS_LOG_DEBUG ("node " << GetNode()->GetId() << ": connected");
+    m_connected = true;
+    Fill();
+}
+
+void
+BulkSender::ConnectionFailed (Ptr<Socket> socket)
+{
+    NS_LOG_WARN ("node " << GetNode()->GetId() << ": connection failed");
+}
+
+void
+BulkSender::DataSend (Ptr<Socket> socket, uint32_t available)
+{
+    if (m_connected) {
+        Fill();
+    }
+}
+
+void
+BulkSender::Fill (void)
+{
+    /* Only the size matters, the kernel copies zeros. */
+    while (m_socket->GetTxAvailable() > 0) {
+        uint32_t size = std::min(m_sendSize, m_socket->GetTxAvailable());
+        int sent = m_socket->Send(Create<Packet> (size));
+        if (sent <= 0) {
+            break;
+        }
+        m_totalTx += sent;
+    }
+}
+
+}
@@ -0,0 +1,56 @@
+#ifndef BULK_SENDER_H
+#define BULK_SENDER_H
+
+#include "ns3/application.h"
+#include "ns3/address.h"
+#include "ns3/socket.h"
+
+#include <string>
+
+namespace ns3 {
+
+/**
+ * Sends as fast as the socket accepts, like iperf -c, without running a
+ * binary. Built for the DCE kernel sockets ("Protocol" defaults to
+ * ns3::LinuxTcpSocketFactory), so MPTCP and the sysctls still apply but
+ * there is no libc emulation, argument parsing or per interval printing
+ * in the simulated process.
+ *
+ * Unlike ns-3's BulkSendApplication it can bind to "Local" first, the
+ * way iperf -B does, so policy routing by source address still picks
+ * the path. It sends until stopped.
+ */
+class BulkSender : public Application
+{
+public:
+    static TypeId GetTypeId (void);
+
+    BulkSender ();
+
+    uint64_t GetTotalTx (void) const;
+
+protected:
+    virtual void DoDispose (void);
+
+private:
+    virtual void StartApplication (void);
+    virtual void StopApplication (void);
+
+    void ConnectionSucceeded (Ptr<Socket> socket);
+    void ConnectionFailed (Ptr<Socket> socket);
+    void DataSend (Ptr<Socket> socket, uint32_t available);
+    void Fill (void);
+
+    Address m_remote;
+    Address m_local;
+    std::string m_protocol;
+    uint32_t m_sendSize;
+
+    Ptr<Socket> m_socket;
+    bool m_connected;
+    uint64_t m_totalTx;
+};
+
+}
+
+#endif /* BULK_SENDER_H */
@@ -0,0 +1,515 @@
+/*
+ * Per-node configuration agent, run inside a node by DCE.
+ *
+ * Started once per node by ConfigAgent (config-agent.h), it replaces the
+ * ip and iptables processes a scenario would otherwise start for every
+ * configuration step. It reads its operations from a file, one per line
+ * and ordered by time:
+ *
+ *   <ns> nl <hex> [<off>:<dev>...]
+ *                              netlink messages for NETLINK_ROUTE, with
+ *                              the index of <dev> written at byte <off>
+ *   <ns> link <dev> up|down    set a device up or down
+ *   <ns> masquerade <dev>      nat POSTROUTING -o <dev> -j MASQUERADE
+ *
+ * where <ns> is the time in nanoseconds since the agent started. It
+ * sleeps until the time of the next operations and applies all of the
+ * operations for that time together: the netlink messages, in order, in
+ * as few datagrams as hold them, over a socket kept open for the whole
+ * run, then the masquerade rules in a single replacement of the nat
+ * table. It exits once the last operations are applied. Device indices are only known
+ * inside the node, so the messages name devices and the agent looks the
+ * indices up, with one link dump whenever it meets a new name.
+ *
+ * usage: cfg-agent [FILE]   (default: /etc/cfg-agent/ops)
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/netfilter_ipv4/ip_tables.h>
+#include <linux/netfilter/nf_nat.h>
+
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/* Bytes of netlink messages per datagram, well inside the socket's send buffer */
+static const uint32_t MAX_DATAGRAM = 32768;
+
+/* Netlink messages of one operation, and where device indices go in them */
+struct Message {
+    int line;
+    std::vector<uint8_t> bytes;
+    std::vector<std::pair<uint32_t, std::string> > devices;
+};
+
+struct Op {
+    int64_t at;
+    /* Line in the operations file, for errors */
+    int line;
+    std::string kind;
+    std::string args;
+};
+
+static int64_t
+now_ns (void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void
+sleep_until (int64_t start, int64_t at)
+{
+    int64_t wait = at - (now_ns() - start);
+    if (wait <= 0) {
+        return;
+    }
+    struct timespec ts;
+    ts.tv_sec = wait / 1000000000;
+    ts.tv_nsec = wait % 1000000000;
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+static bool
+parse_hex (const std::string &hex, std::vector<uint8_t> &out)
+{
+    if (hex.size() % 2 != 0) {
+        return false;
+    }
+    for (std::string::size_type i = 0; i < hex.size(); i += 2) {
+        char *end;
+        std::string byte = hex.substr(i, 2);
+        long v = strtol(byte.c_str(), &end, 16);
+        if (*end != '\0') {
+            return false;
+        }
+        out.push_back((uint8_t)v);
+    }
+    return true;
+}
+
+static void
+add_attr (std::vector<uint8_t> &msg, uint16_t type, const void *data, uint16_t len)
+{
+    struct rtattr rta;
+    rta.rta_type = type;
+    rta.rta_len = RTA_LENGTH(len);
+    std::vector<uint8_t>::size_type off = msg.size();
+    msg.resize(off + RTA_SPACE(len), 0);
+    memcpy(&msg[off], &rta, sizeof(rta));
+    memcpy(&msg[off + RTA_LENGTH(0)], data, len);
+}
+
+/* RTM_NEWLINK for dev, found by name, changing IFF_UP only */
+static std::vector<uint8_t>
+link_message (const std::string &dev, bool up)
+{
+    std::vector<uint8_t> msg(NLMSG_SPACE(sizeof(struct ifinfomsg)), 0);
+    struct nlmsghdr *nlh = (struct nlmsghdr *)&msg[0];
+    nlh->nlmsg_type = RTM_NEWLINK;
+    struct ifinfomsg *ifi = (struct ifinfomsg *)NLMSG_DATA(nlh);
+    ifi->ifi_family = AF_UNSPEC;
+    ifi->ifi_flags = up ? IFF_UP : 0;
+    ifi->ifi_change = IFF_UP;
+
+    add_attr(msg, IFLA_IFNAME, dev.c_str(), dev.size() + 1);
+    ((struct nlmsghdr *)&msg[0])->nlmsg_len = msg.size();
+    return msg;
+}
+
+/* Index of every device by name, from an RTM_GETLINK dump */
+static bool
+dump_links (int fd, uint32_t &seq, std::map<std::string, int> &indices)
+{
+    struct {
+        struct nlmsghdr nlh;
+        struct ifinfomsg ifi;
+    } req;
+    memset(&req, 0, sizeof(req));
+    req.nlh.nlmsg_len = sizeof(req);
+    req.nlh.nlmsg_type = RTM_GETLINK;
+    req.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    req.nlh.nlmsg_seq = ++seq;
+    req.ifi.ifi_family = AF_UNSPEC;
+    if (send(fd, &req, sizeof(req), 0) < 0) {
+        std::cerr << "cfg-agent: link dump: " << strerror(errno) << "\n";
+        return false;
+    }
+
+    std::vector<uint8_t> reply(1 << 16);
+    for (;;) {
+        int len = recv(fd, &reply[0], reply.size(), 0);
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "cfg-agent: link dump: " << strerror(errno) << "\n";
+            return false;
+        }
+        for (struct nlmsghdr *nlh = (struct nlmsghdr *)&reply[0]; NLMSG_OK(nlh, len); nlh = NLMSG_NEXT(nlh, len)) {
+            if (nlh->nlmsg_seq != req.nlh.nlmsg_seq) {
+                continue;
+            }
+            if (nlh->nlmsg_type == NLMSG_DONE) {
+                return true;
+            }
+            if (nlh->nlmsg_type == NLMSG_ERROR) {
+                std::cerr << "cfg-agent: link dump: "
+                          << strerror(-((struct nlmsgerr *)NLMSG_DATA(nlh))->error) << "\n";
+                return false;
+            }
+            if (nlh->nlmsg_type != RTM_NEWLINK) {
+                continue;
+            }
+            struct ifinfomsg *ifi = (struct ifinfomsg *)NLMSG_DATA(nlh);
+            int attrLen = IFLA_PAYLOAD(nlh);
+            for (struct rtattr *rta = IFLA_RTA(ifi); RTA_OK(rta, attrLen); rta = RTA_NEXT(rta, attrLen)) {
+                if (rta->rta_type == IFLA_IFNAME) {
+                    indices[(const char *)RTA_DATA(rta)] = ifi->ifi_index;
+                }
+            }
+        }
+    }
+}
+
+/* Write the device indices into the messages; false if a device is unknown. */
+static bool
+resolve_devices (int fd, uint32_t &seq, std::map<std::string, int> &indices, Message &msg)
+{
+    for (std::vector<std::pair<uint32_t, std::string> >::const_iterator it = msg.devices.begin(); it != msg.devices.end(); ++it) {
+        if (indices.find(it->second) == indices.end() && !dump_links(fd, seq, indices)) {
+            return false;
+        }
+        std::map<std::string, int>::const_iterator index = indices.find(it->second);
+        if (index == indices.end()) {
+            std::cerr << "cfg-agent: line " << msg.line << ": no device " << it->second << "\n";
+            return false;
+        }
+        memcpy(&msg.bytes[it->first], &index->second, sizeof(int));
+    }
+    return true;
+}
+
+/*
+ * Send the messages of all ops in one datagram, each asking for an ACK,
+ * and wait for every ACK. Returns the number of messages that failed.
+ */
+static int
+send_netlink (int fd, const std::vector<Message> &ops, uint32_t &seq)
+{
+    std::vector<uint8_t> buf;
+    std::map<uint32_t, int> lines;
+
+    for (std::vector<Message>::const_iterator it = ops.begin(); it != ops.end(); ++it) {
+        std::vector<uint8_t>::size_type off = buf.size();
+        buf.insert(buf.end(), it->bytes.begin(), it->bytes.end());
+
+        int len = buf.size() - off;
+        for (struct nlmsghdr *nlh = (struct nlmsghdr *)&buf[off]; NLMSG_OK(nlh, len); nlh = NLMSG_NEXT(nlh, len)) {
+            nlh->nlmsg_flags |= NLM_F_REQUEST | NLM_F_ACK;
+            nlh->nlmsg_seq = ++seq;
+            nlh->nlmsg_pid = 0;
+            lines[seq] = it->line;
+        }
+    }
+    if (lines.empty()) {
+        return 0;
+    }
+
+    struct sockaddr_nl kernel;
+    memset(&kernel, 0, sizeof(kernel));
+    kernel.nl_family = AF_NETLINK;
+    if (sendto(fd, &buf[0], buf.size(), 0, (struct sockaddr *)&kernel, sizeof(kernel)) < 0) {
+        std::cerr << "cfg-agent: netlink send: " << strerror(errno) << "\n";
+        return lines.size();
+    }
+
+    int failed = 0;
+    std::vector<uint8_t> reply(1 << 16);
+    while (!lines.empty()) {
+        int len = recv(fd, &reply[0], reply.size(), 0);
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "cfg-agent: netlink receive: " << strerror(errno) << "\n";
+            return failed + lines.size();
+        }
+        for (struct nlmsghdr *nlh = (struct nlmsghdr *)&reply[0]; NLMSG_OK(nlh, len); nlh = NLMSG_NEXT(nlh, len)) {
+            if (nlh->nlmsg_type != NLMSG_ERROR) {
+                continue;
+            }
+            std::map<uint32_t, int>::iterator line = lines.find(nlh->nlmsg_seq);
+            if (line == lines.end()) {
+                continue;
+            }
+            struct nlmsgerr *err = (struct nlmsgerr *)NLMSG_DATA(nlh);
+            if (err->error != 0) {
+                std::cerr << "cfg-agent: line " << line->second << ": " << strerror(-err->error) << "\n";
+                failed++;
+            }
+            lines.erase(line);
+        }
+    }
+    return failed;
+}
+
+/* ipt_entry matching -o dev, with a MASQUERADE target over one (empty) range */
+static std::vector<uint8_t>
+masquerade_entry (const std::string &dev)
+{
+    uint16_t targetSize = XT_ALIGN(sizeof(struct xt_entry_target) + sizeof(struct nf_nat_ipv4_multi_range_compat));
+    std::vector<uint8_t> entry(sizeof(struct ipt_entry) + targetSize, 0);
+
+    struct ipt_entry *e = (struct ipt_entry *)&entry[0];
+    strncpy(e->ip.outiface, dev.c_str(), IFNAMSIZ - 1);
+    /* As iptables does for a name without a '+': the name and its terminating NUL */
+    memset(e->ip.outiface_mask, 0xff, dev.size() + 1 < IFNAMSIZ ? dev.size() + 1 : IFNAMSIZ);
+    e->target_offset = sizeof(struct ipt_entry);
+    e->next_offset = entry.size();
+
+    struct xt_entry_target *t = (struct xt_entry_target *)&entry[e->target_offset];
+    t->u.user.target_size = targetSize;
+    strcpy(t->u.user.name, "MASQUERADE");
+    struct nf_nat_ipv4_multi_range_compat *range = (struct nf_nat_ipv4_multi_range_compat *)t->data;
+    range->rangesize = 1;
+
+    return entry;
+}
+
+/*
+ * Append a MASQUERADE rule per device to the nat table's POSTROUTING
+ * chain, with one IPT_SO_SET_REPLACE. The new rules go right before the
+ * chain's policy, so every offset at or past it moves by their size. The
+ * counters of the existing rules start again from zero.
+ */
+static int
+add_masquerade (const std::vector<std::string> &devs)
+{
+    int fd = socket(AF_INET, SOCK_RAW, IPPROTO_RAW);
+    if (fd < 0) {
+        std::cerr << "cfg-agent: raw socket: " << strerror(errno) << "\n";
+        return devs.size();
+    }
+
+    struct ipt_getinfo info;
+    memset(&info, 0, sizeof(info));
+    strcpy(info.name, "nat");
+    socklen_t len = sizeof(info);
+    if (getsockopt(fd, IPPROTO_IP, IPT_SO_GET_INFO, &info, &len) < 0) {
+        std::cerr << "cfg-agent: nat table: " << strerror(errno) << "\n";
+        close(fd);
+        return devs.size();
+    }
+
+    std::vector<uint8_t> old(sizeof(struct ipt_get_entries) + info.size);
+    struct ipt_get_entries *entries = (struct ipt_get_entries *)&old[0];
+    strcpy(entries->name, "nat");
+    entries->size = info.size;
+    len = old.size();
+    if (getsockopt(fd, IPPROTO_IP, IPT_SO_GET_ENTRIES, entries, &len) < 0) {
+        std::cerr << "cfg-agent: nat entries: " << strerror(errno) << "\n";
+        close(fd);
+        return devs.size();
+    }
+
+    std::vector<uint8_t> added;
+    for (std::vector<std::string>::const_iterator it = devs.begin(); it != devs.end(); ++it) {
+        std::vector<uint8_t> entry = masquerade_entry(*it);
+        added.insert(added.end(), entry.begin(), entry.end());
+    }
+
+    uint32_t at = info.underflow[NF_INET_POST_ROUTING];
+    uint32_t size = info.size + added.size();
+    std::vector<uint8_t> buf(sizeof(struct ipt_replace) + size);
+    struct ipt_replace *r = (struct ipt_replace *)&buf[0];
+    strcpy(r->name, "nat");
+    r->valid_hooks = info.valid_hooks;
+    r->num_entries = info.num_entries + devs.size();
+    r->size = size;
+    for (int h = 0; h < NF_INET_NUMHOOKS; h++) {
+        r->hook_entry[h] = info.hook_entry[h];
+        r->underflow[h] = info.underflow[h];
+        if (!(info.valid_hooks & (1 << h))) {
+            continue;
+        }
+        /* An empty chain starts at its policy: it now starts at the first new rule */
+        r->hook_entry[h] = info.hook_entry[h] + (info.hook_entry[h] > at ? added.size() : 0);
+        r->underflow[h] = info.underflow[h] + (info.underflow[h] >= at ? added.size() : 0);
+    }
+    std::vector<struct xt_counters> counters(info.num_entries);
+    r->num_counters = info.num_entries;
+    r->counters = &counters[0];
+
+    uint8_t *blob = (uint8_t *)r->entries;
+    memcpy(blob, entries->entrytable, at);
+    memcpy(blob + at, &added[0], added.size());
+    memcpy(blob + at + added.size(), (uint8_t *)entries->entrytable + at, info.size - at);
+
+    /* Jumps are offsets from the start of the table */
+    for (uint32_t off = 0; off < size; ) {
+        struct ipt_entry *e = (struct ipt_entry *)(blob + off);
+        struct xt_entry_target *t = (struct xt_entry_target *)((uint8_t *)e + e->target_offset);
+        if (strcmp(t->u.user.name, XT_STANDARD_TARGET) == 0) {
+            struct xt_standard_target *st = (struct xt_standard_target *)t;
+            if (st->verdict > (int)at) {
+                st->verdict += added.size();
+            }
+        }
+        off += e->next_offset;
+    }
+
+    int failed = 0;
+    if (setsockopt(fd, IPPROTO_IP, IPT_SO_SET_REPLACE, r, buf.size()) < 0) {
+        std::cerr << "cfg-agent: nat replace: " << strerror(errno) << "\n";
+        failed = devs.size();
+    }
+    close(fd);
+    return failed;
+}
+
+static bool
+read_ops (const char *file, std::vector<Op> &ops)
+{
+    std::ifstream in (file);
+    if (!in.is_open()) {
+        std::cerr << "cfg-agent: cannot read " << file << "\n";
+        return false;
+    }
+
+    std::string text;
+    int line = 0;
+    while (std::getline(in, text)) {
+        line++;
+        if (text.empty() || text[0] == '#') {
+            continue;
+        }
+        Op op;
+        std::istringstream fields (text);
+        if (!(fields >> op.at >> op.kind)) {
+            std::cerr << "cfg-agent: line " << line << ": cannot parse \"" << text << "\"\n";
+            return false;
+        }
+        std::getline(fields >> std::ws, op.args);
+        op.line = line;
+        ops.push_back(op);
+    }
+    return true;
+}
+
+int
+main (int argc, char *argv[])
+{
+    int64_t start = now_ns();
+    const char *file = argc > 1 ? argv[1] : "/etc/cfg-agent/ops";
+
+    std::vector<Op> ops;
+    if (!read_ops(file, ops)) {
+        return 1;
+    }
+
+    int fd = socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
+    if (fd < 0) {
+        std::cerr << "cfg-agent: netlink socket: " << strerror(errno) << "\n";
+        return 1;
+    }
+    struct sockaddr_nl local;
+    memset(&local, 0, sizeof(local));
+    local.nl_family = AF_NETLINK;
+    if (bind(fd, (struct sockaddr *)&local, sizeof(local)) < 0) {
+        std::cerr << "cfg-agent: netlink bind: " << strerror(errno) << "\n";
+        return 1;
+    }
+
+    uint32_t seq = 0;
+    int failed = 0;
+    int groups = 0;
+    std::map<std::string, int> indices;
+    for (std::vector<Op>::size_type i = 0; i < ops.size(); ) {
+        int64_t at = ops[i].at;
+        std::vector<Message> messages;
+        std::vector<std::string> masquerade;
+
+        for (; i < ops.size() && ops[i].at == at; i++) {
+            const Op &op = ops[i];
+            Message msg;
+            msg.line = op.line;
+            if (op.kind == "nl") {
+                std::istringstream args (op.args);
+                std::string hex, device;
+                bool ok = (args >> hex) && parse_hex(hex, msg.bytes) && msg.bytes.size() >= NLMSG_HDRLEN;
+                while (ok && args >> device) {
+                    std::string::size_type colon = device.find(':');
+                    uint32_t off = strtoul(device.substr(0, colon).c_str(), 0, 10);
+                    ok = colon != std::string::npos && off + sizeof(int) <= msg.bytes.size();
+                    if (ok) {
+                        msg.devices.push_back(std::make_pair(off, device.substr(colon + 1)));
+                    }
+                }
+                if (!ok) {
+                    std::cerr << "cfg-agent: line " << op.line << ": bad netlink message\n";
+                    failed++;
+                    continue;
+                }
+                messages.push_back(msg);
+            } else if (op.kind == "link") {
+                std::istringstream args (op.args);
+                std::string dev, state;
+                if (!(args >> dev >> state) || (state != "up" && state != "down")) {
+                    std::cerr << "cfg-agent: line " << op.line << ": expected link <dev> up|down\n";
+                    failed++;
+                    continue;
+                }
+                msg.bytes = link_message(dev, state == "up");
+                messages.push_back(msg);
+            } else if (op.kind == "masquerade") {
+                masquerade.push_back(op.args);
+            } else {
+                std::cerr << "cfg-agent: line " << op.line << ": unknown operation " << op.kind << "\n";
+                failed++;
+            }
+        }
+
+        sleep_until(start, at);
+        std::vector<Message> batch;
+        std::vector<uint8_t>::size_type bytes = 0;
+        for (std::vector<Message>::iterator it = messages.begin(); it != messages.end(); ++it) {
+            if (!resolve_devices(fd, seq, indices, *it)) {
+                failed++;
+                continue;
+            }
+            if (!batch.empty() && bytes + it->bytes.size() > MAX_DATAGRAM) {
+                failed += send_netlink(fd, batch, seq);
+                batch.clear();
+                bytes = 0;
+            }
+            batch.push_back(*it);
+            bytes += it->bytes.size();
+        }
+        failed += send_netlink(fd, batch, seq);
+        if (!masquerade.empty()) {
+            failed += add_masquerade(masquerade);
+        }
+        groups++;
+    }
+    close(fd);
+
+    std::cout << "cfg-agent: " << ops.size() << " operations at " << groups << " times, "
+              << failed << " failed\n";
+    return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,482 @@
+#include "config-agent.h"
+#include "node-files.h"
+
+#include "ns3/dce-module.h"
+#include "ns3/log.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <set>
+#include <sstream>
+#include <stddef.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <arpa/inet.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/fib_rules.h>
+
+NS_LOG_COMPONENT_DEFINE ("ConfigAgent");
+
+namespace ns3 {
+
+/* Append len bytes of data, padded to netlink alignment; returns their offset. */
+static uint32_t
+put (std::vector<uint8_t> &buf, const void *data, uint32_t len)
+{
+    uint32_t off = buf.size();
+    buf.resize(off + NLMSG_ALIGN(len), 0);
+    memcpy(&buf[off], data, len);
+    return off;
+}
+
+/* Append an attribute; returns the offset of its data. */
+static uint32_t
+put_attr (std::vector<uint8_t> &buf, uint16_t type, const void *data, uint16_t len)
+{
+    struct rtattr rta;
+    rta.rta_len = RTA_LENGTH(len);
+    rta.rta_type = type;
+    put(buf, &rta, sizeof(rta));
+    return put(buf, data, len);
+}
+
+static uint32_t
+put_u32 (std::vector<uint8_t> &buf, uint16_t type, uint32_t value)
+{
+    return put_attr(buf, type, &value, sizeof(value));
+}
+
+/* Address attributes are in network byte order */
+static uint32_t
+put_ipv4 (std::vector<uint8_t> &buf, uint16_t type, uint32_t address)
+{
+    return put_u32(buf, type, htonl(address));
+}
+
+/* Header for a new object of type, followed by the family header hdr */
+static std::vector<uint8_t>
+start_message (uint16_t type, const void *hdr, uint32_t len)
+{
+    struct nlmsghdr nlh;
+    memset(&nlh, 0, sizeof(nlh));
+    nlh.nlmsg_type = type;
+    nlh.nlmsg_flags = NLM_F_CREATE | NLM_F_EXCL;
+
+    std::vector<uint8_t> buf;
+    put(buf, &nlh, sizeof(nlh));
+    put(buf, hdr, len);
+    return buf;
+}
+
+ConfigAgent::ConfigAgent ()
+    : m_nOperations (0),
+      m_stackSize (1 << 16),
+      m_installed (false)
+{
+}
+
+ConfigAgent::OpId
+ConfigAgent::Add (Ptr<Node> n, Time at, std::string op)
+{
+    if (m_installed) {
+        NS_FATAL_ERROR ("ConfigAgent: \"" << op << "\" added after Install");
+    }
+    if (at.IsStrictlyNegative()) {
+        NS_FATAL_ERROR ("ConfigAgent: \"" << op << "\" at negative time " << at.GetSeconds() << "s");
+    }
+
+    Op o;
+    o.node = n;
+    o.at = at.GetNanoSeconds();
+    o.line = op;
+    o.hasSubnet = false;
+
+    OpId id = m_ops.size();
+    m_ops.push_back(o);
+    m_nodes[n->GetId()][o.at].push_back(id);
+    m_nOperations++;
+    return id;
+}
+
+ConfigAgent::OpId
+ConfigAgent::Add (Ptr<Node> n, Time at, const Message &msg)
+{
+    std::vector<uint8_t> bytes = msg.bytes;
+    ((struct nlmsghdr *)&bytes[0])->nlmsg_len = bytes.size();
+
+    std::ostringstream op;
+    op << "nl " << std::hex << std::setfill('0');
+    for (std::vector<uint8_t>::const_iterator it = bytes.begin(); it != bytes.end(); ++it) {
+        op << std::setw(2) << (unsigned)*it;
+    }
+    op << std::dec;
+    for (std::vector<std::pair<uint32_t, std::string> >::const_iterator it = msg.devices.begin(); it != msg.devices.end(); ++it) {
+        op << " " << it->first << ":" << it->second;
+    }
+
+    OpId id = Add(n, at, op.str());
+    for (std::vector<std::pair<uint32_t, std::string> >::const_iterator it = msg.devices.begin(); it != msg.devices.end(); ++it) {
+        m_ops[id].devices.push_back(it->second);
+    }
+    return id;
+}
+
+ConfigAgent::OpId
+ConfigAgent::AddAddress (Ptr<Node> n, Time at, std::string dev, Ipv4Prefix subnet, uint32_t host)
+{
+    struct ifaddrmsg ifa;
+    memset(&ifa, 0, sizeof(ifa));
+    ifa.ifa_family = AF_INET;
+    ifa.ifa_prefixlen = subnet.length;
+    ifa.ifa_scope = RT_SCOPE_UNIVERSE;
+
+    Message msg;
+    msg.bytes = start_message(RTM_NEWADDR, &ifa, sizeof(ifa));
+    msg.devices.push_back(std::make_pair(NLMSG_HDRLEN + offsetof(struct ifaddrmsg, ifa_index), dev));
+    put_ipv4(msg.bytes, IFA_LOCAL, subnet.GetHost(host));
+    put_ipv4(msg.bytes, IFA_ADDRESS, subnet.GetHost(host));
+    if (subnet.length < 31) {
+        put_ipv4(msg.bytes, IFA_BROADCAST, subnet.GetBroadcast());
+    }
+
+    OpId id = Add(n, at, msg);
+    m_ops[id].hasSubnet = true;
+    m_ops[id].subnet = subnet;
+    return id;
+}
+
+ConfigAgent::Message
+ConfigAgent::NewRoute (Ipv4Prefix prefix, uint32_t table, uint32_t metric, uint8_t scope)
+{
+    struct rtmsg rtm;
+    memset(&rtm, 0, sizeof(rtm));
+    rtm.rtm_family = AF_INET;
+    rtm.rtm_dst_len = prefix.length;
+    /* As ip does: tables past 255 only fit the attribute */
+    rtm.rtm_table = table < 256 ? table : RT_TABLE_UNSPEC;
+    rtm.rtm_protocol = RTPROT_BOOT;
+    rtm.rtm_scope = scope;
+    rtm.rtm_type = RTN_UNICAST;
+
+    Message msg;
+    msg.bytes = start_message(RTM_NEWROUTE, &rtm, sizeof(rtm));
+    if (prefix.length > 0) {
+        put_ipv4(msg.bytes, RTA_DST, prefix.network);
+    }
+    put_u32(msg.bytes, RTA_TABLE, table);
+    if (metric > 0) {
+        put_u32(msg.bytes, RTA_PRIORITY, metric);
+    }
+    return msg;
+}
+
+ConfigAgent::OpId
+ConfigAgent::AddRoute (Ptr<Node> n, Time at, Ipv4Prefix prefix, uint32_t via, std::string dev,
+                       uint32_t table, uint32_t metric)
+{
+    if (via == 0 && dev.empty()) {
+        NS_FATAL_ERROR ("ConfigAgent: route to " << prefix.ToString() << " needs a gateway or a device");
+    }
+
+    /* Without a gateway the destination is on the link, as ip assumes */
+    Message msg = NewRoute(prefix, table, metric, via == 0 ? RT_SCOPE_LINK : RT_SCOPE_UNIVERSE);
+    if (via != 0) {
+        put_ipv4(msg.bytes, RTA_GATEWAY, via);
+    }
+    if (!dev.empty()) {
+        msg.devices.push_back(std::make_pair(put_u32(msg.bytes, RTA_OIF, 0), dev));
+    }
+
+    OpId id = Add(n, at, msg);
+    if (via != 0) {
+        m_ops[id].gateways.push_back(via);
+    }
+    return id;
+}
+
+ConfigAgent::OpId
+ConfigAgent::AddMultipathRoute (Ptr<Node> n, Time at, Ipv4Prefix prefix, const std::vector<Nexthop> &nexthops,
+                                uint32_t table, uint32_t metric)
+{
+    if (nexthops.empty()) {
+        NS_FATAL_ERROR ("ConfigAgent: multipath route to " << prefix.ToString() << " without next hops");
+    }
+
+    Message msg = NewRoute(prefix, table, metric, RT_SCOPE_UNIVERSE);
+
+    struct rtattr rta;
+    rta.rta_type = RTA_MULTIPATH;
+    uint32_t start = put(msg.bytes, &rta, sizeof(rta));
+    for (std::vector<Nexthop>::const_iterator it = nexthops.begin(); it != nexthops.end(); ++it) {
+        if (it->weight == 0) {
+            NS_FATAL_ERROR ("ConfigAgent: next hop weights start at 1");
+        }
+        struct rtnexthop rtnh;
+        memset(&rtnh, 0, sizeof(rtnh));
+        rtnh.rtnh_hops = it->weight - 1;
+        uint32_t hop = put(msg.bytes, &rtnh, sizeof(rtnh));
+        if (it->via != 0) {
+            put_ipv4(msg.bytes, RTA_GATEWAY, it->via);
+        }
+        if (!it->dev.empty()) {
+            msg.devices.push_back(std::make_pair(hop + offsetof(struct rtnexthop, rtnh_ifindex), it->dev));
+        }
+        ((struct rtnexthop *)&msg.bytes[hop])->rtnh_len = msg.bytes.size() - hop;
+    }
+    ((struct rtattr *)&msg.bytes[start])->rta_len = msg.bytes.size() - start;
+
+    OpId id = Add(n, at, msg);
+    for (std::vector<Nexthop>::const_iterator it = nexthops.begin(); it != nexthops.end(); ++it) {
+        if (it->via != 0) {
+            m_ops[id].gateways.push_back(it->via);
+        }
+    }
+    return id;
+}
+
+ConfigAgent::OpId
+ConfigAgent::AddRule (Ptr<Node> n, Time at, Ipv4Prefix from, std::string iif, uint32_t table, uint32_t priority)
+{
+    struct fib_rule_hdr frh;
+    memset(&frh, 0, sizeof(frh));
+    frh.family = AF_INET;
+    frh.src_len = from.length;
+    frh.table = table < 256 ? table : RT_TABLE_UNSPEC;
+    frh.action = FR_ACT_TO_TBL;
+
+    Message msg;
+    msg.bytes = start_message(RTM_NEWRULE, &frh, sizeof(frh));
+    if (from.length > 0) {
+        put_ipv4(msg.bytes, FRA_SRC, from.network);
+    }
+    if (!iif.empty()) {
+        put_attr(msg.bytes, FRA_IIFNAME, iif.c_str(), iif.size() + 1);
+    }
+    put_u32(msg.bytes, FRA_TABLE, table);
+    if (priority > 0) {
+        put_u32(msg.bytes, FRA_PRIORITY, priority);
+    }
+    return Add(n, at, msg);
+}
+
+ConfigAgent::OpId
+ConfigAgent::Netlink (Ptr<Node> n, Time at, const std::vector<uint8_t> &messages)
+{
+    std::ostringstream op;
+    op << "nl " << std::hex << std::setfill('0');
+    for (std::vector<uint8_t>::const_iterator it = messages.begin(); it != messages.end(); ++it) {
+        op << std::setw(2) << (unsigned)*it;
+    }
+    return Add(n, at, op.str());
+}
+
+ConfigAgent::OpId
+ConfigAgent::SetLink (Ptr<Node> n, Time at, std::string dev, bool up)
+{
+    OpId id = Add(n, at, "link " + dev + (up ? " up" : " down"));
+    m_ops[id].link = dev;
+    return id;
+}
+
+ConfigAgent::OpId
+ConfigAgent::Masquerade (Ptr<Node> n, Time at, std::string dev)
+{
+    return Add(n, at, "masquerade " + dev);
+}
+
+void
+ConfigAgent::Require (OpId op, OpId prerequisite)
+{
+    if (op >= m_ops.size() || prerequisite >= m_ops.size()) {
+        NS_FATAL_ERROR ("ConfigAgent: no operation " << std::max(op, prerequisite));
+    }
+    const Op &o = m_ops[op];
+    const Op &p = m_ops[prerequisite];
+    if (o.node->GetId() != p.node->GetId() || p.at > o.at) {
+        NS_FATAL_ERROR ("ConfigAgent: \"" << o.line << "\" cannot require \"" << p.line
+                        << "\", which is on another node or later");
+    }
+    /* Anything earlier has been applied already */
+    if (p.at == o.at) {
+        m_ops[op].requires.push_back(prerequisite);
+    }
+}
+
+void
+ConfigAgent::Sysctl (Ptr<Node> n, Time at, std::string key, std::string value)
+{
+    if (m_installed) {
+        NS_FATAL_ERROR ("ConfigAgent: sysctl " << key << " added after Install");
+    }
+
+    std::pair<uint32_t, int64_t> slot (n->GetId(), at.GetNanoSeconds());
+    SysctlMap::iterator it = m_sysctls.find(slot);
+    if (it == m_sysctls.end()) {
+        it = m_sysctls.insert(std::make_pair(slot, std::make_pair(n, SysctlProfile ("config-agent")))).first;
+    }
+    it->second.second.Set(key, value);
+    m_nOperations++;
+}
+
+void
+ConfigAgent::SetStackSize (uint32_t stackSize)
+{
+    m_stackSize = stackSize;
+}
+
+/*
+ * Kahn's algorithm over the operations of one node and time: apply an
+ * operation once everything it requires has been, taking the earliest
+ * added of those ready so unrelated operations keep their order.
+ */
+std::vector<ConfigAgent::OpId>
+ConfigAgent::Order (const std::vector<OpId> &ops) const
+{
+    std::map<std::string, std::vector<OpId> > links;
+    std::vector<OpId> addresses;
+    for (std::vector<OpId>::const_iterator it = ops.begin(); it != ops.end(); ++it) {
+        if (!m_ops[*it].link.empty()) {
+            links[m_ops[*it].link].push_back(*it);
+        }
+        if (m_ops[*it].hasSubnet) {
+            addresses.push_back(*it);
+        }
+    }
+
+    std::map<OpId, std::vector<OpId> > next;
+    std::map<OpId, uint32_t> waiting;
+    for (std::vector<OpId>::const_iterator it = ops.begin(); it != ops.end(); ++it) {
+        const Op &op = m_ops[*it];
+        std::set<OpId> required (op.requires.begin(), op.requires.end());
+
+        for (std::vector<std::string>::const_iterator dev = op.devices.begin(); dev != op.devices.end(); ++dev) {
+            std::map<std::string, std::vector<OpId> >::const_iterator link = links.find(*dev);
+            if (link != links.end()) {
+                required.insert(link->second.begin(), link->second.end());
+            }
+        }
+        for (std::vector<uint32_t>::const_iterator gw = op.gateways.begin(); gw != op.gateways.end(); ++gw) {
+            for (std::vector<OpId>::const_iterator addr = addresses.begin(); addr != addresses.end(); ++addr) {
+                if (m_ops[*addr].subnet.Contains(*gw)) {
+                    required.insert(*addr);
+                }
+            }
+        }
+        required.erase(*it);
+
+        waiting[*it] = required.size();
+        for (std::set<OpId>::const_iterator r = required.begin(); r != required.end(); ++r) {
+            next[*r].push_back(*it);
+        }
+    }
+
+    std::set<OpId> ready;
+    for (std::map<OpId, uint32_t>::const_iterator it = waiting.begin(); it != waiting.end(); ++it) {
+        if (it->second == 0) {
+            ready.insert(it->first);
+        }
+    }
+
+    std::vector<OpId> order;
+    while (!ready.empty()) {
+        OpId id = *ready.begin();
+        ready.erase(ready.begin());
+        order.push_back(id);
+
+        const std::vector<OpId> &after = next[id];
+        for (std::vector<OpId>::const_iterator it = after.begin(); it != after.end(); ++it) {
+            if (--waiting[*it] == 0) {
+                ready.insert(*it);
+            }
+        }
+    }
+
+    if (order.size() != ops.size()) {
+        std::ostringstream cycle;
+        for (std::map<OpId, uint32_t>::const_iterator it = waiting.begin(); it != waiting.end(); ++it) {
+            if (it->second > 0) {
+                cycle << "\n  " << m_ops[it->first].line;
+            }
+        }
+        NS_FATAL_ERROR ("ConfigAgent: operations on node " << m_ops[ops[0]].node->GetId()
+                        << " at " << NanoSeconds (m_ops[ops[0]].at).GetSeconds() << "s require each other:"
+                        << cycle.str());
+    }
+    return order;
+}
+
+std::string
+ConfigAgent::WriteOpsFile (uint32_t node, const std::map<int64_t, std::vector<OpId> > &times) const
+{
+    std::string dir = "/etc/cfg-agent";
+    std::string hostPath = MakeNodeDirectory(node, dir) + "/ops";
+    std::ofstream out (hostPath.c_str(), std::ios::out | std::ios::trunc);
+    if (!out.is_open()) {
+        NS_FATAL_ERROR ("Could not write agent operations file " << hostPath);
+    }
+    for (std::map<int64_t, std::vector<OpId> >::const_iterator t = times.begin(); t != times.end(); ++t) {
+        std::vector<OpId> order = Order(t->second);
+        for (std::vector<OpId>::const_iterator op = order.begin(); op != order.end(); ++op) {
+            out << t->first << " " << m_ops[*op].line << "\n";
+        }
+    }
+    out.close();
+
+    return dir + "/ops";
+}
+
+ApplicationContainer
+ConfigAgent::Install (void)
+{
+    if (m_installed) {
+        NS_FATAL_ERROR ("ConfigAgent installed twice");
+    }
+    m_installed = true;
+
+    for (SysctlMap::const_iterator it = m_sysctls.begin(); it != m_sysctls.end(); ++it) {
+        it->second.second.Apply(it->second.first, NanoSeconds (it->first.second));
+    }
+
+    DceApplicationHelper process;
+    ApplicationContainer apps;
+
+    process.SetBinary ("cfg-agent");
+    process.SetStackSize (m_stackSize);
+
+    for (NodeMap::const_iterator it = m_nodes.begin(); it != m_nodes.end(); ++it) {
+        std::string file = WriteOpsFile(it->first, it->second);
+
+        NS_LOG_DEBUG ("node " << it->first << ": operations at " << it->second.size()
+                      << " times in " << file);
+
+        process.ResetArguments ();
+        process.ResetEnvironment ();
+        process.AddArgument (file);
+
+        /* Operation times are relative to the agent's start. */
+        ApplicationContainer agentApps = process.Install (m_ops[it->second.begin()->second[0]].node);
+        agentApps.Start (Seconds (0));
+        apps.Add (agentApps);
+    }
+
+    std::cout << "cfg-agent: " << m_nOperations << " operations, " << m_nodes.size() << " agents\n";
+
+    return apps;
+}
+
+uint32_t
+ConfigAgent::GetNOperations (void) const
+{
+    return m_nOperations;
+}
+
+uint32_t
+ConfigAgent::GetNAgents (void) const
+{
+    return m_nodes.size();
+}
+
+}
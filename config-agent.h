@@ -0,0 +1,143 @@
+#ifndef CONFIG_AGENT_H
+#define CONFIG_AGENT_H
+
+#include "sysctl-profile.h"
+#include "ipv4-prefix.h"
+
+#include "ns3/node.h"
+#include "ns3/nstime.h"
+#include "ns3/application-container.h"
+
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * Runs the configuration of each node from one long lived process, the
+ * cfg-agent DCE program (cfg-agent.cc), instead of an ip or iptables
+ * process per step.
+ *
+ * Operations are planned before the simulation runs: Install writes each
+ * node's operations, ordered by time, to files-<id>/etc/cfg-agent/ops and
+ * starts one agent per node at 0. The agent sleeps until each time, then
+ * applies every operation for it at once: netlink messages batched into
+ * as few datagrams as hold them, masquerade rules in one nat table
+ * replacement.
+ *
+ * Addresses, routes and rules are built here as netlink messages, with
+ * nothing for a process to parse; devices are given by name and the
+ * agent fills in their indices.
+ *
+ * The operations for one node and time form a graph, applied in
+ * dependency order, so a whole configuration can be given for one time
+ * (0, before any traffic) instead of being spread over staged times.
+ * Each operation requires, among those for the same node and time:
+ *
+ *   - bringing up every device it names (SetLink for that device)
+ *   - the addresses whose subnet holds a gateway it routes via
+ *   - whatever Require adds
+ *
+ * Operations with nothing between them keep the order they were added
+ * in, and a cycle is fatal at Install.
+ *
+ * Sysctl values do not need a process at all; they are written from
+ * ns-3 as SysctlProfile does, one event per node and time.
+ */
+class ConfigAgent
+{
+public:
+    enum {
+        MAIN_TABLE = 254
+    };
+
+    struct Nexthop {
+        /* Gateway in host byte order, 0 for none */
+        uint32_t via;
+        std::string dev;
+        uint8_t weight;
+    };
+
+    typedef uint32_t OpId;
+
+    ConfigAgent ();
+
+    /* ip addr add <subnet host n>/<len> broadcast <subnet broadcast> dev dev */
+    OpId AddAddress (Ptr<Node> n, Time at, std::string dev, Ipv4Prefix subnet, uint32_t host);
+    /* ip route add prefix [via via] [dev dev] table table [metric metric]; via 0 or dev "" leave them out */
+    OpId AddRoute (Ptr<Node> n, Time at, Ipv4Prefix prefix, uint32_t via, std::string dev,
+                   uint32_t table = MAIN_TABLE, uint32_t metric = 0);
+    /* ip route add prefix table table [metric metric] nexthop via .. dev .. weight .. ... */
+    OpId AddMultipathRoute (Ptr<Node> n, Time at, Ipv4Prefix prefix, const std::vector<Nexthop> &nexthops,
+                            uint32_t table = MAIN_TABLE, uint32_t metric = 0);
+    /* ip rule add from from [dev iif] lookup table [priority priority]; iif "" for any device */
+    OpId AddRule (Ptr<Node> n, Time at, Ipv4Prefix from, std::string iif, uint32_t table, uint32_t priority = 0);
+
+    /* Raw NETLINK_ROUTE messages for node n at time at; the agent sets their flags and sequence numbers. */
+    OpId Netlink (Ptr<Node> n, Time at, const std::vector<uint8_t> &messages);
+    /* ip link set dev up|down */
+    OpId SetLink (Ptr<Node> n, Time at, std::string dev, bool up);
+    /* iptables -t nat -A POSTROUTING -o dev -j MASQUERADE */
+    OpId Masquerade (Ptr<Node> n, Time at, std::string dev);
+    /* Apply op after prerequisite; both on the same node, prerequisite no later than op. */
+    void Require (OpId op, OpId prerequisite);
+
+    /* key as for SysctlProfile::Set, e.g. ".net.ipv4.ip_forward" */
+    void Sysctl (Ptr<Node> n, Time at, std::string key, std::string value);
+
+    void SetStackSize (uint32_t stackSize);
+
+    /**
+    * Write out the operations and start one agent per node that has any.
+    * Call once, after all operations have been added and after
+    * DceManagerHelper::Install.
+    */
+    ApplicationContainer Install (void);
+
+    uint32_t GetNOperations (void) const;
+    uint32_t GetNAgents (void) const;
+
+private:
+    /* A netlink message and the offsets in it that take a device's index */
+    struct Message {
+        std::vector<uint8_t> bytes;
+        std::vector<std::pair<uint32_t, std::string> > devices;
+    };
+
+    struct Op {
+        Ptr<Node> node;
+        int64_t at;
+        /* Line of the ops file */
+        std::string line;
+        /* Device a SetLink is for */
+        std::string link;
+        /* Devices, gateways and subnet, to work out what it requires */
+        std::vector<std::string> devices;
+        std::vector<uint32_t> gateways;
+        bool hasSubnet;
+        Ipv4Prefix subnet;
+        std::vector<OpId> requires;
+    };
+    /* Operations by node and time, in the order they were added */
+    typedef std::map<uint32_t, std::map<int64_t, std::vector<OpId> > > NodeMap;
+    typedef std::map<std::pair<uint32_t, int64_t>, std::pair<Ptr<Node>, SysctlProfile> > SysctlMap;
+
+    OpId Add (Ptr<Node> n, Time at, std::string op);
+    OpId Add (Ptr<Node> n, Time at, const Message &msg);
+    std::vector<OpId> Order (const std::vector<OpId> &ops) const;
+    static Message NewRoute (Ipv4Prefix prefix, uint32_t table, uint32_t metric, uint8_t scope);
+    std::string WriteOpsFile (uint32_t node, const std::map<int64_t, std::vector<OpId> > &times) const;
+
+    std::vector<Op> m_ops;
+    NodeMap m_nodes;
+    SysctlMap m_sysctls;
+    uint32_t m_nOperations;
+    uint32_t m_stackSize;
+    bool m_installed;
+};
+
+}
+
+#endif /* CONFIG_AGENT_H */
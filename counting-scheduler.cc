@@ -0,0 +1,131 @@
+#include "counting-scheduler.h"
+
+#include "ns3/object-factory.h"
+#include "ns3/boolean.h"
+#include "ns3/string.h"
+#include "ns3/log.h"
+
+#include <time.h>
+
+NS_LOG_COMPONENT_DEFINE ("CountingScheduler");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (CountingScheduler);
+
+CountingScheduler::Stats CountingScheduler::m_stats = { 0, 0, 0, 0, 0, 0 };
+
+TypeId
+CountingScheduler::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::CountingScheduler")
+        .SetParent<Scheduler> ()
+        .AddConstructor<CountingScheduler> ()
+        .AddAttribute ("Scheduler", "Type of the scheduler doing the work.",
+                       StringValue ("ns3::MapScheduler"),
+                       MakeStringAccessor (&CountingScheduler::SetScheduler,
+                                           &CountingScheduler::GetScheduler),
+                       MakeStringChecker ())
+        .AddAttribute ("Timing", "Time the inner scheduler's Insert and RemoveNext.",
+                       BooleanValue (false),
+                       MakeBooleanAccessor (&CountingScheduler::m_timing),
+                       MakeBooleanChecker ())
+        ;
+    return tid;
+}
+
+CountingScheduler::CountingScheduler ()
+    : m_timing (false),
+      m_depth (0)
+{
+}
+
+uint64_t
+CountingScheduler::GetNEvents (void)
+{
+    return m_stats.removes;
+}
+
+const CountingScheduler::Stats &
+CountingScheduler::GetStats (void)
+{
+    return m_stats;
+}
+
+double
+CountingScheduler::Clock (void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+void
+CountingScheduler::SetScheduler (std::string type)
+{
+    ObjectFactory factory;
+    factory.SetTypeId(type);
+    m_type = type;
+    m_scheduler = factory.Create<Scheduler> ();
+}
+
+std::string
+CountingScheduler::GetScheduler (void) const
+{
+    return m_type;
+}
+
+void
+CountingScheduler::Insert (const Event &ev)
+{
+    m_depth++;
+    m_stats.inserts++;
+    m_stats.depthSum += m_depth;
+    if (m_depth > m_stats.maxDepth) {
+        m_stats.maxDepth = m_depth;
+    }
+
+    if (m_timing) {
+        double start = Clock();
+        m_scheduler->Insert(ev);
+        m_stats.insertNs += Clock() - start;
+    } else {
+        m_scheduler->Insert(ev);
+    }
+}
+
+bool
+CountingScheduler::IsEmpty (void) const
+{
+    return m_scheduler->IsEmpty();
+}
+
+Scheduler::Event
+CountingScheduler::PeekNext (void) const
+{
+    return m_scheduler->PeekNext();
+}
+
+Scheduler::Event
+CountingScheduler::RemoveNext (void)
+{
+    m_depth--;
+    m_stats.removes++;
+
+    if (m_timing) {
+        double start = Clock();
+        Event ev = m_scheduler->RemoveNext();
+        m_stats.removeNs += Clock() - start;
+        return ev;
+    }
+    return m_scheduler->RemoveNext();
+}
+
+void
+CountingScheduler::Remove (const Event &ev)
+{
+    m_depth--;
+    m_scheduler->Remove(ev);
+}
+
+}
@@ -8,6 +8,8 @@
 #include "ns3/point-to-point-module.h"
 #include <unistd.h>
 
+#include "delay-line.h"
+
 using namespace ns3;
 
 Ptr<NormalRandomVariable> createNormalRandomVariable(double mean, double variance, double bound){
@@ -18,18 +20,6 @@ Ptr<NormalRandomVariable> createNormalRandomVariable(double mean, double varianc
     return x;
 }
 
-bool netDevCb(
-  Ptr<NetDevice> device,
-  Ptr<const Packet> pkt,
-  uint16_t  protocol,
-  const Address &from)
-{
-    static Ptr<NormalRandomVariable> x = createNormalRandomVariable(100, 100, 50);
-    Ptr<Node> node = device->GetNode ();
-    Simulator::Schedule(MilliSeconds(x->GetValue()), &Node::NonPromiscReceiveFromDevice, node, device, pkt, protocol, from);
-    return  true;
-}
-
 int
 main (int argc, char *argv[])
 {
@@ -57,9 +47,9 @@ main (int argc, char *argv[])
 
     Ptr<NetDevice> serverDevice = devices.Get(1);
 
-    Callback<bool, Ptr<NetDevice>, Ptr<const Packet>, uint16_t, const Address&> cb;
-    cb = MakeCallback(&netDevCb);
-    serverDevice->SetReceiveCallback(cb);
+    Ptr<DelayLine> delayLine = CreateObject<DelayLine> ();
+    delayLine->SetDelay(createNormalRandomVariable(100, 100, 50));
+    delayLine->Install(serverDevice);
 
     dce.SetStackSize (1 << 20);
 
@@ -75,6 +65,9 @@ main (int argc, char *argv[])
 
     Simulator::Stop (Seconds (10.00));
     Simulator::Run ();
+
+    std::cout << "Delayed " << delayLine->GetNDelivered() << " of " << delayLine->GetNReceived()
+              << " packets, " << delayLine->GetNHeld() << " held to keep order.\n";
     Simulator::Destroy ();
 
 }
@@ -18,49 +18,24 @@
 #include "ns3/point-to-point-module.h"
 #include "ns3/applications-module.h"
 
-#include <math.h>
 #include <string>
 #include <sstream>
 
+#include "ip-batch-helper.h"
+#include "run-cache.h"
+#include "tree-topology.h"
+#include "address-plan.h"
+#include "sysctl-profile.h"
+#include "stop-controller.h"
+#include "flow-stats.h"
+#include "run-profile.h"
+#include "config-agent.h"
+#include "segment-helper.h"
 
-using namespace ns3;
-
-
-
-uint32_t
-get_height(uint32_t stride, uint32_t nodes)
-{
-    /*h = logk(k-1) + logk(n) -1*/
-    return (log(stride-1) / log(stride)) + (log(nodes) / log(stride));
-}
-
-uint32_t
-get_leaves(uint32_t stride, uint32_t height)
-{
-    return pow(stride, height);
-}
-
-int
-get_parent(int node, int stride)
-{
-    if(node <= 0) return -1;
-    return (uint32_t)(floor((node-1)/stride));
-}
 
-uint32_t
-get_first_child(int node, int stride)
-{
-    return (uint32_t)(node*stride)+1;
-}
+using namespace ns3;
 
-uint32_t
-is_leaf(uint32_t stride, uint32_t nodes, uint32_t nodeIdx)
-{
-    uint32_t height = get_height(stride, nodes);
-    uint32_t leaves = get_leaves(stride, height);
 
-    return (nodes-leaves) < nodeIdx ? 1 : 0;
-}
 
 int main(int argc, char *argv[])
 {
@@ -74,25 +49,63 @@ int main(int argc, char *argv[])
     NetDeviceContainer staDevices;
 
     std::stringstream cmdStream;
+    IpBatchHelper ipBatch;
+    ConfigAgent agent;
 
     uint32_t nDevices = 7;
     uint32_t treeStride = 2;
     uint32_t nInterfaces = 0;
     uint32_t nRootInterfaces = 2;
 
+    double stopTime = 15.0;
+    double quietInterval = 1.0;
+    uint32_t quietPackets = 0;
+    double warmup = 0;
+    bool pcap = true;
+    bool flowStats = true;
+
+    std::string segmentType = "csma";
+    std::string cacheDir;
+
     CommandLine cmd;
+    RunProfile profile ("dce-mpdd-nested-csma");
+    profile.AddOptions(cmd);
     cmd.AddValue("devices", "Number of wifi devices", nDevices);
     cmd.AddValue("stride", "Tree Stride", treeStride);
     cmd.AddValue("interfaces",
         "Number of gateway interfaces for non root devices", nInterfaces);
     cmd.AddValue("root_interfaces",
         "Number of gateway interfaces for root device", nRootInterfaces);
+    cmd.AddValue("stopTime", "Latest stop time; the run ends earlier once the MPDD tree goes quiet", stopTime);
+    cmd.AddValue("warmup", "Idle seconds between the configuration at 0 and the MPDD daemons starting", warmup);
+    cmd.AddValue("quietInterval", "Seconds per quiescence check", quietInterval);
+    cmd.AddValue("quietPackets", "Tree packets per interval still counted as quiet, e.g. for periodic hellos", quietPackets);
+    cmd.AddValue("pcap", "Write pcaps of the watched devices", pcap);
+    cmd.AddValue("flowStats", "Write per flow throughput, retransmission and RTT bins to flow-stats.txt", flowStats);
+    cmd.AddValue("segment", "Tree segments: csma, or broadcast for a shared medium without collisions or backoff", segmentType);
+    cmd.AddValue("cache", "Directory of cached run results, disabled if empty", cacheDir);
 
     cmd.Parse(argc, argv);
 
+    /*Configuration is all at 0; the daemons follow 1s later, after any warm-up*/
+    Time start = Seconds (1 + warmup);
+
+    profile.Install();
+
+    RunCache cache;
+    cache.Configure(cacheDir, argc, argv);
+    cache.AddOutput("flow-stats.txt");
+    if (cache.Restore()) {
+        return 0;
+    }
+
+    TreeTopology tree (nDevices, treeStride);
+    AddressPlan plan;
+    plan.AssignTree(tree);
+
     //GlobalValue::Bind ("SimulatorImplementationType", StringValue ("ns3::RealtimeSimulatorImpl"));
 
-    CsmaHelper csma;
+    SegmentHelper csma (segmentType);
     csma.SetChannelAttribute ("DataRate", StringValue ("10Mbps"));
     csma.SetChannelAttribute ("Delay", TimeValue (MilliSeconds (10)));
 
@@ -126,12 +139,11 @@ int main(int argc, char *argv[])
     for (int i = 0; i < nodes.GetN(); i++) {
         NodeContainer tempNodes;
 
-        uint32_t firstChild = get_first_child(i, treeStride);
+        uint32_t firstChild = tree.GetFirstChild(i);
 
         tempNodes.Add(nodes.Get(i));
 
-        for(int j = 0; j < treeStride; j++){
-            if((firstChild+j) >= nodes.GetN()) break;
+        for(uint32_t j = 0; j < tree.GetNChildren(i); j++){
             std::cout << "Node " << i << ": creating child " << j << "\n";
             tempNodes.Add(nodes.Get(firstChild+j));
         }
@@ -140,8 +152,7 @@ int main(int argc, char *argv[])
             NetDeviceContainer devices = csma.Install(tempNodes);
             apDevices.Add(devices.Get(0));
 
-            for(int j = 1; j <= treeStride; j++){
-                if((firstChild+j) >= nodes.GetN()) break;
+            for(uint32_t j = 1; j <= tree.GetNChildren(i); j++){
                 staDevices.Add(devices.Get(j));
             }
         }
@@ -152,71 +163,30 @@ int main(int argc, char *argv[])
     ****/
 
     for (int i = 0; i < nodes.GetN(); i++) {
-        std::stringstream cmd;
-
-        uint32_t firstChild = get_first_child(i, treeStride);
+        uint32_t firstChild = tree.GetFirstChild(i);
 
-        if(i == 0){
-            cmd << "link set dev sim0 up";
-            LinuxStackHelper::RunIp (nodes.Get (i), Seconds (1), cmd.str());
-            cmd.str(std::string());
-            cmd << "addr add 10.1." << i + 1 << ".1/24 broadcast 10.1." << i + 1 << ".255 dev sim0";
-        } else {
-            cmd << "link set dev sim1 up";
-            LinuxStackHelper::RunIp (nodes.Get (i), Seconds (1), cmd.str());
-            cmd.str(std::string());
-            cmd << "addr add 10.1." << i + 1 << ".1/24 broadcast 10.1." << i + 1 << ".255 dev sim1";
+        if(!plan.HasSegment(i)){
+            continue;
         }
-        std::cout << "NODE " << i + 1 << ": " << cmd.str() << std::endl;
-
-        LinuxStackHelper::RunIp (nodes.Get (i), Seconds (2), cmd.str());
+        Ipv4Prefix segment = plan.GetSegment(i);
 
-        std::cout << "FirstChild: " << firstChild << "\n";
-        for(int j = 0; j < treeStride; j++){
-            if((firstChild + j) >= nodes.GetN()){
-                std::cout << "FirstChild: " << firstChild << " Nodes: " << nodes.GetN() << "\n";
-                break;
-            }
+        /*The root's segment is on sim0, the other nodes have their uplink there*/
+        std::string dev = i == 0 ? "sim0" : "sim1";
+        agent.SetLink (nodes.Get (i), Seconds (0), dev, true);
+        agent.AddAddress (nodes.Get (i), Seconds (0), dev, segment, plan.GetSegmentHost());
 
-            cmd.str(std::string());
-            cmd << "link set dev sim0 up";
-            LinuxStackHelper::RunIp (nodes.Get (firstChild+j), Seconds (1), cmd.str());
-
-            cmd.str(std::string());
-            cmd << "addr add 10.1." << i + 1 << "." << firstChild + j + 1 << "/24 broadcast 10.1." << i + 1 << ".255 dev sim0";
-            std::cout << "NODE " << firstChild + j + 1 << ": " << cmd.str() << std::endl;
-            LinuxStackHelper::RunIp (nodes.Get (firstChild+j), Seconds (2), cmd.str());
+        for(uint32_t j = 0; j < tree.GetNChildren(i); j++){
+            agent.SetLink (nodes.Get (firstChild+j), Seconds (0), "sim0", true);
+            agent.AddAddress (nodes.Get (firstChild+j), Seconds (0), "sim0", segment, plan.GetUplinkHost(firstChild+j));
         }
     }
 
 
     /**
     * Setup Routing
+    * The addresses above give every node its connected segment routes.
     **/
 
-    for (int i = 0; i < nodes.GetN(); i++) {
-        std::stringstream cmd;
-        int parent = get_parent(i, treeStride) + 1;
-        if(parent >= 1) {
-            //cmd << "route add default via 10.1." << parent << ".1 dev sim0";
-            //std::cout << "Adding to Node: " << i << std::endl;
-            //std::cout << cmd.str() << std::endl;
-            //LinuxStackHelper::RunIp (nodes.Get (i), Seconds (4), cmd.str());
-            //cmd.str(std::string());
-            cmd << "route add 10.1." << i + 1 << ".0/24 dev sim1";
-            std::cout << "NODE " << i + 1 << ": " << cmd.str() << std::endl;
-            LinuxStackHelper::RunIp (nodes.Get (i), Seconds (3), cmd.str());
-            cmd.str(std::string());
-            cmd << "route add 10.1." << parent << ".0/24 dev sim0";
-            std::cout << "NODE " << i + 1 << ": " << cmd.str() << std::endl;
-            LinuxStackHelper::RunIp (nodes.Get (i), Seconds (3), cmd.str());
-        } else {
-            cmd << "route add 10.1.1.0/24 dev sim0";
-            std::cout << "NODE " << i + 1 << ": " << cmd.str() << std::endl;
-            LinuxStackHelper::RunIp (nodes.Get (i), Seconds (3), cmd.str());
-        }
-    }
-
     NetDeviceContainer gatewayDevices;
 
     /*Add Gateway Routers*/
@@ -224,38 +194,23 @@ int main(int argc, char *argv[])
     //pointToPoint.SetChannelAttribute ("DataRate", StringValue ("100Mbps"));
     //pointToPoint.SetChannelAttribute ("Delay", TimeValue (MilliSeconds (30)));
     for (int i = 0; i < routers.GetN(); i++){
-        std::stringstream cmd;
-        std::stringstream tempAddress;
-
-        NetDeviceContainer dev = pointToPoint.Install(nodes.Get(0), routers.Get(i));
-
-        cmd << "link set dev sim" << i + 1 << " up";
-        LinuxStackHelper::RunIp (nodes.Get (0), Seconds (1), cmd.str());
-
-        cmd.str(std::string());
-        cmd << "link set dev sim0 up";
-        LinuxStackHelper::RunIp (routers.Get(i), Seconds (1), cmd.str());
-
-        cmd.str(std::string());
-        cmd << "addr add 192.168." << i + 1 << ".1/24 broadcast 192.168." << i + 1 << ".255 dev sim" << i + 1;
-        std::cout << "NODE 1: " << cmd.str() << std::endl;
-        LinuxStackHelper::RunIp (nodes.Get(0), Seconds (2), cmd.str());
+        std::stringstream dev;
 
-        cmd.str(std::string());
-        cmd << "addr add 192.168." << i + 1 << ".2/24 broadcast 192.168." << i + 1 << ".255 dev sim0";
-        std::cout << "Router " << i + 1 << ": " << cmd.str() << std::endl;
-        LinuxStackHelper::RunIp (routers.Get(i), Seconds (2), cmd.str());
+        /*Node 0 is host 1 and the router host 2 of each link*/
+        Ipv4Prefix link = plan.Allocate(AddressPlan::GATEWAY, 30);
 
-        cmd.str(std::string());
-        tempAddress << "192.168." << i + 1 << ".0";
-        cmd << "route add default via 192.168." << i + 1 << ".2 dev sim" << i + 1 << " metric " << i + 1;
+        NetDeviceContainer devices = pointToPoint.Install(nodes.Get(0), routers.Get(i));
+        dev << "sim" << i + 1;
 
-        std::cout << "NODE " << 1 << ": " << cmd.str() << std::endl;
+        agent.SetLink (nodes.Get (0), Seconds (0), dev.str(), true);
+        agent.SetLink (routers.Get (i), Seconds (0), "sim0", true);
 
-        gatewayDevices.Add(dev);
+        agent.AddAddress (nodes.Get (0), Seconds (0), dev.str(), link, 1);
+        agent.AddAddress (routers.Get (i), Seconds (0), "sim0", link, 2);
 
-        LinuxStackHelper::RunIp (nodes.Get(0), Seconds (10), cmd.str());
+        gatewayDevices.Add(devices);
 
+        agent.AddRoute (nodes.Get (0), start + Seconds (5), Ipv4Prefix (), link.GetHost(2), dev.str(), ConfigAgent::MAIN_TABLE, i + 1);
     }
 
     //Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
@@ -264,14 +219,13 @@ int main(int argc, char *argv[])
     dce.SetStackSize(1 << 20);
     appHelper.SetStackSize(1 << 20);
 
-    stack.SysctlSet(nodes, ".net.ipv4.conf.all.forwarding", "1");
-    stack.SysctlSet(nodes, ".net.ipv6.conf.all.disable_ipv6", "1");
+    SysctlProfile::Lookup("router").Apply(nodes);
 
     for (int i = 0; i < allHosts.GetN(); i++) {
-        LinuxStackHelper::RunIp (allHosts.Get(i), Seconds (4), "route show table main");
-        LinuxStackHelper::RunIp (allHosts.Get(i), Seconds (4), "route show table local");
-        LinuxStackHelper::RunIp (allHosts.Get(i), Seconds (4), "rule show");
-        LinuxStackHelper::RunIp (allHosts.Get(i), Seconds (4), "addr show");
+        ipBatch.Add (allHosts.Get(i), Seconds (0.5), "route show table main");
+        ipBatch.Add (allHosts.Get(i), Seconds (0.5), "route show table local");
+        ipBatch.Add (allHosts.Get(i), Seconds (0.5), "rule show");
+        ipBatch.Add (allHosts.Get(i), Seconds (0.5), "addr show");
     }
 
     /*
@@ -353,16 +307,42 @@ int main(int argc, char *argv[])
         std::cout << "Installed in " << i << "\n";
     }
 
-    apps.Start(Seconds (5));
+    apps.Start(start);
     std::cout << "DONE\n";
 
-    csma.EnablePcap("dce-mpdd-nested-csma", apDevices, true);
+    if(pcap){
+        csma.EnablePcap("dce-mpdd-nested-csma", apDevices, true);
+    }
+    FlowStats stats;
+    if(flowStats){
+        stats.Watch(apDevices, "dce-mpdd-nested-csma");
+    }
 
     //pointToPoint.EnablePcapAll("dce-mpdd-nested-ptp", true);
 
-    Simulator::Stop(Seconds(15));
+    ipBatch.Install ();
+    agent.Install ();
+
+    /*Stop once dissemination has settled on the tree*/
+    NetDeviceContainer treeDevices (apDevices);
+    treeDevices.Add(staDevices);
+    StopController stop (Seconds (stopTime));
+    stop.AddQuiescence(treeDevices, "mpdd", start, Seconds (quietInterval), quietPackets);
+    stop.Install();
+
+    profile.CountProcesses();
+    profile.Phase("configure");
+    profile.PhaseAt(start, "traffic");
     Simulator::Run();
+    profile.Phase("output");
+    stop.Report();
+    if(flowStats){
+        stats.Write("flow-stats.txt");
+    }
+    profile.Phase("destroy");
     Simulator::Destroy();
+    profile.Report();
+    cache.Store();
 
     return 0;
 }
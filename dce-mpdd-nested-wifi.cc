@@ -22,42 +22,16 @@
 #include <string>
 #include <sstream>
 
-using namespace ns3;
-
-uint32_t
-get_height(uint32_t stride, uint32_t nodes)
-{
-    /*h = logk(k-1) + logk(n) -1*/
-    return (log(stride-1) / log(stride)) + (log(nodes) / log(stride));
-}
-
-uint32_t
-get_leaves(uint32_t stride, uint32_t height)
-{
-    return pow(stride, height);
-}
-
-int
-get_parent(int node, int stride)
-{
-    if(node <= 0) return -1;
-    return (uint32_t)(floor((node-1)/stride));
-}
-
-uint32_t
-get_first_child(int node, int stride)
-{
-    return (uint32_t)(node*stride)+1;
-}
+#include "ip-batch-helper.h"
+#include "run-cache.h"
+#include "tree-topology.h"
+#include "address-plan.h"
+#include "sysctl-profile.h"
+#include "stop-controller.h"
+#include "run-profile.h"
+#include "config-agent.h"
 
-uint32_t
-is_leaf(uint32_t stride, uint32_t nodes, uint32_t nodeIdx)
-{
-    uint32_t height = get_height(stride, nodes);
-    uint32_t leaves = get_leaves(stride, height);
-
-    return (nodes-leaves) < nodeIdx ? 1 : 0;
-}
+using namespace ns3;
 
 struct ModelNode;
 
@@ -86,15 +60,17 @@ y = r sin (theta),
 #else
 #define ROUND(d) d
 #endif
-int build_model(int nDevices, int nStride, Ptr<ListPositionAllocator> positionAlloc)
+int build_model(const TreeTopology &tree, Ptr<ListPositionAllocator> positionAlloc)
 {
+    int nDevices = tree.GetN();
+    int nStride = tree.GetStride();
     int j = 0;
     float initX = 0.00;
     float initY = 0.00;
     float degree_between = nStride/POLAR_TOTAL;
     float start_degree = 0;
     float vectorMulti = 15.00;
-    float vectorLength = (get_height(nStride, nDevices)+1)*vectorMulti;
+    float vectorLength = (tree.GetHeight()+1)*vectorMulti;
     std::vector<struct ModelNode> nodeVector;
 
     for (long i = 0; i < nDevices; i++) {
@@ -113,10 +89,10 @@ int build_model(int nDevices, int nStride, Ptr<ListPositionAllocator> positionAl
             struct ModelNode n;
             struct ModelNode pNode;
 
-            int p = get_parent(i, nStride);
+            int p = tree.GetParent(i);
             std::cout << "NODE: " << i << "\n";
 
-            int c = get_first_child(p, nStride);
+            int c = tree.GetFirstChild(p);
             int child_index = i - c;
             std::cout << "\tChild Index: " << child_index << "\n";
 
@@ -184,6 +160,8 @@ int main(int argc, char *argv[])
     Ptr<ErrorRateModel> error = CreateObject<YansErrorRateModel> ();
 
     std::stringstream cmdStream;
+    IpBatchHelper ipBatch;
+    ConfigAgent agent;
 
     uint32_t nDevices = 7;
     uint32_t treeStride = 2;
@@ -191,14 +169,45 @@ int main(int argc, char *argv[])
     uint32_t nRootInterfaces = 2;
 
 
+    double stopTime = 15.0;
+    double quietInterval = 1.0;
+    uint32_t quietPackets = 0;
+    double warmup = 0;
+    bool pcap = true;
+
+    std::string cacheDir;
+
     CommandLine cmd;
+    RunProfile profile ("dce-mpdd-nested-wifi");
+    profile.AddOptions(cmd);
     cmd.AddValue("devices", "Number of wifi devices", nDevices);
     cmd.AddValue("stride", "Tree Stride", treeStride);
     cmd.AddValue("interfaces", "Number of gateway interfaces for non root devices", nInterfaces);
     cmd.AddValue("root_interfaces", "Number of gateway interfaces for root device", nRootInterfaces);
+    cmd.AddValue("stopTime", "Latest stop time; the run ends earlier once the MPDD tree goes quiet", stopTime);
+    cmd.AddValue("warmup", "Idle seconds between the configuration at 0 and the MPDD daemons starting", warmup);
+    cmd.AddValue("quietInterval", "Seconds per quiescence check", quietInterval);
+    cmd.AddValue("quietPackets", "Tree packets per interval still counted as quiet, e.g. for periodic hellos", quietPackets);
+    cmd.AddValue("pcap", "Write pcaps of the AP and STA devices", pcap);
+    cmd.AddValue("cache", "Directory of cached run results, disabled if empty", cacheDir);
 
     cmd.Parse(argc, argv);
 
+    /*Configuration is all at 0; the daemons follow 1s later, after any warm-up*/
+    Time start = Seconds (1 + warmup);
+
+    profile.Install();
+
+    RunCache cache;
+    cache.Configure(cacheDir, argc, argv);
+    if (cache.Restore()) {
+        return 0;
+    }
+
+    TreeTopology tree (nDevices, treeStride);
+    AddressPlan plan;
+    plan.AssignTree(tree);
+
     //GlobalValue::Bind ("SimulatorImplementationType", StringValue ("ns3::RealtimeSimulatorImpl"));
 
     NodeContainer nodes, routers, allHosts;
@@ -228,7 +237,7 @@ int main(int argc, char *argv[])
     #endif
 
 
-    build_model(nDevices, treeStride, positionAlloc);
+    build_model(tree, positionAlloc);
 
     wifi.SetStandard (WIFI_PHY_STANDARD_80211g);
     wifi.SetRemoteStationManager ("ns3::ArfWifiManager");
@@ -242,19 +251,13 @@ int main(int argc, char *argv[])
     * Setup tree structure
     ****/
     for (int i = 0; i < nodes.GetN(); i++) {
-        int k = 0;
+        int k = tree.GetNChildren(i);
         std::stringstream tempWifiName;
         tempWifiName << "" << wifiBaseName << "-" << i;
         Ssid apSsid = Ssid(tempWifiName.str());
 
         Ptr<YansWifiChannel> chan = wifiChannel.Create();
 
-        uint32_t firstChild = get_first_child(i, treeStride);
-        for(int j = 0; j < treeStride; j++){
-            if((firstChild+j) >= nodes.GetN()) break;
-            k++;
-        }
-
         /*Avoid adding WiFi AP's if there won't be any nodes connecting*/
         if(k > 0){
             wifiPhy.SetChannel(chan);
@@ -270,7 +273,7 @@ int main(int argc, char *argv[])
         }
         /*Ignore root interfaces*/
         if(i != 0){
-            uint32_t parent = get_parent(i, treeStride);
+            uint32_t parent = tree.GetParent(i);
             //std::cout << "Parent of " << i << " is " << parent << std::endl;
             tempWifiName.str(std::string());
             tempWifiName << "" << wifiBaseName << "-" << parent;
@@ -298,73 +301,35 @@ int main(int argc, char *argv[])
     ****/
 
     for (int i = 0; i < nodes.GetN(); i++) {
-        std::stringstream cmd;
-
-        uint32_t firstChild = get_first_child(i, treeStride);
-
-        if(firstChild + i <= nodes.GetN()){
-            cmd << "link set dev sim0 up";
-            LinuxStackHelper::RunIp (nodes.Get (i), Seconds (1), cmd.str());
-            cmd.str(std::string());
-            cmd << "addr add 10.1." << i + 1 << ".1/24 broadcast 10.1." << i + 1 << ".255 dev sim0";
+        uint32_t firstChild = tree.GetFirstChild(i);
 
-            std::cout << "NODE " << i + 1 << ": " << cmd.str() << std::endl;
-
-            LinuxStackHelper::RunIp (nodes.Get (i), Seconds (2), cmd.str());
+        if(!plan.HasSegment(i)){
+            continue;
         }
+        Ipv4Prefix segment = plan.GetSegment(i);
 
-        std::cout << "FirstChild: " << firstChild << "\n";
-        for(int j = 0; j < treeStride; j++){
-            if((firstChild + j) >= nodes.GetN()){
-                std::cout << "FirstChild: " << firstChild << " Nodes: " << nodes.GetN() << "\n";
-                break;
-            }
+        agent.SetLink (nodes.Get (i), Seconds (0), "sim0", true);
+        agent.AddAddress (nodes.Get (i), Seconds (0), "sim0", segment, plan.GetSegmentHost());
 
-            uint32_t fc = get_first_child(firstChild + j, treeStride);
+        for(uint32_t j = 0; j < tree.GetNChildren(i); j++){
+            uint32_t fc = tree.GetFirstChild(firstChild + j);
             std::string iff = "sim1";
 
             if(fc + firstChild + j > nodes.GetN()){
                 iff = "sim0";
             }
 
-            cmd.str(std::string());
-            cmd << "link set dev " << iff << " up";
-            LinuxStackHelper::RunIp (nodes.Get (firstChild+j), Seconds (1), cmd.str());
-
-            cmd.str(std::string());
-            cmd << "addr add 10.1." << i + 1 << "." << firstChild + j + 1 << "/24 broadcast 10.1." << i + 1 << ".255 dev " << iff << "";
-            std::cout << "NODE " << firstChild + j + 1 << ": " << cmd.str() << std::endl;
-            LinuxStackHelper::RunIp (nodes.Get (firstChild+j), Seconds (2), cmd.str());
+            agent.SetLink (nodes.Get (firstChild+j), Seconds (0), iff, true);
+            agent.AddAddress (nodes.Get (firstChild+j), Seconds (0), iff, segment, plan.GetUplinkHost(firstChild+j));
         }
     }
 
 
     /**
     * Setup Routing
+    * The addresses above give every node its connected segment routes.
     **/
 
-    for (int i = 0; i < nodes.GetN(); i++) {
-        std::stringstream cmd;
-        int parent = get_parent(i, treeStride) + 1;
-        if(parent >= 1) {
-            uint32_t firstChild = get_first_child(i, treeStride);
-            if(firstChild + i <= nodes.GetN()){
-                cmd.str(std::string());
-                cmd << "route add 10.1." << i + 1 << ".0/24 dev sim1";
-                std::cout << "NODE " << i + 1 << ": " << cmd.str() << std::endl;
-                LinuxStackHelper::RunIp (nodes.Get (i), Seconds (3), cmd.str());
-            }
-            cmd.str(std::string());
-            cmd << "route add 10.1." << parent << ".0/24 dev sim0";
-            std::cout << "NODE " << i + 1 << ": " << cmd.str() << std::endl;
-            LinuxStackHelper::RunIp (nodes.Get (i), Seconds (3), cmd.str());
-        } else {
-            cmd << "route add 10.1.1.0/24 dev sim0";
-            std::cout << "NODE " << i + 1 << ": " << cmd.str() << std::endl;
-            LinuxStackHelper::RunIp (nodes.Get (i), Seconds (3), cmd.str());
-        }
-    }
-
     NetDeviceContainer gatewayDevices;
 
     /*Add Gateway Routers*/
@@ -372,43 +337,23 @@ int main(int argc, char *argv[])
     //pointToPoint.SetChannelAttribute ("DataRate", StringValue ("100Mbps"));
     //pointToPoint.SetChannelAttribute ("Delay", TimeValue (MilliSeconds (30)));
     for (int i = 0; i < routers.GetN(); i++){
-        std::stringstream cmd;
-        std::stringstream tempAddress;
+        std::stringstream dev;
 
-        NetDeviceContainer dev = pointToPoint.Install(nodes.Get(0), routers.Get(i));
+        /*Node 0 is host 1 and the router host 2 of each link*/
+        Ipv4Prefix link = plan.Allocate(AddressPlan::GATEWAY, 30);
 
-        cmd << "link set dev sim" << i + 1 << " up";
-        LinuxStackHelper::RunIp (nodes.Get (0), Seconds (1), cmd.str());
+        NetDeviceContainer devices = pointToPoint.Install(nodes.Get(0), routers.Get(i));
+        dev << "sim" << i + 1;
 
+        agent.SetLink (nodes.Get (0), Seconds (0), dev.str(), true);
+        agent.SetLink (routers.Get (i), Seconds (0), "sim0", true);
 
-        cmd.str(std::string());
-        cmd << "link set dev sim0 up";
-        LinuxStackHelper::RunIp (routers.Get(i), Seconds (1), cmd.str());
+        agent.AddAddress (nodes.Get (0), Seconds (0), dev.str(), link, 1);
+        agent.AddAddress (routers.Get (i), Seconds (0), "sim0", link, 2);
 
-        cmd.str(std::string());
-        cmd << "addr add 192.168." << i + 1 << ".1/24 broadcast 192.168." << i + 1 << ".255 dev sim" << i + 1;
-        std::cout << "NODE 1: " << cmd.str() << std::endl;
-        LinuxStackHelper::RunIp (nodes.Get(0), Seconds (2), cmd.str());
-
-
-        cmd.str(std::string());
-        cmd << "addr add 192.168." << i + 1 << ".2/24 broadcast 192.168." << i + 1 << ".255 dev sim0";
-        std::cout << "Router " << i + 1 << ": " << cmd.str() << std::endl;
-        LinuxStackHelper::RunIp (routers.Get(i), Seconds (2), cmd.str());
-
-
-
-        cmd.str(std::string());
-        tempAddress << "192.168." << i + 1 << ".0";
-        cmd << "route add default via 192.168." << i + 1 << ".2 dev sim" << i + 1 << " metric " << i + 1;
-
-        std::cout << "NODE " << 1 << ": " << cmd.str() << std::endl;
-
-
-        gatewayDevices.Add(dev);
-
-        LinuxStackHelper::RunIp (nodes.Get(0), Seconds (10), cmd.str());
+        gatewayDevices.Add(devices);
 
+        agent.AddRoute (nodes.Get (0), start + Seconds (5), Ipv4Prefix (), link.GetHost(2), dev.str(), ConfigAgent::MAIN_TABLE, i + 1);
     }
 
     //Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
@@ -417,17 +362,16 @@ int main(int argc, char *argv[])
     dce.SetStackSize(1 << 20);
     appHelper.SetStackSize(1 << 20);
 
-    stack.SysctlSet(nodes, ".net.ipv4.conf.all.forwarding", "1");
-    stack.SysctlSet(nodes, ".net.ipv6.conf.all.disable_ipv6", "1");
+    SysctlProfile::Lookup("router").Apply(nodes);
 
 
     for (int i = 0; i < allHosts.GetN(); i++) {
-        LinuxStackHelper::RunIp (allHosts.Get(i), Seconds (4), "route show table main");
-        LinuxStackHelper::RunIp (allHosts.Get(i), Seconds (4), "route show table local");
+        ipBatch.Add (allHosts.Get(i), Seconds (0.5), "route show table main");
+        ipBatch.Add (allHosts.Get(i), Seconds (0.5), "route show table local");
 
-        LinuxStackHelper::RunIp (allHosts.Get(i), Seconds (4), "rule show");
+        ipBatch.Add (allHosts.Get(i), Seconds (0.5), "rule show");
 
-        LinuxStackHelper::RunIp (allHosts.Get(i), Seconds (4), "addr show");
+        ipBatch.Add (allHosts.Get(i), Seconds (0.5), "addr show");
     }
 
     /*
@@ -497,7 +441,7 @@ int main(int argc, char *argv[])
         dce.IgnoreInterface("sit0");
         dce.IgnoreInterface("ip6tnl0");
 
-        uint32_t firstChild = get_first_child(i, treeStride);
+        uint32_t firstChild = tree.GetFirstChild(i);
         if(firstChild + i <= nodes.GetN()){
             dce.DisseminationInterface("sim0");
             std::cout << "Set diss to sim0\n";
@@ -510,16 +454,35 @@ int main(int argc, char *argv[])
         std::cout << "Installed in " << i << "\n";
     }
 
-    apps.Start(Seconds (5));
+    apps.Start(start);
     std::cout << "DONE\n";
 
-    wifiPhy.EnablePcap("dce-mpdd-nested-wifi-ap", apDevices, true);
-    wifiPhy.EnablePcap("dce-mpdd-nested-wifi-sta", staDevices, true);
+    if(pcap){
+        wifiPhy.EnablePcap("dce-mpdd-nested-wifi-ap", apDevices, true);
+        wifiPhy.EnablePcap("dce-mpdd-nested-wifi-sta", staDevices, true);
+    }
     //pointToPoint.EnablePcapAll("dce-mpdd-nested-ptp", true);
 
-    Simulator::Stop(Seconds(15));
+    ipBatch.Install ();
+    agent.Install ();
+
+    /*Stop once dissemination has settled on the tree*/
+    NetDeviceContainer treeDevices (apDevices);
+    treeDevices.Add(staDevices);
+    StopController stop (Seconds (stopTime));
+    stop.AddQuiescence(treeDevices, "mpdd", start, Seconds (quietInterval), quietPackets);
+    stop.Install();
+
+    profile.CountProcesses();
+    profile.Phase("configure");
+    profile.PhaseAt(start, "traffic");
     Simulator::Run();
+    profile.Phase("output");
+    stop.Report();
+    profile.Phase("destroy");
     Simulator::Destroy();
+    profile.Report();
+    cache.Store();
 
     return 0;
 }
@@ -18,10 +18,18 @@
 #include "ns3/point-to-point-module.h"
 #include "ns3/applications-module.h"
 
-#include <math.h>
 #include <string>
 #include <sstream>
 
+#include "ip-batch-helper.h"
+#include "run-cache.h"
+#include "tree-topology.h"
+#include "address-plan.h"
+#include "sysctl-profile.h"
+#include "stop-controller.h"
+#include "flow-stats.h"
+#include "segment-helper.h"
+
 
 using namespace ns3;
 
@@ -31,41 +39,6 @@ using namespace ns3;
 
 */
 
-uint32_t
-get_height(uint32_t stride, uint32_t nodes)
-{
-    /*h = logk(k-1) + logk(n) -1*/
-    return (log(stride-1) / log(stride)) + (log(nodes) / log(stride));
-}
-
-uint32_t
-get_leaves(uint32_t stride, uint32_t height)
-{
-    return pow(stride, height);
-}
-
-int
-get_parent(int node, int stride)
-{
-    if(node <= 0) return -1;
-    return (uint32_t)(floor((node-1)/stride));
-}
-
-uint32_t
-get_first_child(int node, int stride)
-{
-    return (uint32_t)(node*stride)+1;
-}
-
-uint32_t
-is_leaf(uint32_t stride, uint32_t nodes, uint32_t nodeIdx)
-{
-    uint32_t height = get_height(stride, nodes);
-    uint32_t leaves = get_leaves(stride, height);
-
-    return (nodes-leaves) < nodeIdx ? 1 : 0;
-}
-
 int main(int argc, char *argv[])
 {
     DceApplicationHelper appHelper;
@@ -78,12 +51,22 @@ int main(int argc, char *argv[])
     NetDeviceContainer staDevices;
 
     std::stringstream cmdStream;
+    IpBatchHelper ipBatch;
 
     uint32_t nDevices = 7;
     uint32_t treeStride = 2;
     uint32_t nInterfaces = 0;
     uint32_t nRootInterfaces = 2;
 
+    double stopTime = 15.0;
+    double quietInterval = 1.0;
+    uint32_t quietPackets = 0;
+    bool pcap = true;
+    bool flowStats = true;
+
+    std::string segmentType = "csma";
+    std::string cacheDir;
+
     CommandLine cmd;
     cmd.AddValue("devices", "Number of wifi devices", nDevices);
     cmd.AddValue("stride", "Tree Stride", treeStride);
@@ -91,12 +74,30 @@ int main(int argc, char *argv[])
         "Number of gateway interfaces for non root devices", nInterfaces);
     cmd.AddValue("root_interfaces",
         "Number of gateway interfaces for root device", nRootInterf);
+    cmd.AddValue("stopTime", "Latest stop time; the run ends earlier once the MPDD tree goes quiet", stopTime);
+    cmd.AddValue("quietInterval", "Seconds per quiescence check", quietInterval);
+    cmd.AddValue("quietPackets", "Tree packets per interval still counted as quiet, e.g. for periodic hellos", quietPackets);
+    cmd.AddValue("pcap", "Write pcaps of the watched devices", pcap);
+    cmd.AddValue("flowStats", "Write per flow throughput, retransmission and RTT bins to flow-stats.txt", flowStats);
+    cmd.AddValue("segment", "Tree segments: csma, or broadcast for a shared medium without collisions or backoff", segmentType);
+    cmd.AddValue("cache", "Directory of cached run results, disabled if empty", cacheDir);
 
     cmd.Parse(argc, argv);
 
+    RunCache cache;
+    cache.Configure(cacheDir, argc, argv);
+    cache.AddOutput("flow-stats.txt");
+    if (cache.Restore()) {
+        return 0;
+    }
+
+    TreeTopology tree (nDevices, treeStride);
+    AddressPlan plan;
+    plan.AssignTree(tree);
+
     //GlobalValue::Bind ("SimulatorImplementationType", StringValue ("ns3::RealtimeSimulatorImpl"));
 
-    CsmaHelper csma;
+    SegmentHelper csma (segmentType);
     csma.SetChannelAttribute ("DataRate", StringValue ("10Mbps"));
     csma.SetChannelAttribute ("Delay", TimeValue (MilliSeconds (10)));
 
@@ -130,12 +131,11 @@ int main(int argc, char *argv[])
     for (int i = 0; i < nodes.GetN(); i++) {
         NodeContainer tempNodes;
 
-        uint32_t firstChild = get_first_child(i, treeStride);
+        uint32_t firstChild = tree.GetFirstChild(i);
 
         tempNodes.Add(nodes.Get(i));
 
-        for(int j = 0; j < treeStride; j++){
-            if((firstChild+j) >= nodes.GetN()) break;
+        for(uint32_t j = 0; j < tree.GetNChildren(i); j++){
             tempNodes.Add(nodes.Get(firstChild+j));
         }
 
@@ -143,8 +143,7 @@ int main(int argc, char *argv[])
             NetDeviceContainer devices = csma.Install(tempNodes);
             apDevices.Add(devices.Get(0));
 
-            for(int j = 1; j <= treeStride; j++){
-                if((firstChild+j) >= nodes.GetN()) break;
+            for(uint32_t j = 1; j <= tree.GetNChildren(i); j++){
                 staDevices.Add(devices.Get(j));
             }
         }
@@ -157,38 +156,39 @@ int main(int argc, char *argv[])
     for (int i = 0; i < nodes.GetN(); i++) {
         std::stringstream cmd;
 
-        uint32_t firstChild = get_first_child(i, treeStride);
+        uint32_t firstChild = tree.GetFirstChild(i);
+
+        if(!plan.HasSegment(i)){
+            continue;
+        }
+        Ipv4Prefix segment = plan.GetSegment(i);
+        std::string broadcast = Ipv4ToString(segment.GetBroadcast());
 
         if(i == 0){
             cmd << "link set dev sim0 up";
-            LinuxStackHelper::RunIp (nodes.Get (i), Seconds (1), cmd.str());
+            ipBatch.Add (nodes.Get (i), Seconds (1), cmd.str());
             cmd.str(std::string());
-            cmd << "addr add 10.1." << i + 1 << ".1/24 broadcast 10.1." << i + 1 << ".255 dev sim0";
+            cmd << "addr add " << segment.GetHostString(plan.GetSegmentHost()) << " broadcast " << broadcast << " dev sim0";
         } else {
             cmd << "link set dev sim1 up";
-            LinuxStackHelper::RunIp (nodes.Get (i), Seconds (1), cmd.str());
+            ipBatch.Add (nodes.Get (i), Seconds (1), cmd.str());
             cmd.str(std::string());
-            cmd << "addr add 10.1." << i + 1 << ".1/24 broadcast 10.1." << i + 1 << ".255 dev sim1";
+            cmd << "addr add " << segment.GetHostString(plan.GetSegmentHost()) << " broadcast " << broadcast << " dev sim1";
         }
         std::cout << "NODE " << i + 1 << ": " << cmd.str() << std::endl;
 
-        LinuxStackHelper::RunIp (nodes.Get (i), Seconds (2), cmd.str());
+        ipBatch.Add (nodes.Get (i), Seconds (2), cmd.str());
 
         std::cout << "FirstChild: " << firstChild << "\n";
-        for(int j = 0; j < treeStride; j++){
-            if((firstChild + j) >= nodes.GetN()){
-                std::cout << "FirstChild: " << firstChild << " Nodes: " << nodes.GetN() << "\n";
-                break;
-            }
-
+        for(uint32_t j = 0; j < tree.GetNChildren(i); j++){
             cmd.str(std::string());
             cmd << "link set dev sim0 up";
-            LinuxStackHelper::RunIp (nodes.Get (firstChild+j), Seconds (1), cmd.str());
+            ipBatch.Add (nodes.Get (firstChild+j), Seconds (1), cmd.str());
 
             cmd.str(std::string());
-            cmd << "addr add 10.1." << i + 1 << "." << firstChild + j + 1 << "/24 broadcast 10.1." << i + 1 << ".255 dev sim0";
+            cmd << "addr add " << segment.GetHostString(plan.GetUplinkHost(firstChild+j)) << " broadcast " << broadcast << " dev sim0";
             std::cout << "NODE " << firstChild + j + 1 << ": " << cmd.str() << std::endl;
-            LinuxStackHelper::RunIp (nodes.Get (firstChild+j), Seconds (2), cmd.str());
+            ipBatch.Add (nodes.Get (firstChild+j), Seconds (2), cmd.str());
         }
     }
 
@@ -199,24 +199,26 @@ int main(int argc, char *argv[])
 
     for (int i = 0; i < nodes.GetN(); i++) {
         std::stringstream cmd;
-        int parent = get_parent(i, treeStride) + 1;
+        int parent = tree.GetParent(i) + 1;
         if(parent >= 1) {
             //cmd << "route add default via 10.1." << parent << ".1 dev sim0";
             //std::cout << "Adding to Node: " << i << std::endl;
             //std::cout << cmd.str() << std::endl;
-            //LinuxStackHelper::RunIp (nodes.Get (i), Seconds (4), cmd.str());
+            //ipBatch.Add (nodes.Get (i), Seconds (4), cmd.str());
             //cmd.str(std::string());
-            cmd << "route add 10.1." << i + 1 << ".0/24 dev sim1";
-            std::cout << "NODE " << i + 1 << ": " << cmd.str() << std::endl;
-            LinuxStackHelper::RunIp (nodes.Get (i), Seconds (3), cmd.str());
-            cmd.str(std::string());
-            cmd << "route add 10.1." << parent << ".0/24 dev sim0";
+            if(plan.HasSegment(i)){
+                cmd << "route add " << plan.GetSegment(i).ToString() << " dev sim1";
+                std::cout << "NODE " << i + 1 << ": " << cmd.str() << std::endl;
+                ipBatch.Add (nodes.Get (i), Seconds (3), cmd.str());
+                cmd.str(std::string());
+            }
+            cmd << "route add " << plan.GetSegment(parent - 1).ToString() << " dev sim0";
             std::cout << "NODE " << i + 1 << ": " << cmd.str() << std::endl;
-            LinuxStackHelper::RunIp (nodes.Get (i), Seconds (3), cmd.str());
-        } else {
-            cmd << "route add 10.1.1.0/24 dev sim0";
+            ipBatch.Add (nodes.Get (i), Seconds (3), cmd.str());
+        } else if(plan.HasSegment(i)) {
+            cmd << "route add " << plan.GetSegment(i).ToString() << " dev sim0";
             std::cout << "NODE " << i + 1 << ": " << cmd.str() << std::endl;
-            LinuxStackHelper::RunIp (nodes.Get (i), Seconds (3), cmd.str());
+            ipBatch.Add (nodes.Get (i), Seconds (3), cmd.str());
         }
     }
 
@@ -230,34 +232,38 @@ int main(int argc, char *argv[])
         std::stringstream cmd;
         std::stringstream tempAddress;
 
+        /*Node 0 is host 1 and the router host 2 of each link*/
+        Ipv4Prefix link = plan.Allocate(AddressPlan::GATEWAY, 30);
+        std::string linkBroadcast = Ipv4ToString(link.GetBroadcast());
+
         NetDeviceContainer dev = pointToPoint.Install(nodes.Get(0), routers.Get(i));
 
         cmd << "link set dev sim" << i + 1 << " up";
-        LinuxStackHelper::RunIp (nodes.Get (0), Seconds (1), cmd.str());
+        ipBatch.Add (nodes.Get (0), Seconds (1), cmd.str());
 
         cmd.str(std::string());
         cmd << "link set dev sim0 up";
-        LinuxStackHelper::RunIp (routers.Get(i), Seconds (1), cmd.str());
+        ipBatch.Add (routers.Get(i), Seconds (1), cmd.str());
 
         cmd.str(std::string());
-        cmd << "addr add 192.168." << i + 1 << ".1/24 broadcast 192.168." << i + 1 << ".255 dev sim" << i + 1;
+        cmd << "addr add " << link.GetHostString(1) << " broadcast " << linkBroadcast << " dev sim" << i + 1;
         std::cout << "NODE 1: " << cmd.str() << std::endl;
-        LinuxStackHelper::RunIp (nodes.Get(0), Seconds (2), cmd.str());
+        ipBatch.Add (nodes.Get(0), Seconds (2), cmd.str());
 
         cmd.str(std::string());
-        cmd << "addr add 192.168." << i + 1 << ".2/24 broadcast 192.168." << i + 1 << ".255 dev sim0";
+        cmd << "addr add " << link.GetHostString(2) << " broadcast " << linkBroadcast << " dev sim0";
         std::cout << "Router " << i + 1 << ": " << cmd.str() << std::endl;
-        LinuxStackHelper::RunIp (routers.Get(i), Seconds (2), cmd.str());
+        ipBatch.Add (routers.Get(i), Seconds (2), cmd.str());
 
         cmd.str(std::string());
-        tempAddress << "192.168." << i + 1 << ".0";
-        cmd << "route add default via 192.168." << i + 1 << ".2 dev sim" << i + 1 << " metric " << i + 1;
+        tempAddress << Ipv4ToString(link.network);
+        cmd << "route add default via " << Ipv4ToString(link.GetHost(2)) << " dev sim" << i + 1 << " metric " << i + 1;
 
         std::cout << "NODE " << 1 << ": " << cmd.str() << std::endl;
 
         gatewayDevices.Add(dev);
 
-        LinuxStackHelper::RunIp (nodes.Get(0), Seconds (10), cmd.str());
+        ipBatch.Add (nodes.Get(0), Seconds (10), cmd.str());
 
     }
 
@@ -267,14 +273,13 @@ int main(int argc, char *argv[])
     dce.SetStackSize(1 << 20);
     appHelper.SetStackSize(1 << 20);
 
-    stack.SysctlSet(nodes, ".net.ipv4.conf.all.forwarding", "1");
-    stack.SysctlSet(nodes, ".net.ipv6.conf.all.disable_ipv6", "1");
+    SysctlProfile::Lookup("router").Apply(nodes);
 
     for (int i = 0; i < allHosts.GetN(); i++) {
-        LinuxStackHelper::RunIp (allHosts.Get(i), Seconds (4), "route show table main");
-        LinuxStackHelper::RunIp (allHosts.Get(i), Seconds (4), "route show table local");
-        LinuxStackHelper::RunIp (allHosts.Get(i), Seconds (4), "rule show");
-        LinuxStackHelper::RunIp (allHosts.Get(i), Seconds (4), "addr show");
+        ipBatch.Add (allHosts.Get(i), Seconds (4), "route show table main");
+        ipBatch.Add (allHosts.Get(i), Seconds (4), "route show table local");
+        ipBatch.Add (allHosts.Get(i), Seconds (4), "rule show");
+        ipBatch.Add (allHosts.Get(i), Seconds (4), "addr show");
     }
 
     /*
@@ -359,13 +364,32 @@ int main(int argc, char *argv[])
     apps.Start(Seconds (5));
     std::cout << "DONE\n";
 
-    csma.EnablePcap("dce-mpdd-nested-csma", apDevices, true);
+    if(pcap){
+        csma.EnablePcap("dce-mpdd-nested-csma", apDevices, true);
+    }
+    FlowStats stats;
+    if(flowStats){
+        stats.Watch(apDevices, "dce-mpdd-nested-csma");
+    }
 
     //pointToPoint.EnablePcapAll("dce-mpdd-nested-ptp", true);
 
-    Simulator::Stop(Seconds(15));
+    ipBatch.Install ();
+
+    /*Stop once dissemination has settled on the tree*/
+    NetDeviceContainer treeDevices (apDevices);
+    treeDevices.Add(staDevices);
+    StopController stop (Seconds (stopTime));
+    stop.AddQuiescence(treeDevices, "mpdd", Seconds (5), Seconds (quietInterval), quietPackets);
+    stop.Install();
+
     Simulator::Run();
+    stop.Report();
+    if(flowStats){
+        stats.Write("flow-stats.txt");
+    }
     Simulator::Destroy();
+    cache.Store();
 
     return 0;
 }
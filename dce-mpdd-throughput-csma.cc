@@ -18,52 +18,27 @@
 #include "ns3/point-to-point-module.h"
 #include "ns3/applications-module.h"
 
-#include <math.h>
 #include <string>
 #include <sstream>
 
-using namespace ns3;
-
-uint32_t
-get_height(uint32_t stride, uint32_t nodes)
-{
-    /*h = logk(k-1) + logk(n) -1*/
-    return (log(stride-1) / log(stride)) + (log(nodes) / log(stride));
-}
-
-uint32_t
-get_leaves(uint32_t stride, uint32_t height)
-{
-    return pow(stride, height);
-}
-
-int
-get_parent(int node, int stride)
-{
-    if(node <= 0) return -1;
-    return (uint32_t)(floor((node-1)/stride));
-}
-
-uint32_t
-get_first_child(int node, int stride)
-{
-    return (uint32_t)(node*stride)+1;
-}
-
-uint32_t
-is_leaf(uint32_t stride, uint32_t nodes, uint32_t nodeIdx)
-{
-    uint32_t height = get_height(stride, nodes);
-    uint32_t leaves = get_leaves(stride, height);
+#include "ip-batch-helper.h"
+#include "run-cache.h"
+#include "tree-topology.h"
+#include "tree-routing.h"
+#include "address-plan.h"
+#include "sysctl-profile.h"
+#include "stop-controller.h"
+#include "bulk-sender.h"
+#include "throughput-reporter.h"
+#include "flow-stats.h"
+#include "ring-pcap.h"
+#include "pcapng-capture.h"
+#include "process-log.h"
+#include "run-profile.h"
+#include "config-agent.h"
+#include "segment-helper.h"
 
-    return (nodes-leaves) < nodeIdx ? 1 : 0;
-}
-
-void
-PrintTcpFlags (std::string key, std::string value)
-{
-    std::cout << key << "=" << value;
-}
+using namespace ns3;
 
 #define DIST_GATEWAYS_YES 1
 #define DIST_GATEWAYS_NO 0
@@ -74,73 +49,33 @@ PrintTcpFlags (std::string key, std::string value)
 #define MODE_MPTCP 3
 #define MODE_MPTCP_MPDP 4
 
-void add_route_via(ns3::Ptr<ns3::Node> n, int this_node, int dev, int node_id, int stride, NodeContainer nodes)
+/*Install this node's precomputed routes to its descendants' segments, via the child on the way*/
+void add_tree_routes(ConfigAgent &agent, const TreeRouting &routing, const AddressPlan &plan, ns3::Ptr<ns3::Node> n, int this_node, int dev)
 {
-    std::stringstream cmd;
-    cmd.str(std::string());
-
-    if (this_node < node_id){
-        int cn = 0;
-        int tmp_parent = get_parent(node_id, stride);
-
-        cn = tmp_parent;
-        /*is a child of a child*/
-        while(tmp_parent > this_node) {
-            tmp_parent = get_parent(tmp_parent, stride);
-            if(tmp_parent > this_node) cn = tmp_parent;
-            else break;
-        }
+    const std::vector<TreeRouting::Route> &routes = routing.GetRoutes(this_node);
+    std::stringstream devName;
+    devName << "sim" << dev;
 
-        if(cn == this_node){
-            cmd << "route add 10.1." << node_id + 1 << ".0/24 via 10.1." << this_node + 1 << "." << node_id + 1 << " dev sim" << dev << "";
-        } else {
-            cmd << "route add 10.1." << node_id + 1 << ".0/24 via 10.1." << this_node + 1 << "." << cn + 1 << " dev sim" << dev << "";
-        }
-
-        LinuxStackHelper::RunIp (n, Seconds (2), cmd.str());
-    } else {
-        cmd << "route add 10.1." << node_id + 1 << ".0/24 dev sim" << dev << "";
-        LinuxStackHelper::RunIp (n, Seconds (2), cmd.str());
-    }
-
-    int child = get_first_child(node_id, stride);
-    for(int i = 0; i < stride; i++){
-        if((child  + i) >= nodes.GetN()) break;
-        add_route_via(n, this_node, dev, child + i, stride, nodes);
+    for (std::vector<TreeRouting::Route>::const_iterator it = routes.begin(); it != routes.end(); ++it) {
+        agent.AddRoute (n, Seconds (0), it->prefix, plan.GetUplinkAddress(it->nextHop), devName.str());
     }
 }
 
-void add_route(ns3::Ptr<ns3::Node> n, int dev, int node_id, int stride, NodeContainer nodes)
+/*Route every segment in node_id's subtree out of dev*/
+void add_subtree_routes(ConfigAgent &agent, const TreeRouting &routing, ns3::Ptr<ns3::Node> n, int dev, int node_id)
 {
-    std::stringstream cmd;
-    cmd.str(std::string());
-    cmd << "route add 10.1." << node_id + 1 << ".0/24 dev sim" << dev << "";
-    LinuxStackHelper::RunIp (n, Seconds (2), cmd.str());
-
-    int child = get_first_child(node_id, stride);
-    for(int i = 0; i < stride; i++){
-        if((child  + i) >= nodes.GetN()) break;
-        add_route(n, dev, child + i, stride, nodes);
+    std::vector<Ipv4Prefix> prefixes = routing.GetSubtreePrefixes(node_id);
+    std::stringstream devName;
+    devName << "sim" << dev;
+
+    for (std::vector<Ipv4Prefix>::const_iterator it = prefixes.begin(); it != prefixes.end(); ++it) {
+        agent.AddRoute (n, Seconds (0), *it, 0, devName.str());
     }
 }
 
-void start_nat(ns3::Ptr<ns3::Node> n, std::string interface)
+void start_nat(ConfigAgent &agent, ns3::Ptr<ns3::Node> n, std::string interface)
 {
-    dce.SetBinary ("xtables-multi");
-    dce.ResetArguments ();
-    dce.ResetEnvironment ();
-    dce.AddArgument ("iptables");
-    dce.AddArgument ("-t");
-    dce.AddArgument ("nat");
-    dce.AddArgument ("-A");
-    dce.AddArgument ("POSTROUTING");
-    dce.AddArgument ("-o");
-    dce.AddArgument (interface);
-    dce.AddArgument ("-j");
-    dce.AddArgument ("MASQUERADE");
-
-    apps = dce.Install(n);
-    apps.Start(Seconds(3));
+    agent.Masquerade (n, Seconds (0), interface);
 }
 
 int main(int argc, char *argv[])
@@ -151,6 +86,8 @@ int main(int argc, char *argv[])
     ApplicationContainer apps;
     ApplicationContainer confapps;
     ApplicationContainer iperfApps;
+    ApplicationContainer pingApps;
+    ApplicationContainer sinkApps;
     LinuxStackHelper stack;
     NetDeviceContainer apDevices;
     NetDeviceContainer staDevices;
@@ -159,10 +96,12 @@ int main(int argc, char *argv[])
 
     NodeContainer nodes, routers, backbone, servers, serverGw, allHosts;
     std::stringstream cmdStream;
+    IpBatchHelper ipBatch;
+    ConfigAgent agent;
 
     std::map<int, std::vector<std::string> > gatewaysForNode;
 
-    double stopTime = 80.0;
+    double stopTime = 60.0;
     std::string p2pdelay = "50ms";
     std::string iperfTime = "60";
     std::string ccalg = "reno";
@@ -179,20 +118,76 @@ int main(int argc, char *argv[])
     uint32_t nServers = 1;
     uint32_t nServerGw = 1;
     uint32_t iperfloc = 0;
+    uint32_t pingCount = 50;
+    std::string workload = "iperf";
+    double quietInterval = 1.0;
+    uint32_t quietPackets = 0;
+    double warmup = 0;
+    bool pcap = true;
+    std::string pcapMode = "full";
+    std::string pcapMerge = "device";
+    uint32_t snaplen = 96;
+    bool flowStats = true;
+
+    std::string segmentType = "csma";
+    std::string cacheDir;
 
     CommandLine cmd;
+    RunProfile profile ("dce-mpdd-throughput-csma");
+    profile.AddOptions(cmd);
     cmd.AddValue("devices", "Number of wifi devices", nDevices);
     cmd.AddValue("stride", "Tree Stride", treeStride);
     cmd.AddValue("interfaces", "Number of gateway interfaces for non root devices", nInterfaces);
     cmd.AddValue("distribute_gateways", "Number of gateway interfaces for root device", distributeGateways);
     cmd.AddValue("mode", "Choose network/transport layer protocols. TCP/MPTCP/LB/MPDP", mode);
     cmd.AddValue("iperfloc", "Choose location of iperf (0) leaf, (1) all nodes", iperfloc);
+    cmd.AddValue("workload", "iperf to run iperf in DCE, native for in simulator senders and sinks on the same kernel sockets", workload);
     cmd.AddValue ("ccalg", "Set TCP Congestion Control Algorithm.", ccalg);
     cmd.AddValue ("delay", "Set variable delay on or off", delay);
+    cmd.AddValue("stopTime", "Latest stop time of the simulation; it ends earlier once the pings (and MPDD) are done", stopTime);
+    cmd.AddValue("pingCount", "Echo requests sent by each ping", pingCount);
+    cmd.AddValue("warmup", "Idle seconds between the configuration at 0 and the first application", warmup);
+    cmd.AddValue("quietInterval", "Seconds per MPDD quiescence check", quietInterval);
+    cmd.AddValue("quietPackets", "Tree packets per interval still counted as quiet, e.g. for periodic hellos", quietPackets);
+    cmd.AddValue("pcap", "Write pcaps of the watched devices", pcap);
+    cmd.AddValue("pcapMode", "full to capture everything, ring to keep the last frames in memory and write them around resets and throughput collapses", pcapMode);
+    cmd.AddValue("pcapMerge", "In full mode, device for a pcap per device, node for a pcapng per node, all for one pcapng of every device", pcapMerge);
+    cmd.AddValue("snaplen", "Bytes kept per frame in ring mode", snaplen);
+    cmd.AddValue("flowStats", "Write per flow throughput, retransmission and RTT bins to flow-stats.txt", flowStats);
+    cmd.AddValue("segment", "Tree segments: csma, or broadcast for a shared medium without collisions or backoff", segmentType);
+    cmd.AddValue("cache", "Directory of cached run results, disabled if empty", cacheDir);
 
     cmd.Parse(argc, argv);
 
-    CsmaHelper csma;
+    /*Configuration is all at 0; applications follow 1s later, after any warm-up*/
+    Time start = Seconds (1 + warmup);
+
+    profile.Install();
+
+    if(workload != "iperf" && workload != "native"){
+        NS_FATAL_ERROR("Unknown workload " << workload << ", expected iperf or native");
+    }
+    if(pcapMode != "full" && pcapMode != "ring"){
+        NS_FATAL_ERROR("Unknown pcap mode " << pcapMode << ", expected full or ring");
+    }
+    if(pcapMerge != "device" && pcapMerge != "node" && pcapMerge != "all"){
+        NS_FATAL_ERROR("Unknown pcap merge " << pcapMerge << ", expected device, node or all");
+    }
+
+    RunCache cache;
+    cache.Configure(cacheDir, argc, argv);
+    cache.AddOutput("throughput.txt");
+    cache.AddOutput("flow-stats.txt");
+    cache.AddOutput("results.csv");
+    if (cache.Restore()) {
+        return 0;
+    }
+
+    TreeTopology tree (nDevices, treeStride);
+    AddressPlan plan;
+    plan.AssignTree(tree);
+
+    SegmentHelper csma (segmentType);
     csma.SetChannelAttribute ("DataRate", StringValue ("100Mbps"));
     csma.SetChannelAttribute ("Delay", TimeValue (NanoSeconds (6560)));
 
@@ -244,20 +239,18 @@ int main(int argc, char *argv[])
     for (int i = 0; i < nodes.GetN(); i++) {
         NodeContainer tempNodes;
 
-        uint32_t firstChild = get_first_child(i, treeStride);
+        uint32_t firstChild = tree.GetFirstChild(i);
 
         tempNodes.Add(nodes.Get(i));
 
-        for(int j = 0; j < treeStride; j++){
-            if((firstChild+j) >= nodes.GetN()) break;
+        for(uint32_t j = 0; j < tree.GetNChildren(i); j++){
             tempNodes.Add(nodes.Get(firstChild+j));
         }
 
         if(tempNodes.GetN() > 1){
             NetDeviceContainer devices = csma.Install(tempNodes);
             apDevices.Add(devices.Get(0));
-            for(int j = 1; j <= treeStride; j++){
-                if((firstChild+j) >= nodes.GetN()) break;
+            for(uint32_t j = 1; j <= tree.GetNChildren(i); j++){
                 staDevices.Add(devices.Get(j));
             }
         }
@@ -267,41 +260,21 @@ int main(int argc, char *argv[])
     * Setup Addresses
     ****/
     for (int i = 0; i < nodes.GetN(); i++) {
-        std::stringstream cmd;
-
-        uint32_t firstChild = get_first_child(i, treeStride);
+        uint32_t firstChild = tree.GetFirstChild(i);
 
-        if(i == 0){
-            cmd << "link set dev sim0 up";
-            LinuxStackHelper::RunIp (nodes.Get (i), Seconds (1), cmd.str());
-            cmd.str(std::string());
-            cmd << "addr add 10.1." << i + 1 << ".1/24 broadcast 10.1." << i + 1 << ".255 dev sim0";
-            LinuxStackHelper::RunIp (nodes.Get (i), Seconds (2), cmd.str());
-        } else {
-            if(nodes.Get(i)->GetNDevices() > 1){
-                cmd << "link set dev sim1 up";
-                LinuxStackHelper::RunIp (nodes.Get (i), Seconds (1), cmd.str());
-                cmd.str(std::string());
-                cmd << "addr add 10.1." << i + 1 << ".1/24 broadcast 10.1." << i + 1 << ".255 dev sim1";
-                LinuxStackHelper::RunIp (nodes.Get (i), Seconds (2), cmd.str());
-            }
+        if(!plan.HasSegment(i)){
+            continue;
         }
+        Ipv4Prefix segment = plan.GetSegment(i);
 
-        //std::cout << "FirstChild: " << firstChild << "\n";
-        for(int j = 0; j < treeStride; j++){
-            if((firstChild + j) >= nodes.GetN()){
-                //std::cout << "FirstChild: " << firstChild << " Nodes: " << nodes.GetN() << "\n";
-                break;
-            }
-
-            cmd.str(std::string());
-            cmd << "link set dev sim0 up";
-            LinuxStackHelper::RunIp (nodes.Get (firstChild+j), Seconds (1), cmd.str());
+        /*The root's segment is on sim0, the other nodes have their uplink there*/
+        std::string dev = i == 0 ? "sim0" : "sim1";
+        agent.SetLink (nodes.Get (i), Seconds (0), dev, true);
+        agent.AddAddress (nodes.Get (i), Seconds (0), dev, segment, plan.GetSegmentHost());
 
-            cmd.str(std::string());
-            cmd << "addr add 10.1." << i + 1 << "." << firstChild + j + 1 << "/24 broadcast 10.1." << i + 1 << ".255 dev sim0";
-            //std::cout << "NODE " << firstChild + j + 1 << ": " << cmd.str() << std::endl;
-            LinuxStackHelper::RunIp (nodes.Get (firstChild+j), Seconds (2), cmd.str());
+        for(uint32_t j = 0; j < tree.GetNChildren(i); j++){
+            agent.SetLink (nodes.Get (firstChild+j), Seconds (0), "sim0", true);
+            agent.AddAddress (nodes.Get (firstChild+j), Seconds (0), "sim0", segment, plan.GetUplinkHost(firstChild+j));
         }
     }
 
@@ -309,58 +282,39 @@ int main(int argc, char *argv[])
     * Setup Routing
     **/
 
+    TreeRouting routing (tree, plan.GetTreePrefix().network, plan.GetSegmentLength(), plan.GetSegmentIndices());
+    std::cout << "Tree: " << plan.GetTreePrefix().ToString() << ", routes: " << routing.GetNRoutes() << "\n";
+
     for (int i = 0; i < nodes.GetN(); i++) {
-        std::stringstream cmd;
-        int parent = get_parent(i, treeStride) + 1;
-        if(parent >= 1) {
-            add_route_via(nodes.Get(i), i, 1, i, treeStride, nodes);
+        int parent = tree.GetParent(i);
+        if(parent >= 0) {
+            Ipv4Prefix uplink = plan.GetSegment(parent);
+            uint32_t parentAddress = uplink.GetHost(plan.GetSegmentHost());
 
-            cmd.str(std::string());
-            cmd << "route add 10.1." << parent << ".0/24 dev sim0";
-            std::cout << "NODE " << i << ": " << cmd.str() << std::endl;
-            LinuxStackHelper::RunIp (nodes.Get (i), Seconds (3), cmd.str());
+            add_tree_routes(agent, routing, plan, nodes.Get(i), i, 1);
 
             if(mode == MODE_TCP){
-                cmd.str(std::string());
-                cmd << "route add default via 10.1." << parent << ".1 dev sim0";
-                std::cout << "NODE " << i << ": " << cmd.str() << std::endl;
-                LinuxStackHelper::RunIp (nodes.Get (i), Seconds (3), cmd.str());
+                agent.AddRoute (nodes.Get (i), Seconds (0), Ipv4Prefix (), parentAddress, "sim0");
             }
             if(mode == MODE_TCP_LB || mode == MODE_MPTCP){
-                cmd.str(std::string());
-                cmd << "route add default via 10.1." << parent << ".1 dev sim0 metric " << dev_interfaces[i];
-                std::cout << "NODE " << i << ": " << cmd.str() << std::endl;
-                LinuxStackHelper::RunIp (nodes.Get (i), Seconds (3), cmd.str());
-
-                cmd.str(std::string());
-                cmd << "rule add from 10.1." << parent << ".0/24 dev sim0 lookup " << dev_interfaces[i];
-                std::cout << "NODE " << i << ": " << cmd.str() << std::endl;
-                LinuxStackHelper::RunIp (nodes.Get (i), Seconds (3.5), cmd.str());
-
-                cmd.str(std::string());
-                cmd << "route add 10.1." << parent << ".0/24 dev sim0 table " << dev_interfaces[i];
-                std::cout << "NODE " << i << ": " << cmd.str() << std::endl;
-                LinuxStackHelper::RunIp (nodes.Get (i), Seconds (3), cmd.str());
-
-                cmd.str(std::string());
-                cmd << "route add default via 10.1." << parent << ".1 dev sim0 table " << dev_interfaces[i];
-                std::cout << "NODE " << i << ": " << cmd.str() << std::endl;
-                LinuxStackHelper::RunIp (nodes.Get (i), Seconds (3), cmd.str());
+                agent.AddRoute (nodes.Get (i), Seconds (0), Ipv4Prefix (), parentAddress, "sim0", ConfigAgent::MAIN_TABLE, dev_interfaces[i]);
+                agent.AddRule (nodes.Get (i), Seconds (0), uplink, "sim0", dev_interfaces[i]);
+                agent.AddRoute (nodes.Get (i), Seconds (0), uplink, 0, "sim0", dev_interfaces[i]);
+                agent.AddRoute (nodes.Get (i), Seconds (0), Ipv4Prefix (), parentAddress, "sim0", dev_interfaces[i]);
 
                 dev_interfaces[i]++;
             }
 
-        } else {
-            add_route_via(nodes.Get(i), i, 0, i, treeStride, nodes);
-
-            cmd << "route add 10.1.1.0/24 dev sim0";
-            //std::cout << "NODE " << i + 1 << ": " << cmd.str() << std::endl;
-            LinuxStackHelper::RunIp (nodes.Get (i), Seconds (3), cmd.str());
+        } else if(plan.HasSegment(i)) {
+            add_tree_routes(agent, routing, plan, nodes.Get(i), i, 0);
         }
 
     }
 
     NetDeviceContainer gatewayDevices;
+    std::vector<Ipv4Prefix> gatewayLinks;
+    /*Tree side device of each gateway link*/
+    std::vector<std::string> gatewayDevs;
 
     /*Add Gateway Routers*/
     PointToPointHelper pointToPoint;
@@ -373,59 +327,36 @@ int main(int argc, char *argv[])
             nodeIdx = i % routers.GetN();
         }
 
-        std::stringstream cmd;
+        /*Tree side is host 1 and the router host 2 of each link*/
+        Ipv4Prefix link = plan.Allocate(AddressPlan::GATEWAY, 30);
+        Ipv4Prefix backboneLink = plan.Allocate(AddressPlan::BACKBONE, 30);
+        std::string linkAddress = Ipv4ToString(link.GetHost(1));
+        gatewayLinks.push_back(link);
+        gatewaysForNode[nodeIdx].push_back(linkAddress);
 
         /*Connect network to the routers*/
         pointToPoint.SetDeviceAttribute ("DataRate", StringValue ("10Mbps"));
         pointToPoint.SetChannelAttribute ("Delay", TimeValue (NanoSeconds (6560)));
         NetDeviceContainer dev = pointToPoint.Install(nodes.Get(nodeIdx), routers.Get(i));
 
-        cmd << "link set dev sim" << nodes.Get (nodeIdx)->GetNDevices()-1 << " up";
-        std::cout << "NODE " << nodeIdx << ": " << cmd.str() << std::endl;
-        LinuxStackHelper::RunIp (nodes.Get (nodeIdx), Seconds (1), cmd.str());
+        std::stringstream treeDev;
+        treeDev << "sim" << nodes.Get (nodeIdx)->GetNDevices()-1;
+        gatewayDevs.push_back(treeDev.str());
 
-        cmd.str(std::string());
-        cmd << "addr add 192.168." << i + 1 << ".1/24 broadcast 192.168." << i + 1 << ".255 dev sim" << nodes.Get (nodeIdx)->GetNDevices()-1;
-        std::cout << "NODE " << nodeIdx << ": " << cmd.str() << std::endl;
-        LinuxStackHelper::RunIp (nodes.Get(nodeIdx), Seconds (2), cmd.str());
-
-        cmd.str(std::string());
-        cmd << "route add default via 192.168." << i + 1 << ".2 dev sim" << nodes.Get (nodeIdx)->GetNDevices()-1 << " metric " << dev_interfaces[nodeIdx];
-        LinuxStackHelper::RunIp (nodes.Get(nodeIdx), Seconds (3), cmd.str());
-        std::cout << "NODE " << nodeIdx << ": " << cmd.str() << std::endl;
+        agent.SetLink (nodes.Get (nodeIdx), Seconds (0), treeDev.str(), true);
+        agent.AddAddress (nodes.Get (nodeIdx), Seconds (0), treeDev.str(), link, 1);
+        agent.AddRoute (nodes.Get (nodeIdx), Seconds (0), Ipv4Prefix (), link.GetHost(2), treeDev.str(), ConfigAgent::MAIN_TABLE, dev_interfaces[nodeIdx]);
 
         if(mode == MODE_TCP_LB || mode == MODE_MPTCP){
-            cmd.str(std::string());
-            cmd << "rule add from 192.168." << i + 1 << ".0/24 dev sim" << nodes.Get (nodeIdx)->GetNDevices()-1 << " lookup " << dev_interfaces[nodeIdx];
-            std::cout << "NODE " << nodeIdx << ": " << cmd.str() << std::endl;
-            LinuxStackHelper::RunIp (nodes.Get (nodeIdx), Seconds (3), cmd.str());
-
-            cmd.str(std::string());
-            cmd << "route add 192.168." << i + 1 << ".0/24 dev sim" << nodes.Get (nodeIdx)->GetNDevices()-1 << " table " << dev_interfaces[nodeIdx];
-            std::cout << "NODE " << nodeIdx << ": " << cmd.str() << std::endl;
-            LinuxStackHelper::RunIp (nodes.Get (nodeIdx), Seconds (3), cmd.str());
-
-            cmd.str(std::string());
-            cmd << "route add default via 192.168." << i + 1 << ".2 dev sim" << nodes.Get (nodeIdx)->GetNDevices()-1 << " table " << dev_interfaces[nodeIdx];
-            std::cout << "NODE " << nodeIdx << ": " << cmd.str() << std::endl;
-            LinuxStackHelper::RunIp (nodes.Get (nodeIdx), Seconds (3), cmd.str());
+            agent.AddRule (nodes.Get (nodeIdx), Seconds (0), link, treeDev.str(), dev_interfaces[nodeIdx]);
+            agent.AddRoute (nodes.Get (nodeIdx), Seconds (0), link, 0, treeDev.str(), dev_interfaces[nodeIdx]);
+            agent.AddRoute (nodes.Get (nodeIdx), Seconds (0), Ipv4Prefix (), link.GetHost(2), treeDev.str(), dev_interfaces[nodeIdx]);
         }
         dev_interfaces[i]++;
 
-        cmd.str(std::string());
-        cmd << "link set dev sim0 up";
-        LinuxStackHelper::RunIp (routers.Get(i), Seconds (1), cmd.str());
-
-        cmd.str(std::string());
-        cmd << "addr add 192.168." << i + 1 << ".2/24 broadcast 192.168." << i + 1 << ".255 dev sim0";
-        //std::cout << "Router " << i + 1 << ": " << cmd.str() << std::endl;
-        LinuxStackHelper::RunIp (routers.Get(i), Seconds (2), cmd.str());
-
-        cmd.str(std::string());
-        cmd << "route add 10.1.0.0/16 dev sim0";
-        LinuxStackHelper::RunIp (routers.Get(i), Seconds (2), cmd.str());
-
-        //std::cout << "NODE " << 1 << ": " << cmd.str() << std::endl;
+        agent.SetLink (routers.Get (i), Seconds (0), "sim0", true);
+        agent.AddAddress (routers.Get (i), Seconds (0), "sim0", link, 2);
+        agent.AddRoute (routers.Get (i), Seconds (0), plan.GetTreePrefix(), 0, "sim0");
 
         /*Connect the routers to the backbone*/
         pointToPoint.SetDeviceAttribute ("DataRate", StringValue ("100Mbps"));
@@ -434,39 +365,22 @@ int main(int argc, char *argv[])
 
         routerDevices.Add(serverDev.Get(0));
 
-        cmd.str(std::string());
-        cmd << "link set dev sim1 up";
-        LinuxStackHelper::RunIp (routers.Get(i), Seconds (1), cmd.str());
-
-        cmd.str(std::string());
-        cmd << "addr add 192.167." << i << ".2/24 dev sim1";
-        //std::cout << "Router " << i << ": " << cmd.str() << std::endl;
-        LinuxStackHelper::RunIp (routers.Get(i), Seconds (2), cmd.str());
-
-        cmd.str(std::string());
-        cmd << "route add default via 192.167." << i << ".1 dev sim1";
-        LinuxStackHelper::RunIp (routers.Get(i), Seconds (3), cmd.str());
+        agent.SetLink (routers.Get (i), Seconds (0), "sim1", true);
+        agent.AddAddress (routers.Get (i), Seconds (0), "sim1", backboneLink, 2);
+        agent.AddRoute (routers.Get (i), Seconds (0), Ipv4Prefix (), backboneLink.GetHost(1), "sim1");
 
         /*Setup the server gateway links*/
 
         int sgwDevNumber = serverGw.Get(0)->GetNDevices() - 1;
-        cmd.str(std::string());
-        cmd << "link set dev sim" << sgwDevNumber << " up";
-        LinuxStackHelper::RunIp (serverGw.Get(0), Seconds (1), cmd.str());
+        std::stringstream sgwDev;
+        sgwDev << "sim" << sgwDevNumber;
 
-        cmd.str(std::string());
-        cmd << "addr add 192.167." << i << ".1/24 dev sim" << sgwDevNumber << "";
-        LinuxStackHelper::RunIp (serverGw.Get(0), Seconds (3), cmd.str());
+        agent.SetLink (serverGw.Get (0), Seconds (0), sgwDev.str(), true);
+        agent.AddAddress (serverGw.Get (0), Seconds (0), sgwDev.str(), backboneLink, 1);
 
-        cmd.str(std::string());
-        cmd << "route add 10.1." << i + 1 << ".0/24 dev sim" << sgwDevNumber << "";
-        LinuxStackHelper::RunIp (serverGw.Get(0), Seconds (3), cmd.str());
+        add_subtree_routes(agent, routing, serverGw.Get(0), sgwDevNumber, nodeIdx);
 
-        add_route(serverGw.Get(0), sgwDevNumber, nodeIdx, treeStride, nodes);
-
-        cmd.str(std::string());
-        cmd << "route add 192.168." << i + 1 << ".0/24 dev sim" << sgwDevNumber << "";
-        LinuxStackHelper::RunIp (serverGw.Get(0), Seconds (3), cmd.str());
+        agent.AddRoute (serverGw.Get (0), Seconds (0), link, 0, sgwDev.str());
 
     }
 
@@ -479,31 +393,24 @@ int main(int argc, char *argv[])
 
     serverDevices.Add(serverGwDev.Get(0));
 
-    std::stringstream mcmd;
-    mcmd << "link set dev sim0 up";
-    LinuxStackHelper::RunIp (servers.Get(0), Seconds (1), mcmd.str());
-
-    mcmd.str(std::string());
-    mcmd << "addr add 194.80.39.1/24 dev sim0";
-    LinuxStackHelper::RunIp (servers.Get(0), Seconds (2), mcmd.str());
+    /*Server is host 1 and the server gateway host 2 of the server LAN*/
+    Ipv4Prefix serverLan = plan.Allocate(AddressPlan::SERVER, 24);
+    std::string serverAddress = Ipv4ToString(serverLan.GetHost(1));
+    std::string serverGwAddress = Ipv4ToString(serverLan.GetHost(2));
 
-    mcmd.str(std::string());
-    mcmd << "route add default via 194.80.39.2 dev sim0";
-    LinuxStackHelper::RunIp (servers.Get(0), Seconds (3), mcmd.str());
+    agent.SetLink (servers.Get (0), Seconds (0), "sim0", true);
+    agent.AddAddress (servers.Get (0), Seconds (0), "sim0", serverLan, 1);
+    agent.AddRoute (servers.Get (0), Seconds (0), Ipv4Prefix (), serverLan.GetHost(2), "sim0");
 
 
     /*****
     * Setup the connection between server gateway
     */
 
-    int sgwDevNumber = serverGw.Get(0)->GetNDevices() - 1;
-    mcmd.str(std::string());
-    mcmd << "link set dev sim" << sgwDevNumber << " up";
-    LinuxStackHelper::RunIp (serverGw.Get(0), Seconds (1), mcmd.str());
-
-    mcmd.str(std::string());
-    mcmd << "addr add 194.80.39.2/24 dev sim" << sgwDevNumber << "";
-    LinuxStackHelper::RunIp (serverGw.Get(0), Seconds (2), mcmd.str());
+    std::stringstream sgwDev;
+    sgwDev << "sim" << serverGw.Get(0)->GetNDevices() - 1;
+    agent.SetLink (serverGw.Get (0), Seconds (0), sgwDev.str(), true);
+    agent.AddAddress (serverGw.Get (0), Seconds (0), sgwDev.str(), serverLan, 2);
 
     /*****
     * Add load balancing routes if appropriate
@@ -512,62 +419,39 @@ int main(int argc, char *argv[])
     /*Enable load balancing*/
 
     if (mode == MODE_TCP_LB){
+        ConfigAgent::Nexthop nh;
+        nh.weight = 1;
 
         if(distributeGateways != DIST_GATEWAYS_YES){
-            for (int i = 0; i < routers.GetN(); i++){
-                int nodeIdx = 0;
-                std::stringstream cmd;
-                cmd.str(std::string());
-                cmd << "route add default scope global";
-                for (int i = 0; i < flows; i++){
-                    cmd << " nexthop via 192.168." << i << ".1 dev sim" << i << " weight 1";
-                }
-                cmd << "";
-                //std::cout << "LB Gateway: " << cmd.str() << "\n";
-                LinuxStackHelper::RunIp (nodes.Get (0), Seconds (0.1), cmd.str());
+            /*All gateways hang off the root, balance over the first flows of them*/
+            std::vector<ConfigAgent::Nexthop> nexthops;
+            for (int i = 0; i < flows && i < gatewayLinks.size(); i++){
+                nh.via = gatewayLinks[i].GetHost(2);
+                nh.dev = gatewayDevs[i];
+                nexthops.push_back(nh);
             }
+            agent.AddMultipathRoute (nodes.Get (0), Seconds (0), Ipv4Prefix (), nexthops);
         } else {
-            std::stringstream cmd;
-
+            /*A node balances over its own gateways, or else sends everything to its parent*/
             for (int i = 0; i < nodes.GetN(); i++) {
-                std::vector< std::string > addresses;
-
+                std::vector<ConfigAgent::Nexthop> nexthops;
                 for (int j = 0; j < routers.GetN(); j++){
-                    int nodeIdx = 0;
-                    if(distributeGateways == DIST_GATEWAYS_YES){
-                        nodeIdx = j % routers.GetN();
-                    }
-                    if(nodeIdx == i){
-                        std::stringstream defrt;
-                        int devNumber = nodes.Get(i)->GetNDevices();
-                        defrt << "192.168." << j << ".1 dev sim" << devNumber;
-                        addresses.push_back(defrt.str());
+                    if(j % routers.GetN() == i){
+                        nh.via = gatewayLinks[j].GetHost(2);
+                        nh.dev = gatewayDevs[j];
+                        nexthops.push_back(nh);
                     }
                 }
 
-                int parent = get_parent(i, treeStride);
-                if(parent >= 0){
-                    cmd.str(std::string());
-                    cmd << "route add default scope global";
-                    for (int i = 0; i < flows; i++){
-                        cmd << " nexthop via 10.1." << parent + 1 << ".1 dev sim0 weight 1";
-                    }
-                    cmd << "";
-                    //std::cout << "LB Gateway: " << cmd.str() << "\n";
-                    LinuxStackHelper::RunIp (nodes.Get (0), Seconds (0.1), cmd.str());
+                int parent = tree.GetParent(i);
+                if(nexthops.empty() && parent >= 0){
+                    nh.via = plan.GetSegment(parent).GetHost(plan.GetSegmentHost());
+                    nh.dev = "sim0";
+                    nexthops.push_back(nh);
                 }
 
-                if(addresses.size() > 0) {
-                    std::stringstream cmd;
-                    cmd.str(std::string());
-                    cmd << "route add default scope global";
-
-                    for (int devId = 0; i < addresses.size(); i++) {
-                        cmd << " nexthop via " << addresses[i] << " weight 1";
-                    }
-                    cmd << "";
-                    //std::cout << "LB Gateway: " << cmd.str() << "\n";
-                    LinuxStackHelper::RunIp (nodes.Get (i), Seconds (0.1), cmd.str());
+                if(!nexthops.empty()){
+                    agent.AddMultipathRoute (nodes.Get (i), Seconds (0), Ipv4Prefix (), nexthops);
                 }
             }
         }
@@ -581,37 +465,23 @@ int main(int argc, char *argv[])
     appHelper.SetStackSize(1 << 20);
 
     for (int i = 0; i < allHosts.GetN(); i++) {
-        stack.SysctlSet(allHosts.Get(i), ".net.ipv4.conf.all.forwarding", "1");
-        stack.SysctlSet(allHosts.Get(i), ".net.ipv6.conf.all.disable_ipv6", "1");
-        stack.SysctlSet (allHosts.Get(i), ".net.ipv4.tcp_low_latency", "1");
-        stack.SysctlSet (allHosts.Get(i), ".net.ipv4.tcp_no_metrics_save", "1");
-        stack.SysctlSet (allHosts.Get(i), ".net.ipv4.tcp_timestamps", "1");
-        stack.SysctlSet (allHosts.Get(i), ".net.ipv4.tcp_sack", "1");
-        stack.SysctlSet (allHosts.Get(i), ".net.ipv4.tcp_mem", "768174 10242330 15363480");
-        stack.SysctlSet (allHosts.Get(i), ".net.ipv4.tcp_rmem", "4096 524288 204217728");
-        stack.SysctlSet (allHosts.Get(i), ".net.ipv4.tcp_wmem", "4096 524288 204217728");
-        stack.SysctlSet (allHosts.Get(i), ".net.core.wmem_max", "5242870");
-        stack.SysctlSet (allHosts.Get(i), ".net.core.rmem_max","5242870");
-        stack.SysctlSet (allHosts.Get(i), ".net.core.optmem_max","5242870");
-        stack.SysctlSet (allHosts.Get(i), ".net.core.netdev_max_backlog", "25000000");
-
-        LinuxStackHelper::RunIp (allHosts.Get(i), Seconds (4), "route show");
-        LinuxStackHelper::RunIp (allHosts.Get(i), Seconds (4), "rule show");
-        LinuxStackHelper::RunIp (allHosts.Get(i), Seconds (4), "addr show");
-        LinuxStackHelper::RunIp (allHosts.Get (i), Seconds (4), "route show table 1");
-        LinuxStackHelper::RunIp (allHosts.Get (i), Seconds (4), "route show table 2");
-
-        /*Enable or disable MPTCP*/
-        if (mode == MODE_MPTCP_MPDP || mode == MODE_MPTCP) {
-            stack.SysctlSet (allHosts.Get (i), ".net.mptcp.mptcp_enabled", "1");
-            stack.SysctlSet (allHosts.Get (i), ".net.mptcp.mptcp_path_manager", "fullmesh");
-            stack.SysctlSet(allHosts.Get (i), ".net.ipv4.tcp_congestion_control", ccalg);
-        } else {
-            stack.SysctlSet (allHosts.Get (i), ".net.mptcp.mptcp_enabled", "0");
-            stack.SysctlSet(allHosts.Get (i), ".net.ipv4.tcp_congestion_control", ccalg);
-        }
+        ipBatch.Add (allHosts.Get(i), Seconds (0.5), "route show");
+        ipBatch.Add (allHosts.Get(i), Seconds (0.5), "rule show");
+        ipBatch.Add (allHosts.Get(i), Seconds (0.5), "addr show");
+        ipBatch.Add (allHosts.Get (i), Seconds (0.5), "route show table 1");
+        ipBatch.Add (allHosts.Get (i), Seconds (0.5), "route show table 2");
+    }
 
+    /*Enable or disable MPTCP*/
+    SysctlProfile sysctl = SysctlProfile::Lookup("router");
+    sysctl.Add(SysctlProfile::Lookup("high-bdp-tcp"));
+    if (mode == MODE_MPTCP_MPDP || mode == MODE_MPTCP) {
+        sysctl.Add(SysctlProfile::Lookup("mptcp-fullmesh"));
+    } else {
+        sysctl.Add(SysctlProfile::Lookup("tcp"));
     }
+    sysctl.Set(".net.ipv4.tcp_congestion_control", ccalg);
+    sysctl.Apply(allHosts);
 
     /****
     *
@@ -629,48 +499,63 @@ int main(int argc, char *argv[])
 
 
 
-    appHelper.SetBinary("iperf");
-    appHelper.ResetArguments();
-    appHelper.ResetEnvironment();
-    appHelper.AddArgument("-s");
-    apps = appHelper.Install(servers);
-    apps.Start(Seconds (5));
-    /*
-    if(iperfloc == 1){
+    ThroughputReporter throughput ("throughput.txt", Seconds (2));
+    ProcessLog results ("results.csv");
+
+    if(workload == "native"){
+        /*The same 10s transfers as the iperf clients, from the leaf or every node*/
+        PacketSinkHelper sink ("ns3::LinuxTcpSocketFactory", InetSocketAddress (Ipv4Address::GetAny(), 5001));
+        sinkApps = sink.Install(servers);
+        sinkApps.Start(start);
+        throughput.Watch(sinkApps);
+        throughput.Start(start + Seconds (5));
+
+        Address serverSocket = InetSocketAddress (Ipv4Address (serverLan.GetHost(1)), 5001);
+        for (int i = 0; i < nodes.GetN(); i++) {
+            if(iperfloc != 1 && i != nDevices-1){
+                continue;
+            }
+            Ptr<BulkSender> sender = CreateObject<BulkSender> ();
+            sender->SetAttribute("Remote", AddressValue (serverSocket));
+            nodes.Get(i)->AddApplication(sender);
+            iperfApps.Add(sender);
+        }
+        iperfApps.Start(start + Seconds (5));
+        iperfApps.Stop(start + Seconds (15));
+    } else {
+        appHelper.SetBinary("iperf");
+        appHelper.ResetArguments();
+        appHelper.ResetEnvironment();
+        appHelper.AddArgument("-s");
+        apps = appHelper.Install(servers);
+        apps.Start(start);
+        results.Watch(apps, "iperf server", ProcessLog::IPERF);
+
+        /*10s transfers reporting every 2s, from the leaf or every node*/
         for (int i = 0; i < nodes.GetN(); i++) {
+            if(iperfloc != 1 && i != nDevices-1){
+                continue;
+            }
             appHelper.SetBinary("iperf");
             appHelper.ResetArguments();
             appHelper.ResetEnvironment();
-
             appHelper.AddArgument("-c");
-            appHelper.AddArgument("194.80.39.1");
+            appHelper.AddArgument(serverAddress);
             appHelper.AddArgument("-t");
             appHelper.AddArgument("10");
             appHelper.AddArgument("-i");
             appHelper.AddArgument("2");
-            apps = appHelper.InstallInNode(nodes.Get(i));
-            std::cout << "Installed in " << i << "\n";
+            iperfApps.Add(appHelper.InstallInNode(nodes.Get(i)));
         }
-        apps.Start(Seconds (10));
-    } else {
-
-        appHelper.SetBinary("iperf");
-        appHelper.ResetArguments();
-        appHelper.ResetEnvironment();
-        appHelper.AddArgument("-c");
-        appHelper.AddArgument("194.80.39.1");
-        appHelper.AddArgument("-t");
-        appHelper.AddArgument("10");
-        appHelper.AddArgument("-i");
-        appHelper.AddArgument("2");
-        apps = appHelper.InstallInNode(nodes.Get(nDevices-1));
-        apps.Start(Seconds (10));
-
+        iperfApps.Start(start + Seconds (5));
+        results.Watch(iperfApps, "iperf client", ProcessLog::IPERF);
     }
-    */
-    LinuxStackHelper::SysctlGet (nodes.Get (nDevices-1), Seconds (5),".net.mptcp.mptcp_enabled", &PrintTcpFlags);
-    LinuxStackHelper::SysctlGet (nodes.Get (nDevices-1), Seconds (5),".net.mptcp.mptcp_path_manager", &PrintTcpFlags);
-    LinuxStackHelper::SysctlGet (nodes.Get (nDevices-1), Seconds (5),".net.ipv4.tcp_congestion_control", &PrintTcpFlags);
+
+    std::vector<std::string> sysctlKeys;
+    sysctlKeys.push_back(".net.mptcp.mptcp_enabled");
+    sysctlKeys.push_back(".net.mptcp.mptcp_path_manager");
+    sysctlKeys.push_back(".net.ipv4.tcp_congestion_control");
+    SysctlProfile::Print(nodes.Get (nDevices-1), start, sysctlKeys);
 
     /*
     appHelper.SetBinary("ping");
@@ -692,23 +577,26 @@ int main(int argc, char *argv[])
     apps.Start(Seconds (10));
 */
 
-    appHelper.SetBinary("ping");
-    appHelper.ResetArguments();
-    appHelper.ResetEnvironment();
-    appHelper.AddArgument("194.80.39.2");
-    appHelper.AddArgument("-I");
-    appHelper.AddArgument("192.168.7.1");
-    apps = appHelper.InstallInNode(nodes.Get(nDevices-1));
-    apps.Start(Seconds (6));
-
-    appHelper.SetBinary("ping");
-    appHelper.ResetArguments();
-    appHelper.ResetEnvironment();
-    appHelper.AddArgument("194.80.39.2");
-    appHelper.AddArgument("-I");
-    appHelper.AddArgument("10.1.3.7");
-    apps = appHelper.InstallInNode(nodes.Get(nDevices-1));
-    apps.Start(Seconds (6));
+    /*Ping the server gateway from every address of the last node*/
+    std::vector<std::string> pingSources = gatewaysForNode[nDevices-1];
+    if(nDevices > 1){
+        pingSources.push_back(Ipv4ToString(plan.GetUplinkAddress(nDevices-1)));
+    }
+    std::stringstream count;
+    count << pingCount;
+    for (std::vector<std::string>::const_iterator it = pingSources.begin(); it != pingSources.end(); ++it) {
+        appHelper.SetBinary("ping");
+        appHelper.ResetArguments();
+        appHelper.ResetEnvironment();
+        appHelper.AddArgument("-c");
+        appHelper.AddArgument(count.str());
+        appHelper.AddArgument(serverGwAddress);
+        appHelper.AddArgument("-I");
+        appHelper.AddArgument(*it);
+        apps = appHelper.InstallInNode(nodes.Get(nDevices-1));
+        apps.Start(start + Seconds (1));
+        pingApps.Add(apps);
+    }
 
     /*Enable the MPDP*/
 
@@ -736,21 +624,80 @@ int main(int argc, char *argv[])
             std::cout << "Installed in " << i << "\n";
         }
 
-        apps.Start(Seconds (5));
+        apps.Start(start);
 
     }
 
     std::cout << "DONE\n";
 
     //csma.EnablePcap("dce-mpdd-nested-csma-ap", apDevices, true);
-    csma.EnablePcap("dce-mpdd-nested-csma-sta", staDevices, true);
+    RingPcap ring (snaplen);
+    PcapngCapture merged ("dce-mpdd-nested", pcapMerge == "all" ? PcapngCapture::MERGED : PcapngCapture::PER_NODE);
+    if(pcap && pcapMode == "ring"){
+        ring.Watch(staDevices, "dce-mpdd-nested-csma-sta", true);
+        ring.Watch(routerDevices, "dce-mpdd-nested-ptp-routers", true);
+        ring.Watch(serverDevices, "dce-mpdd-nested-ptp-servers", true);
+        ring.TriggerOnReset();
+        if(workload == "native"){
+            ring.TriggerOnCollapse(Seconds (1), 0.25, start + Seconds (7), start + Seconds (15));
+        }
+    } else if(pcap && pcapMerge != "device"){
+        merged.Watch(staDevices, "dce-mpdd-nested-csma-sta", true);
+        merged.Watch(routerDevices, "dce-mpdd-nested-ptp-routers", true);
+        merged.Watch(serverDevices, "dce-mpdd-nested-ptp-servers", true);
+    } else if(pcap){
+        csma.EnablePcap("dce-mpdd-nested-csma-sta", staDevices, true);
+
+        pointToPoint.EnablePcap("dce-mpdd-nested-ptp-routers", routerDevices, true);
+        pointToPoint.EnablePcap("dce-mpdd-nested-ptp-servers", serverDevices, true);
+    }
+
+    FlowStats stats;
+    if(flowStats){
+        stats.Watch(staDevices, "dce-mpdd-nested-csma-sta");
+        stats.Watch(routerDevices, "dce-mpdd-nested-ptp-routers");
+        stats.Watch(serverDevices, "dce-mpdd-nested-ptp-servers");
+    }
 
-    pointToPoint.EnablePcap("dce-mpdd-nested-ptp-routers", routerDevices, true);
-    pointToPoint.EnablePcap("dce-mpdd-nested-ptp-servers", serverDevices, true);
+    ipBatch.Install ();
+    agent.Install ();
 
-    Simulator::Stop(Seconds(60));
+    /*Stop once the pings are done and, with MPDD, the tree has gone quiet*/
+    StopController stop (Seconds (stopTime));
+    stop.AddWorkload(pingApps, "ping");
+    if(workload == "native"){
+        stop.AddDeadline(start + Seconds (15), "bulk senders");
+    } else {
+        stop.AddWorkload(iperfApps, "iperf clients");
+    }
+    if(mode == MODE_MPTCP_MPDP || mode == MODE_TCP_MPDP_LB){
+        NetDeviceContainer treeDevices (apDevices);
+        treeDevices.Add(staDevices);
+        stop.AddQuiescence(treeDevices, "mpdd", start, Seconds (quietInterval), quietPackets);
+    }
+    stop.Install();
+    results.Watch(pingApps, "ping", ProcessLog::PING);
+    results.Install();
+
+    profile.CountProcesses();
+    profile.Phase("configure");
+    profile.PhaseAt(start, "traffic");
     Simulator::Run();
+    profile.Phase("output");
+    stop.Report();
+    results.Close();
+    if(flowStats){
+        stats.Write("flow-stats.txt");
+    }
+    if(workload == "native"){
+        throughput.Report();
+    }
+    profile.Phase("destroy");
     Simulator::Destroy();
+    ring.Close();
+    merged.Close();
+    profile.Report();
+    cache.Store();
 
     return 0;
 }
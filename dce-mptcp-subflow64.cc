@@ -15,6 +15,23 @@
 #include "ns3/constant-position-mobility-model.h"
 #include "ns3/config-store-module.h"
 
+#include "ip-batch-helper.h"
+#include "run-cache.h"
+#include "sysctl-profile.h"
+#include "trace-rtt-random-variable.h"
+#include "address-plan.h"
+#include "stop-controller.h"
+#include "replicator.h"
+#include "bulk-sender.h"
+#include "throughput-reporter.h"
+#include "flow-stats.h"
+#include "ring-pcap.h"
+#include "pcapng-capture.h"
+#include "process-log.h"
+#include "run-profile.h"
+#include "config-agent.h"
+#include "link-bundle-helper.h"
+
 using namespace ns3;
 
 #define MODE_TCP 0
@@ -22,111 +39,60 @@ using namespace ns3;
 #define MODE_MPTCP_ND 2
 #define MODE_TCP_LB 3
 
-Ptr<NormalRandomVariable> createNormalRandomVariable(double mean, double variance, double bound){
-    Ptr<NormalRandomVariable> x = CreateObject<NormalRandomVariable> ();
-    x->SetAttribute ("Mean", DoubleValue (mean));
-    //x->SetAttribute ("Variance", DoubleValue (variance));
-    x->SetAttribute ("Bound", DoubleValue (bound));
-    return x;
-}
-
-/**
-Three HSPA
-MIN: 323.140
-MAX: 1510.172
-Average: 423.240
-Deviation: 224.801
-**/
-
-#define DEVICE_ONE_MEAN_RTT (423.240/2.00)
-#define DEVICE_ONE_VARIANCE_RTT ((224.801/2.00)*(224.801/2.00))
-#define DEVICE_ONE_BOUNDS_RTT (224.801/2.00)
-
-
 /**
-Three HSPA +
-Min: 43.600
-Max: 138.000
-Average: 61.939
-Deviation: 14.836
+Classes of subflow link: rate, loss and measured RTTs, in ms. Links take
+the classes in turn. With --delay each end of a link delays what it
+receives by a draw from the class's distribution scaled by half, so a
+round trip sees the whole RTT.
 **/
-
-#define DEVICE_TWO_MEAN_RTT (61.939/2.00)
-#define DEVICE_TWO_BOUNDS_RTT (14.836/2.00)
-#define DEVICE_TWO_VARIANCE_RTT ((14.836/2.00)*(14.836/2.00))
-
-#define DEVICE_THREE_MEAN_RTT 100
-#define DEVICE_THREE_VARIANCE_RTT 40
-#define DEVICE_THREE_BOUNDS_RTT 20
-
-#define DEVICE_FOUR_MEAN_RTT 100
-#define DEVICE_FOUR_VARIANCE_RTT 40
-#define DEVICE_FOUR_BOUNDS_RTT 20
-
-bool netDevCbFour(
-  Ptr<NetDevice> device,
-  Ptr<const Packet> pkt,
-  uint16_t  protocol,
-  const Address &from)
+struct PathClass {
+    const char *name;
+    const char *rate;
+    double loss;
+    double min;
+    double max;
+    double mean;
+    double deviation;
+};
+
+static const PathClass pathClasses[4] = {
+    { "generic",     "10Mb/s", 0, 160.000,  240.000, 200.000,  12.649 },
+    { "generic",     "10Mb/s", 0, 160.000,  240.000, 200.000,  12.649 },
+    /* Three HSPA + */
+    { "three-hspa+", "10Mb/s", 0,  43.600,  138.000,  61.939,  14.836 },
+    /* Three HSPA */
+    { "three-hspa",  "10Mb/s", 0, 323.140, 1510.172, 423.240, 224.801 },
+};
+
+/*Delay for one end of a link of the given class; file, if set, holds measured RTT samples*/
+Ptr<TraceRttRandomVariable> createRttRandomVariable(const PathClass &profile, std::string file)
 {
-    static Ptr<NormalRandomVariable> x =
-        createNormalRandomVariable(DEVICE_ONE_MEAN_RTT,
-                                   DEVICE_ONE_VARIANCE_RTT,
-                                   DEVICE_ONE_BOUNDS_RTT);
-    Ptr<Node> node = device->GetNode ();
-    Simulator::Schedule(MilliSeconds(x->GetValue()), &Node::NonPromiscReceiveFromDevice, node, device, pkt, protocol, from);
-    return  true;
+    Ptr<TraceRttRandomVariable> x = CreateObject<TraceRttRandomVariable> ();
+    x->SetAttribute ("File", StringValue (file));
+    x->SetAttribute ("Min", DoubleValue (profile.min));
+    x->SetAttribute ("Max", DoubleValue (profile.max));
+    x->SetAttribute ("Mean", DoubleValue (profile.mean));
+    x->SetAttribute ("Deviation", DoubleValue (profile.deviation));
+    x->SetAttribute ("Scale", DoubleValue (0.5));
+    return x;
 }
 
-
-bool netDevCbThree(
-  Ptr<NetDevice> device,
-  Ptr<const Packet> pkt,
-  uint16_t  protocol,
-const Address &from)
+/*Pcaps opened before a fork would be shared, so replications open theirs after it*/
+void enablePcap (LinkBundleHelper *bundle)
 {
-    static Ptr<NormalRandomVariable> x =
-        createNormalRandomVariable(DEVICE_TWO_MEAN_RTT,
-                                   DEVICE_TWO_VARIANCE_RTT,
-                                   DEVICE_TWO_BOUNDS_RTT);
-    Ptr<Node> node = device->GetNode ();
-    Simulator::Schedule(MilliSeconds(x->GetValue()), &Node::NonPromiscReceiveFromDevice, node, device, pkt, protocol, from);
-    return  true;
+    bundle->EnablePcap("mptcp-subflows");
 }
 
-
-bool netDevCbTwo(
-  Ptr<NetDevice> device,
-  Ptr<const Packet> pkt,
-  uint16_t  protocol,
-const Address &from)
+/*In simulator replacement for iperf -c [-B local]*/
+ApplicationContainer installBulkSender (Ptr<Node> node, Address remote, Address local)
 {
-    static Ptr<NormalRandomVariable> x =
-        createNormalRandomVariable(DEVICE_THREE_MEAN_RTT,
-                                   DEVICE_THREE_VARIANCE_RTT,
-                                   DEVICE_THREE_BOUNDS_RTT);
-    Ptr<Node> node = device->GetNode ();
-    Simulator::Schedule(MilliSeconds(x->GetValue()), &Node::NonPromiscReceiveFromDevice, node, device, pkt, protocol, from);
-    return  true;
+    Ptr<BulkSender> sender = CreateObject<BulkSender> ();
+    sender->SetAttribute ("Remote", AddressValue (remote));
+    sender->SetAttribute ("Local", AddressValue (local));
+    node->AddApplication (sender);
+    return ApplicationContainer (sender);
 }
 
-
-bool netDevCbOne(
-  Ptr<NetDevice> device,
-  Ptr<const Packet> pkt,
-  uint16_t  protocol,
-  const Address &from)
-{
-    static Ptr<NormalRandomVariable> x =
-        createNormalRandomVariable(DEVICE_FOUR_MEAN_RTT,
-                                   DEVICE_FOUR_VARIANCE_RTT,
-                                   DEVICE_FOUR_BOUNDS_RTT);
-    Ptr<Node> node = device->GetNode ();
-    Simulator::Schedule(MilliSeconds(x->GetValue()), &Node::NonPromiscReceiveFromDevice, node, device, pkt, protocol, from);
-    return  true;
-}
-
-
 void setPos (Ptr<Node> n, int x, int y, int z)
 {
     Ptr<ConstantPositionMobilityModel> loc = CreateObject<ConstantPositionMobilityModel> ();
@@ -135,12 +101,6 @@ void setPos (Ptr<Node> n, int x, int y, int z)
     loc->SetPosition (locVec2);
 }
 
-void
-PrintTcpFlags (std::string key, std::string value)
-{
-    std::cout << key << "=" << value;
-}
-
 int main (int argc, char *argv[])
 {
     double stopTime = 80.0;
@@ -151,40 +111,114 @@ int main (int argc, char *argv[])
     int mode = MODE_TCP;
     int debug = 0;
     int delay = 0;
+    std::string rttTraces;
+    std::string workload = "iperf";
+    bool pcap = true;
+    std::string pcapMode = "full";
+    std::string pcapMerge = "device";
+    uint32_t snaplen = 96;
+    bool flowStats = true;
+    uint32_t replications = 1;
+    double checkpoint = 0.5;
+    double warmup = 0;
+
 
-    Callback<bool, Ptr<NetDevice>, Ptr<const Packet>, uint16_t, const Address&> callbacks[4];
+    std::string cacheDir;
 
     CommandLine cmd;
-    cmd.AddValue ("stopTime", "StopTime of simulatino.", stopTime);
+    RunProfile profile ("dce-mptcp-subflow64");
+    profile.AddOptions (cmd);
+    cmd.AddValue ("stopTime", "Latest stop time of the simulation; it ends earlier once the iperf clients exit.", stopTime);
     cmd.AddValue ("p2pDelay", "Delay of p2p links. default is 50ms.", p2pdelay);
     cmd.AddValue ("flows", "Number of TCP flows. Default is 1", flows);
     cmd.AddValue ("mode", "TCP (0), MPTCP full mesh (1) or MPTCP ndifforts(2). Default is MPTCP full mesh.", mode);
     cmd.AddValue ("debug", "Turn MPTCP debug on or off", debug);
     cmd.AddValue ("ccalg", "Set TCP Congestion Control Algorithm.", ccalg);
     cmd.AddValue ("delay", "Set variable delay on or off", delay);
+    cmd.AddValue ("workload", "iperf to run iperf in DCE, native for in simulator senders and sinks on the same kernel sockets", workload);
+    cmd.AddValue ("rttTraces", "Comma separated RTT sample files, one per link class; empty entries use the built in summaries.", rttTraces);
+    cmd.AddValue ("replications", "Runs forked from the configured state, using RngRun, RngRun+1, ...; needs --delay or lossy links to differ", replications);
+    cmd.AddValue ("checkpoint", "Time setup is complete and replications fork, in seconds", checkpoint);
+    cmd.AddValue ("warmup", "Idle seconds between the checkpoint and the iperf servers starting", warmup);
+    cmd.AddValue ("pcap", "Write pcaps of the subflow links", pcap);
+    cmd.AddValue ("pcapMode", "full to capture everything, ring to keep the last frames in memory and write them around resets and throughput collapses", pcapMode);
+    cmd.AddValue ("pcapMerge", "In full mode, device for a pcap per device, node for a pcapng per node, all for one pcapng of every device", pcapMerge);
+    cmd.AddValue ("snaplen", "Bytes kept per frame in ring mode", snaplen);
+    cmd.AddValue ("flowStats", "Write per subflow throughput, retransmission and RTT bins to flow-stats.txt", flowStats);
+    cmd.AddValue ("cache", "Directory of cached run results, disabled if empty", cacheDir);
     cmd.Parse (argc, argv);
 
+    // Setup is all at 0; the servers follow the checkpoint, after any warm-up
+    Time start = Seconds (checkpoint + 0.5 + warmup);
+
+    profile.Install ();
+
+    if (workload != "iperf" && workload != "native") {
+        NS_FATAL_ERROR ("Unknown workload " << workload << ", expected iperf or native");
+    }
+    if (pcapMode != "full" && pcapMode != "ring") {
+        NS_FATAL_ERROR ("Unknown pcap mode " << pcapMode << ", expected full or ring");
+    }
+    if (pcapMerge != "device" && pcapMerge != "node" && pcapMerge != "all") {
+        NS_FATAL_ERROR ("Unknown pcap merge " << pcapMerge << ", expected device, node or all");
+    }
+
+    RunCache cache;
+    cache.Configure (cacheDir, argc, argv);
+    if (delay) {
+        std::stringstream traces (rttTraces);
+        std::string file;
+        while (std::getline(traces, file, ',')) {
+            cache.AddInput (file);
+        }
+    }
+    cache.AddOutput ("output-attributes.txt");
+    cache.AddOutput ("rep-*");
+    cache.AddOutput ("throughput.txt");
+    cache.AddOutput ("flow-stats.txt");
+    cache.AddOutput ("results.csv");
+    if (cache.Restore ()) {
+        return 0;
+    }
+
     PointToPointHelper pointToPointServer;
-    PointToPointHelper pointToPointClient;
+    LinkBundleHelper subflowLinks;
     NetDeviceContainer devices1, devices2, serverDevices;
 
     NodeContainer nodes;
     LinuxStackHelper stack;
     DceManagerHelper dceManager;
+    IpBatchHelper ipBatch;
+    ConfigAgent agent;
+    AddressPlan plan;
 
     NetDeviceContainer clientDevices;
 
-    if(delay){
-        callbacks[0] = MakeCallback(&netDevCbOne);
-        callbacks[1] = MakeCallback(&netDevCbTwo);
-        callbacks[2] = MakeCallback(&netDevCbThree);
-        callbacks[3] = MakeCallback(&netDevCbFour);
+    /*One path profile per link class, its delay distribution shared by all its links*/
+    std::stringstream traces (rttTraces);
+    for (int i = 0; i < 4; i++) {
+        LinkBundleHelper::PathProfile path;
+        path.name = pathClasses[i].name;
+        path.rate = DataRate (pathClasses[i].rate);
+        path.delay = Time (p2pdelay);
+        path.loss = pathClasses[i].loss;
+        if(delay){
+            std::string file;
+            std::getline(traces, file, ',');
+            path.jitter = createRttRandomVariable(pathClasses[i], file);
+            std::cout << "Link class " << i << ": " << (file.empty() ? pathClasses[i].name : file) << "\n";
+        }
+        subflowLinks.AddProfile (path);
     }
 
     GlobalValue::Bind ("ChecksumEnabled", BooleanValue (false));
     nodes.Create (3);
 
     dceManager.SetNetworkStack ("ns3::LinuxSocketFdFactory", "Library", StringValue ("liblinux.so"));
+    if (replications > 1) {
+        // Fiber threads would not survive the fork
+        dceManager.SetTaskManagerAttribute ("FiberManagerType", StringValue ("UcontextFiberManager"));
+    }
 
     stack.Install (nodes);
     dceManager.Install (nodes);
@@ -195,190 +229,94 @@ int main (int argc, char *argv[])
     pointToPointServer.SetChannelAttribute ("Delay", StringValue ("0ms"));
     serverDevices = pointToPointServer.Install(nodes.Get(1), nodes.Get(2));
 
+    /*Server is host 1 and the gateway host 2 of the server link*/
+    Ipv4Prefix serverLink = plan.Allocate(AddressPlan::BACKBONE, 30);
+    std::string serverAddress = Ipv4ToString(serverLink.GetHost(1));
+
     /*Setup Server Routes*/
-    LinuxStackHelper::RunIp (nodes.Get (2), Seconds (0.1), "link set up dev sim0");
-    LinuxStackHelper::RunIp (nodes.Get (2), Seconds (0.1), "addr add 172.16.1.1/24 dev sim0");
-    LinuxStackHelper::RunIp (nodes.Get (2), Seconds (0.1), "route add 192.168.0.0/16 via 172.16.1.10 dev sim0");
+    agent.SetLink (nodes.Get (2), Seconds (0), "sim0", true);
+    agent.AddAddress (nodes.Get (2), Seconds (0), "sim0", serverLink, 1);
+    agent.AddRoute (nodes.Get (2), Seconds (0), plan.GetPool(AddressPlan::GATEWAY), serverLink.GetHost(2), "sim0");
 
     /*Setup Gateway->Server*/
-    LinuxStackHelper::RunIp (nodes.Get (1), Seconds (0.1), "link set up dev sim0");
-    LinuxStackHelper::RunIp (nodes.Get (1), Seconds (0.1), "addr add 172.16.1.10/24 dev sim0");
-
+    agent.SetLink (nodes.Get (1), Seconds (0), "sim0", true);
+    agent.AddAddress (nodes.Get (1), Seconds (0), "sim0", serverLink, 2);
 
-    pointToPointClient.SetDeviceAttribute ("DataRate", StringValue ("10Mb/s"));
-    pointToPointClient.SetChannelAttribute ("Delay", StringValue (p2pdelay));
 
     setPos (nodes.Get (0), 50, 15, 0);
     setPos (nodes.Get (1), 100, 15, 0);
     setPos (nodes.Get (2), 150, 15, 0);
 
-    for (int i = 0; i < flows; i++){
-        NetDeviceContainer netDevContainer = pointToPointClient.Install(nodes.Get(0), nodes.Get(1));
-        Ptr<NetDevice> clientDevice = netDevContainer.Get(0);
-        Ptr<NetDevice> gatewayDevice = netDevContainer.Get(1);
-        if(delay){
-            int whichDelay = i % 4;
-            clientDevice->SetReceiveCallback(callbacks[whichDelay]);
-            gatewayDevice->SetReceiveCallback(callbacks[whichDelay]);
-        }
-
-        clientDevices.Add(clientDevice);
-
-        std::stringstream cmd;
-
-        /*Setup Client Addresses and routes*/
-
-        cmd << "link set up dev sim" << i;
-        LinuxStackHelper::RunIp (nodes.Get (0), Seconds (0.1), cmd.str());
-        cmd.str(std::string());
-
-        cmd << "addr add 192.168." << i << ".10/24 dev sim" << i;
-        LinuxStackHelper::RunIp (nodes.Get (0), Seconds (0.1), cmd.str());
-        cmd.str(std::string());
-
-        if(mode != MODE_TCP_LB){
-            cmd << "route add default via 192.168." << i << ".1 dev sim" << i << " metric " << i + 1;
-            LinuxStackHelper::RunIp (nodes.Get (0), Seconds (0.1), cmd.str());
-            cmd.str(std::string());
-        }
-
-        cmd << "rule add from 192.168." << i << ".0/24 lookup " << i + 1;
-        LinuxStackHelper::RunIp (nodes.Get (0), Seconds (0.1), cmd.str());
-        cmd.str(std::string());
-
-
-        cmd << "route add default via 192.168." << i << ".1 dev sim" << i << " table " << i + 1;
-        LinuxStackHelper::RunIp (nodes.Get (0), Seconds (0.1), cmd.str());
-        cmd.str(std::string());
-
-        cmd << "route add 192.168." << i << ".0/24 dev sim" << i << " table " << i + 1;
-        LinuxStackHelper::RunIp (nodes.Get (0), Seconds (0.1), cmd.str());
-        cmd.str(std::string());
-
-
-        //cmd << "rule add fwmark " << i + 1 << " lookup " << i + 1;
-        //LinuxStackHelper::RunIp (nodes.Get (0), Seconds (0.1), cmd.str());
-        //cmd.str(std::string());
-
-        /*Setup Gateway Addresses*/
-
-        cmd << "link set up dev sim" << i + 1;
-        LinuxStackHelper::RunIp (nodes.Get (1), Seconds (0.1), cmd.str());
-        cmd.str(std::string());
-
-        cmd << "addr add 192.168." << i << ".1/24 dev sim" << i + 1;
-        LinuxStackHelper::RunIp (nodes.Get (1), Seconds (0.1), cmd.str());
-        cmd.str(std::string());
-
-    }
+    /*Gateway is host 1 and the client host 2 of each subflow link; one routing table and rule per link on the client*/
+    clientDevices = subflowLinks.Install (nodes.Get (0), nodes.Get (1), flows, plan, AddressPlan::GATEWAY);
+    subflowLinks.Configure (agent, Seconds (0), 1);
     if (mode == MODE_TCP_LB){
-        std::stringstream cmd;
-        cmd.str(std::string());
-        cmd << "route add default scope global";
-        for (int i = 0; i < flows; i++){
-            cmd << " nexthop via 192.168." << i << ".1 dev sim" << i << " weight 1";
-        }
-        cmd << "";
-        std::cout << "LB Gateway: " << cmd.str() << "\n";
-        LinuxStackHelper::RunIp (nodes.Get (0), Seconds (0.1), cmd.str());
-    }
-
-    LinuxStackHelper::RunIp (nodes.Get (0), Seconds (1), "addr show");
-    LinuxStackHelper::RunIp (nodes.Get (0), Seconds (1), "rule show");
-    LinuxStackHelper::RunIp (nodes.Get (0), Seconds (1), "route show");
-
-    LinuxStackHelper::RunIp (nodes.Get (1), Seconds (1), "addr show");
-    LinuxStackHelper::RunIp (nodes.Get (1), Seconds (1), "rule show");
-    LinuxStackHelper::RunIp (nodes.Get (1), Seconds (1), "route show");
-
-    LinuxStackHelper::RunIp (nodes.Get (2), Seconds (1), "addr show");
-    LinuxStackHelper::RunIp (nodes.Get (2), Seconds (1), "rule show");
-    LinuxStackHelper::RunIp (nodes.Get (2), Seconds (1), "route show");
-
-    stack.SysctlSet (nodes, ".net.ipv4.conf.default.forwarding", "1");
-    stack.SysctlSet (nodes.Get (0), ".net.ipv4.tcp_low_latency", "1");
-    stack.SysctlSet (nodes.Get (0), ".net.ipv4.tcp_no_metrics_save", "1");
-    stack.SysctlSet (nodes.Get (0), ".net.ipv4.tcp_timestamps", "1");
-    stack.SysctlSet (nodes.Get (0), ".net.ipv4.tcp_sack", "1");
-    stack.SysctlSet (nodes.Get (0), ".net.ipv4.tcp_mem", "768174 10242330 15363480");
-    stack.SysctlSet (nodes.Get (0), ".net.ipv4.tcp_rmem", "4096 524288 204217728");
-    stack.SysctlSet (nodes.Get (0), ".net.ipv4.tcp_wmem", "4096 524288 204217728");
-    stack.SysctlSet (nodes.Get (0), ".net.core.wmem_max", "5242870");
-    stack.SysctlSet (nodes.Get (0), ".net.core.rmem_max","5242870");
-    stack.SysctlSet (nodes.Get (0), ".net.core.optmem_max","5242870");
-    stack.SysctlSet (nodes.Get (0), ".net.core.netdev_max_backlog", "25000000");
-
-    stack.SysctlSet (nodes.Get (1), ".net.ipv4.tcp_low_latency", "1");
-    stack.SysctlSet (nodes.Get (1), ".net.ipv4.tcp_no_metrics_save", "1");
-    stack.SysctlSet (nodes.Get (1), ".net.ipv4.tcp_timestamps", "1");
-    stack.SysctlSet (nodes.Get (1), ".net.ipv4.tcp_sack", "1");
-    stack.SysctlSet (nodes.Get (1), ".net.ipv4.tcp_mem", "768174 10242330 15363480");
-    stack.SysctlSet (nodes.Get (1), ".net.ipv4.tcp_rmem", "4096 524288 204217728");
-    stack.SysctlSet (nodes.Get (1), ".net.ipv4.tcp_wmem", "4096 524288 204217728");
-    stack.SysctlSet (nodes.Get (1), ".net.core.wmem_max", "5242870");
-    stack.SysctlSet (nodes.Get (1), ".net.core.rmem_max","5242870");
-    stack.SysctlSet (nodes.Get (1), ".net.core.optmem_max","5242870");
-    stack.SysctlSet (nodes.Get (1), ".net.core.netdev_max_backlog", "25000000");
-
-    stack.SysctlSet (nodes.Get (2), ".net.ipv4.tcp_low_latency", "1");
-    stack.SysctlSet (nodes.Get (2), ".net.ipv4.tcp_no_metrics_save", "1");
-    stack.SysctlSet (nodes.Get (2), ".net.ipv4.tcp_timestamps", "1");
-    stack.SysctlSet (nodes.Get (2), ".net.ipv4.tcp_sack", "1");
-    stack.SysctlSet (nodes.Get (2), ".net.ipv4.tcp_mem", "768174 10242330 15363480");
-    stack.SysctlSet (nodes.Get (2), ".net.ipv4.tcp_rmem", "4096 524288 204217728");
-    stack.SysctlSet (nodes.Get (2), ".net.ipv4.tcp_wmem", "4096 524288 204217728");
-    stack.SysctlSet (nodes.Get (2), ".net.core.wmem_max", "5242870");
-    stack.SysctlSet (nodes.Get (2), ".net.core.rmem_max","5242870");
-    stack.SysctlSet (nodes.Get (2), ".net.core.optmem_max","5242870");
-    stack.SysctlSet (nodes.Get (2), ".net.core.netdev_max_backlog", "25000000");
-
-    if(debug){
-        stack.SysctlSet (nodes, ".net.mptcp.mptcp_debug", "1");
+        std::cout << "LB Gateway: " << subflowLinks.GetN () << " next hops\n";
+        subflowLinks.AddMultipathRoute (agent, Seconds (0));
     } else {
-        stack.SysctlSet (nodes, ".net.mptcp.mptcp_debug", "0");
+        subflowLinks.AddDefaultRoutes (agent, Seconds (0));
     }
 
+    ipBatch.Add (nodes.Get (0), Seconds (0.1), "addr show");
+    ipBatch.Add (nodes.Get (0), Seconds (0.1), "rule show");
+    ipBatch.Add (nodes.Get (0), Seconds (0.1), "route show");
+
+    ipBatch.Add (nodes.Get (1), Seconds (0.1), "addr show");
+    ipBatch.Add (nodes.Get (1), Seconds (0.1), "rule show");
+    ipBatch.Add (nodes.Get (1), Seconds (0.1), "route show");
+
+    ipBatch.Add (nodes.Get (2), Seconds (0.1), "addr show");
+    ipBatch.Add (nodes.Get (2), Seconds (0.1), "rule show");
+    ipBatch.Add (nodes.Get (2), Seconds (0.1), "route show");
+
+    SysctlProfile sysctl = SysctlProfile::Lookup ("high-bdp-tcp");
+    sysctl.Set (".net.ipv4.conf.default.forwarding", "1");
+    sysctl.Set (".net.mptcp.mptcp_debug", debug ? "1" : "0");
     if (mode == MODE_MPTCP_FM) {
-        stack.SysctlSet (nodes, ".net.mptcp.mptcp_enabled", "1");
-        stack.SysctlSet (nodes, ".net.mptcp.mptcp_path_manager", "fullmesh");
-        stack.SysctlSet(nodes, ".net.ipv4.tcp_congestion_control", ccalg);
+        sysctl.Add (SysctlProfile::Lookup ("mptcp-fullmesh"));
     } else if (mode == MODE_MPTCP_ND) {
-        stack.SysctlSet (nodes, ".net.mptcp.mptcp_enabled", "1");
-        stack.SysctlSet (nodes, ".net.mptcp.mptcp_path_manager", "ndiffports");
-        stack.SysctlSet(nodes, ".net.ipv4.tcp_congestion_control", ccalg);
+        sysctl.Add (SysctlProfile::Lookup ("mptcp-ndiffports"));
     } else {
-        stack.SysctlSet (nodes, ".net.mptcp.mptcp_enabled", "0");
-        stack.SysctlSet(nodes, ".net.ipv4.tcp_congestion_control", ccalg);
+        sysctl.Add (SysctlProfile::Lookup ("tcp"));
     }
+    sysctl.Set (".net.ipv4.tcp_congestion_control", ccalg);
+    sysctl.Apply (nodes);
 
-
-    LinuxStackHelper::SysctlGet (nodes.Get (0), Seconds (1),".net.ipv4.tcp_available_congestion_control", &PrintTcpFlags);
-    LinuxStackHelper::SysctlGet (nodes.Get (0), Seconds (1),".net.ipv4.tcp_rmem", &PrintTcpFlags);
-    LinuxStackHelper::SysctlGet (nodes.Get (0), Seconds (1),".net.ipv4.tcp_wmem", &PrintTcpFlags);
-    LinuxStackHelper::SysctlGet (nodes.Get (0), Seconds (1),".net.ipv4.tcp_mem", &PrintTcpFlags);
-    LinuxStackHelper::SysctlGet (nodes.Get (0), Seconds (1),".net.core.rmem_max", &PrintTcpFlags);
-    LinuxStackHelper::SysctlGet (nodes.Get (0), Seconds (1),".net.core.wmem_max", &PrintTcpFlags);
-    LinuxStackHelper::SysctlGet (nodes.Get (0), Seconds (1),".net.core.optmem_max", &PrintTcpFlags);
-    LinuxStackHelper::SysctlGet (nodes.Get (0), Seconds (1),".net.core.netdev_max_backlog", &PrintTcpFlags);
-
-    LinuxStackHelper::SysctlGet (nodes.Get (0), Seconds (1),".net.mptcp.mptcp_enabled", &PrintTcpFlags);
-    LinuxStackHelper::SysctlGet (nodes.Get (0), Seconds (1),".net.mptcp.mptcp_path_manager", &PrintTcpFlags);
-    LinuxStackHelper::SysctlGet (nodes.Get (0), Seconds (1),".net.ipv4.tcp_congestion_control", &PrintTcpFlags);
+    std::vector<std::string> sysctlKeys = sysctl.GetKeys ();
+    sysctlKeys.push_back (".net.ipv4.tcp_available_congestion_control");
+    SysctlProfile::Print (nodes.Get (0), Seconds (0.1), sysctlKeys);
 
 
 
     DceApplicationHelper dce;
     ApplicationContainer apps;
+    ApplicationContainer clientApps;
 
     dce.SetStackSize (1 << 20);
 
+    Address serverSocket = InetSocketAddress (Ipv4Address (serverLink.GetHost(1)), 5001);
+    double iperfSeconds = atof (iperfTime.c_str ());
+
     // Launch iperf client on node 0
-    if (mode == MODE_MPTCP_FM || mode == MODE_MPTCP_ND) {
+    if (workload == "native") {
+        // Same connections as the iperf clients below, without the binary
+        int connections = (mode == MODE_MPTCP_FM || mode == MODE_MPTCP_ND) ? 1 : flows;
+        for (int i = 0; i < connections; i++) {
+            Address local;
+            if (mode == MODE_TCP) {
+                local = InetSocketAddress (Ipv4Address (subflowLinks.GetLink(i).GetHost(2)), 0);
+            }
+            clientApps.Add (installBulkSender (nodes.Get (0), serverSocket, local));
+        }
+        clientApps.Start (start + Seconds (2));
+        clientApps.Stop (start + Seconds (2 + iperfSeconds));
+        std::cout << "native: " << connections << " bulk senders to " << serverAddress << "\n";
+    } else if (mode == MODE_MPTCP_FM || mode == MODE_MPTCP_ND) {
         dce.SetBinary ("iperf");
         dce.ResetArguments ();
         dce.ResetEnvironment ();
         dce.AddArgument ("-c");
-        dce.AddArgument ("172.16.1.1");
+        dce.AddArgument (serverAddress);
         //dce.ParseArguments ("-y C");
         dce.AddArgument ("-i");
         dce.AddArgument ("1");
@@ -387,13 +325,14 @@ int main (int argc, char *argv[])
         dce.AddArgument ("-m");
 
         apps = dce.Install (nodes.Get (0));
-        apps.Start (Seconds (10.0));
-        std::cout << "iperf -c 172.16.1.1 -i 1 --time 60\n";
+        apps.Start (start + Seconds (2));
+        clientApps.Add (apps);
+        std::cout << "iperf -c " << serverAddress << " -i 1 --time 60\n";
     } else if(mode == MODE_TCP) {
         for(int i = 0; i < flows; i++){
             std::stringstream bind;
 
-            bind << "192.168." << i << ".10";
+            bind << Ipv4ToString(subflowLinks.GetLink(i).GetHost(2));
 
             dce.SetBinary ("iperf");
             dce.ResetArguments ();
@@ -401,7 +340,7 @@ int main (int argc, char *argv[])
             dce.AddArgument("-B");
             dce.AddArgument(bind.str());
             dce.AddArgument ("-c");
-            dce.AddArgument ("172.16.1.1");
+            dce.AddArgument (serverAddress);
             //dce.ParseArguments ("-y C");
             dce.AddArgument ("-i");
             dce.AddArgument ("1");
@@ -410,8 +349,9 @@ int main (int argc, char *argv[])
             dce.AddArgument ("-m");
 
             apps = dce.Install (nodes.Get (0));
-            apps.Start (Seconds (10.0));
-            std::cout << "iperf -c 172.16.1.1 -i 1 --time 60 -B" << bind.str() << "\n";
+            apps.Start (start + Seconds (2));
+            clientApps.Add (apps);
+            std::cout << "iperf -c " << serverAddress << " -i 1 --time 60 -B" << bind.str() << "\n";
         }
     } else {
         std::stringstream flowstr;
@@ -422,7 +362,7 @@ int main (int argc, char *argv[])
         dce.ResetArguments ();
         dce.ResetEnvironment ();
         dce.AddArgument ("-c");
-        dce.AddArgument ("172.16.1.1");
+        dce.AddArgument (serverAddress);
         dce.AddArgument("-P");
         dce.AddArgument(flowstr.str());
         //dce.ParseArguments ("-y C");
@@ -430,19 +370,59 @@ int main (int argc, char *argv[])
         dce.AddArgument (iperfTime);
 
         apps = dce.Install (nodes.Get (0));
-        apps.Start (Seconds (10.0));
-        std::cout << "iperf -c 172.16.1.1 -i 1 --time 60 -P" << flowstr.str() << "\n";
+        apps.Start (start + Seconds (2));
+        clientApps.Add (apps);
+        std::cout << "iperf -c " << serverAddress << " -i 1 --time 60 -P" << flowstr.str() << "\n";
     }
 
-    dce.SetBinary ("iperf");
-    dce.ResetArguments ();
-    dce.ResetEnvironment ();
-    dce.AddArgument ("-s");
+    ThroughputReporter throughput ("throughput.txt", Seconds (1));
+    ProcessLog results ("results.csv");
 
-    apps = dce.Install (nodes.Get (2));
-    apps.Start (Seconds (8.00));
+    if (workload == "native") {
+        PacketSinkHelper sink ("ns3::LinuxTcpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), 5001));
+        apps = sink.Install (nodes.Get (2));
+        apps.Start (start);
+        throughput.Watch (apps);
+        throughput.Start (start + Seconds (2));
+    } else {
+        dce.SetBinary ("iperf");
+        dce.ResetArguments ();
+        dce.ResetEnvironment ();
+        dce.AddArgument ("-s");
+
+        apps = dce.Install (nodes.Get (2));
+        apps.Start (start);
+        results.Watch (apps, "iperf server", ProcessLog::IPERF);
+        results.Watch (clientApps, "iperf client", ProcessLog::IPERF);
+    }
+
+    Replicator replicator (replications, Seconds (checkpoint));
+    std::vector<Ptr<RandomVariableStream> > streams = subflowLinks.GetStreams ();
+    for (size_t i = 0; i < streams.size(); i++) {
+        replicator.AddStream (streams[i]);
+    }
+    replicator.Install ();
+
+    RingPcap ring (snaplen);
+    PcapngCapture merged ("mptcp-subflows", pcapMerge == "all" ? PcapngCapture::MERGED : PcapngCapture::PER_NODE);
+    if (pcap && pcapMode == "ring") {
+        ring.Watch (clientDevices, "mptcp-subflows", false);
+        ring.TriggerOnReset ();
+        ring.TriggerOnCollapse (Seconds (1), 0.25, start + Seconds (4), start + Seconds (2 + iperfSeconds));
+    } else if (pcap && pcapMerge != "device" && replicator.IsEnabled ()) {
+        Simulator::Schedule (replicator.GetCheckpoint (), &PcapngCapture::Watch, &merged, clientDevices, std::string ("mptcp-subflows"), false);
+    } else if (pcap && pcapMerge != "device") {
+        merged.Watch (clientDevices, "mptcp-subflows", false);
+    } else if (pcap && replicator.IsEnabled ()) {
+        Simulator::Schedule (replicator.GetCheckpoint (), &enablePcap, &subflowLinks);
+    } else if (pcap) {
+        enablePcap (&subflowLinks);
+    }
 
-    pointToPointClient.EnablePcap("mptcp-subflows", clientDevices, false);
+    FlowStats stats;
+    if (flowStats) {
+        stats.Watch (clientDevices, "mptcp-subflows");
+    }
 
     LinuxStackHelper::PopulateRoutingTables ();
 
@@ -454,9 +434,45 @@ int main (int argc, char *argv[])
     outputConfig2.ConfigureDefaults ();
     outputConfig2.ConfigureAttributes ();
 
-    Simulator::Stop (Seconds (stopTime));
+    ipBatch.Install ();
+    agent.Install ();
+
+    // Stop once the clients are done, stopTime is only a cap
+    StopController stop (Seconds (stopTime));
+    if (workload == "native") {
+        stop.AddDeadline (start + Seconds (2 + iperfSeconds), "bulk senders");
+    } else {
+        stop.AddWorkload (clientApps, "iperf clients");
+    }
+    stop.Install ();
+    results.Install ();
+
+    profile.CountProcesses ();
+    profile.Phase ("configure");
+    profile.PhaseAt (start, "traffic");
     Simulator::Run ();
+    profile.Phase ("output");
+    stop.Report ();
+    results.Close ();
+    if (flowStats) {
+        stats.Write ("flow-stats.txt");
+    }
+    if (workload == "native") {
+        throughput.Report ();
+    }
+
+    subflowLinks.Report ();
+
+    profile.Phase ("destroy");
     Simulator::Destroy ();
+    ring.Close ();
+    merged.Close ();
+    profile.Report ();
+
+    if (replicator.Finish () > 0) {
+        return 1;
+    }
+    cache.Store ();
 
     return 0;
 }
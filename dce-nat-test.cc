@@ -15,6 +15,12 @@
 #include "ns3/constant-position-mobility-model.h"
 #include "ns3/config-store-module.h"
 
+#include "ip-batch-helper.h"
+#include "run-cache.h"
+#include "run-profile.h"
+#include "config-agent.h"
+#include "ipv4-prefix.h"
+
 using namespace ns3;
 
 #define MODE_TCP 0
@@ -55,7 +61,11 @@ int main (int argc, char *argv[])
     int delay = 0;
 
 
+    std::string cacheDir;
+
     CommandLine cmd;
+    RunProfile profile ("dce-nat-test");
+    profile.AddOptions (cmd);
     cmd.AddValue ("stopTime", "StopTime of simulatino.", stopTime);
     cmd.AddValue ("p2pDelay", "Delay of p2p links. default is 50ms.", p2pdelay);
     cmd.AddValue ("flows", "Number of TCP flows. Default is 1", flows);
@@ -63,8 +73,18 @@ int main (int argc, char *argv[])
     cmd.AddValue ("debug", "Turn MPTCP debug on or off", debug);
     cmd.AddValue ("ccalg", "Set TCP Congestion Control Algorithm.", ccalg);
     cmd.AddValue ("delay", "Set variable delay on or off", delay);
+    cmd.AddValue ("cache", "Directory of cached run results, disabled if empty", cacheDir);
     cmd.Parse (argc, argv);
 
+    profile.Install ();
+
+    RunCache cache;
+    cache.Configure (cacheDir, argc, argv);
+    cache.AddOutput ("output-attributes.txt");
+    if (cache.Restore ()) {
+        return 0;
+    }
+
     PointToPointHelper pointToPointServer;
     PointToPointHelper pointToPointClient;
     NetDeviceContainer devices1, devices2, serverDevices;
@@ -72,6 +92,8 @@ int main (int argc, char *argv[])
     NodeContainer nodes;
     LinuxStackHelper stack;
     DceManagerHelper dceManager;
+    IpBatchHelper ipBatch;
+    ConfigAgent agent;
 
     NetDeviceContainer clientDevices;
 
@@ -90,14 +112,15 @@ int main (int argc, char *argv[])
     pointToPointServer.SetChannelAttribute ("Delay", StringValue ("0ms"));
     serverDevices = pointToPointServer.Install(nodes.Get(1), nodes.Get(2));
 
+    Ipv4Prefix serverLan = Ipv4Prefix::FromString ("172.16.1.0/24");
+
     /*Setup Server Routes*/
-    LinuxStackHelper::RunIp (nodes.Get (2), Seconds (0.1), "link set up dev sim0");
-    LinuxStackHelper::RunIp (nodes.Get (2), Seconds (0.1), "addr add 172.16.1.1/24 dev sim0");
-    //LinuxStackHelper::RunIp (nodes.Get (2), Seconds (0.1), "route add 192.168.0.0/16 via 172.16.1.10 dev sim0");
+    agent.SetLink (nodes.Get (2), Seconds (0), "sim0", true);
+    agent.AddAddress (nodes.Get (2), Seconds (0), "sim0", serverLan, 1);
 
     /*Setup Gateway->Server*/
-    LinuxStackHelper::RunIp (nodes.Get (1), Seconds (0.1), "link set up dev sim0");
-    LinuxStackHelper::RunIp (nodes.Get (1), Seconds (0.1), "addr add 172.16.1.10/24 dev sim0");
+    agent.SetLink (nodes.Get (1), Seconds (0), "sim0", true);
+    agent.AddAddress (nodes.Get (1), Seconds (0), "sim0", serverLan, 10);
 
 
     pointToPointClient.SetDeviceAttribute ("DataRate", StringValue ("10Mb/s"));
@@ -113,58 +136,36 @@ int main (int argc, char *argv[])
         Ptr<NetDevice> gatewayDevice = netDevContainer.Get(1);
         clientDevices.Add(clientDevice);
 
-        std::stringstream cmd;
+        /*Client 192.168.<i>.10 on sim<i>, gateway 192.168.<i>.1 on sim<i+1>*/
+        Ipv4Prefix clientLan (Ipv4Prefix::FromString ("192.168.0.0/24").network + (i << 8), 24);
+        std::stringstream clientDev;
+        std::stringstream gatewayDev;
+        clientDev << "sim" << i;
+        gatewayDev << "sim" << i + 1;
 
         /*Setup Client Addresses and routes*/
+        agent.SetLink (nodes.Get (0), Seconds (0), clientDev.str(), true);
+        agent.AddAddress (nodes.Get (0), Seconds (0), clientDev.str(), clientLan, 10);
+        agent.AddRoute (nodes.Get (0), Seconds (0), Ipv4Prefix (), clientLan.GetHost(1), clientDev.str(), ConfigAgent::MAIN_TABLE, i + 1);
+        agent.AddRule (nodes.Get (0), Seconds (0), clientLan, "", i + 1);
+        agent.AddRoute (nodes.Get (0), Seconds (0), Ipv4Prefix (), clientLan.GetHost(1), clientDev.str(), i + 1);
 
-        cmd << "link set up dev sim" << i;
-        LinuxStackHelper::RunIp (nodes.Get (0), Seconds (0.1), cmd.str());
-        cmd.str(std::string());
-
-        cmd << "addr add 192.168." << i << ".10/24 dev sim" << i;
-        LinuxStackHelper::RunIp (nodes.Get (0), Seconds (0.1), cmd.str());
-        cmd.str(std::string());
-
-        cmd << "route add default via 192.168." << i << ".1 dev sim" << i << " metric " << i + 1;
-        LinuxStackHelper::RunIp (nodes.Get (0), Seconds (0.1), cmd.str());
-        cmd.str(std::string());
-
-        cmd << "rule add from 192.168." << i << ".0/24 lookup " << i + 1;
-        LinuxStackHelper::RunIp (nodes.Get (0), Seconds (0.1), cmd.str());
-        cmd.str(std::string());
-
-        cmd << "route add default via 192.168." << i << ".1 dev sim" << i << " table " << i + 1;
-        LinuxStackHelper::RunIp (nodes.Get (0), Seconds (0.1), cmd.str());
-        cmd.str(std::string());
-
-        /*
-        cmd << "rule add fwmark " << i + 1 << " lookup " << i + 1;
-        LinuxStackHelper::RunIp (nodes.Get (0), Seconds (0.1), cmd.str());
-        cmd.str(std::string());
-        */
         /*Setup Gateway Addresses*/
-
-        cmd << "link set up dev sim" << i + 1;
-        LinuxStackHelper::RunIp (nodes.Get (1), Seconds (0.1), cmd.str());
-        cmd.str(std::string());
-
-        cmd << "addr add 192.168." << i << ".1/24 dev sim" << i + 1;
-        LinuxStackHelper::RunIp (nodes.Get (1), Seconds (0.1), cmd.str());
-        cmd.str(std::string());
-
+        agent.SetLink (nodes.Get (1), Seconds (0), gatewayDev.str(), true);
+        agent.AddAddress (nodes.Get (1), Seconds (0), gatewayDev.str(), clientLan, 1);
     }
 
-    LinuxStackHelper::RunIp (nodes.Get (0), Seconds (1), "addr show");
-    LinuxStackHelper::RunIp (nodes.Get (0), Seconds (1), "rule show");
-    LinuxStackHelper::RunIp (nodes.Get (0), Seconds (1), "route show");
+    ipBatch.Add (nodes.Get (0), Seconds (1), "addr show");
+    ipBatch.Add (nodes.Get (0), Seconds (1), "rule show");
+    ipBatch.Add (nodes.Get (0), Seconds (1), "route show");
 
-    LinuxStackHelper::RunIp (nodes.Get (1), Seconds (1), "addr show");
-    LinuxStackHelper::RunIp (nodes.Get (1), Seconds (1), "rule show");
-    LinuxStackHelper::RunIp (nodes.Get (1), Seconds (1), "route show");
+    ipBatch.Add (nodes.Get (1), Seconds (1), "addr show");
+    ipBatch.Add (nodes.Get (1), Seconds (1), "rule show");
+    ipBatch.Add (nodes.Get (1), Seconds (1), "route show");
 
-    LinuxStackHelper::RunIp (nodes.Get (2), Seconds (1), "addr show");
-    LinuxStackHelper::RunIp (nodes.Get (2), Seconds (1), "rule show");
-    LinuxStackHelper::RunIp (nodes.Get (2), Seconds (1), "route show");
+    ipBatch.Add (nodes.Get (2), Seconds (1), "addr show");
+    ipBatch.Add (nodes.Get (2), Seconds (1), "rule show");
+    ipBatch.Add (nodes.Get (2), Seconds (1), "route show");
 
 
     if(debug){
@@ -179,21 +180,7 @@ int main (int argc, char *argv[])
 
     dce.SetStackSize (1 << 20);
 
-    dce.SetBinary ("xtables-multi");
-    dce.ResetArguments ();
-    dce.ResetEnvironment ();
-    dce.AddArgument ("iptables");
-    dce.AddArgument ("-t");
-    dce.AddArgument ("nat");
-    dce.AddArgument ("-A");
-    dce.AddArgument ("POSTROUTING");
-    dce.AddArgument ("-o");
-    dce.AddArgument ("sim0");
-    dce.AddArgument ("-j");
-    dce.AddArgument ("MASQUERADE");
-
-    apps = dce.Install(nodes.Get(1));
-    apps.Start(Seconds (2.0));
+    agent.Masquerade (nodes.Get(1), Seconds (0), "sim0");
 
     dce.SetBinary ("xtables-multi");
     dce.ResetArguments ();
@@ -228,9 +215,18 @@ int main (int argc, char *argv[])
     outputConfig2.ConfigureDefaults ();
     outputConfig2.ConfigureAttributes ();
 
+    ipBatch.Install ();
+    agent.Install ();
+
     Simulator::Stop (Seconds (stopTime));
+    profile.CountProcesses ();
+    profile.Phase ("configure");
+    profile.PhaseAt (Seconds (2.0), "traffic");
     Simulator::Run ();
+    profile.Phase ("destroy");
     Simulator::Destroy ();
+    profile.Report ();
+    cache.Store ();
 
     return 0;
 }
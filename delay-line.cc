@@ -0,0 +1,159 @@
+#include "delay-line.h"
+
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/pointer.h"
+
+NS_LOG_COMPONENT_DEFINE ("DelayLine");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (DelayLine);
+
+TypeId
+DelayLine::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::DelayLine")
+        .SetParent<Object> ()
+        .AddConstructor<DelayLine> ()
+        .AddAttribute ("Delay",
+                       "Random delay added to each received packet, in milliseconds.",
+                       StringValue ("ns3::ConstantRandomVariable[Constant=0]"),
+                       MakePointerAccessor (&DelayLine::m_delay),
+                       MakePointerChecker<RandomVariableStream> ())
+        .AddAttribute ("Resolution",
+                       "Packets due within this time of the head of the line are delivered with it.",
+                       TimeValue (Seconds (0)),
+                       MakeTimeAccessor (&DelayLine::m_resolution),
+                       MakeTimeChecker ())
+        ;
+    return tid;
+}
+
+DelayLine::DelayLine ()
+    : m_nReceived (0),
+      m_nDelivered (0),
+      m_nHeld (0),
+      m_nEvents (0),
+      m_maxQueued (0)
+{
+}
+
+void
+DelayLine::SetDelay (Ptr<RandomVariableStream> delay)
+{
+    m_delay = delay;
+}
+
+void
+DelayLine::Install (Ptr<NetDevice> device)
+{
+    m_device = device;
+    device->SetReceiveCallback (MakeCallback (&DelayLine::Receive, this));
+    device->AggregateObject (this);
+}
+
+bool
+DelayLine::Receive (Ptr<NetDevice> device, Ptr<const Packet> packet,
+                    uint16_t protocol, const Address &from)
+{
+    double ms = m_delay->GetValue();
+    Time at = Simulator::Now() + (ms > 0 ? Time::FromDouble(ms, Time::MS) : Time (0));
+
+    if (at < m_last) {
+        at = m_last;
+        m_nHeld++;
+    }
+    m_last = at;
+
+    Pending p;
+    p.at = at;
+    p.packet = packet;
+    p.protocol = protocol;
+    p.from = from;
+    m_queue.push_back(p);
+
+    m_nReceived++;
+    if (m_queue.size() > m_maxQueued) {
+        m_maxQueued = m_queue.size();
+    }
+
+    if (!m_event.IsRunning()) {
+        ScheduleHead();
+    }
+    return true;
+}
+
+void
+DelayLine::ScheduleHead (void)
+{
+    m_event = Simulator::Schedule (m_queue.front().at - Simulator::Now(), &DelayLine::Deliver, this);
+    m_nEvents++;
+}
+
+void
+DelayLine::Deliver (void)
+{
+    Ptr<Node> node = m_device->GetNode();
+    Time until = Simulator::Now() + m_resolution;
+
+    while (!m_queue.empty() && m_queue.front().at <= until) {
+        /* Copy out first, the node may re-enter Receive on this line. */
+        Pending p = m_queue.front();
+        m_queue.pop_front();
+        m_nDelivered++;
+        node->NonPromiscReceiveFromDevice(m_device, p.packet, p.protocol, p.from);
+    }
+
+    if (!m_queue.empty() && !m_event.IsRunning()) {
+        ScheduleHead();
+    }
+}
+
+uint64_t
+DelayLine::GetNReceived (void) const
+{
+    return m_nReceived;
+}
+
+uint64_t
+DelayLine::GetNDelivered (void) const
+{
+    return m_nDelivered;
+}
+
+uint32_t
+DelayLine::GetNQueued (void) const
+{
+    return m_queue.size();
+}
+
+uint32_t
+DelayLine::GetMaxQueued (void) const
+{
+    return m_maxQueued;
+}
+
+uint64_t
+DelayLine::GetNHeld (void) const
+{
+    return m_nHeld;
+}
+
+uint64_t
+DelayLine::GetNEvents (void) const
+{
+    return m_nEvents;
+}
+
+void
+DelayLine::DoDispose (void)
+{
+    m_event.Cancel();
+    m_queue.clear();
+    m_device = 0;
+    m_delay = 0;
+    Object::DoDispose();
+}
+
+}
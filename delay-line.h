@@ -0,0 +1,89 @@
+#ifndef DELAY_LINE_H
+#define DELAY_LINE_H
+
+#include "ns3/object.h"
+#include "ns3/net-device.h"
+#include "ns3/node.h"
+#include "ns3/packet.h"
+#include "ns3/address.h"
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+#include "ns3/random-variable-stream.h"
+
+#include <deque>
+
+namespace ns3 {
+
+/**
+ * Adds a random delay to every packet a NetDevice receives before it is
+ * handed to the node, replacing receive callbacks that schedule one
+ * simulator event per packet.
+ *
+ * Packets wait in a FIFO and only the head has an event pending, so the
+ * scheduler holds at most one event per device however busy the link is.
+ * A packet is never released before the one in front of it: when the
+ * sampled delay would overtake, it leaves together with its predecessor
+ * instead, so jitter never reorders a flow.
+ *
+ * The "Delay" stream is in milliseconds; negative samples count as zero.
+ * Packets due within "Resolution" of the head leave in the same event.
+ */
+class DelayLine : public Object
+{
+public:
+    static TypeId GetTypeId (void);
+
+    DelayLine ();
+
+    void SetDelay (Ptr<RandomVariableStream> delay);
+
+    /**
+    * Take over device's receive callback and aggregate this line to the
+    * device, so it can later be found with GetObject<DelayLine>.
+    */
+    void Install (Ptr<NetDevice> device);
+
+    /* Packets received, handed to the node, and still waiting. */
+    uint64_t GetNReceived (void) const;
+    uint64_t GetNDelivered (void) const;
+    uint32_t GetNQueued (void) const;
+    uint32_t GetMaxQueued (void) const;
+    /* Packets held back behind their predecessor to keep order. */
+    uint64_t GetNHeld (void) const;
+    /* Simulator events scheduled by this line. */
+    uint64_t GetNEvents (void) const;
+
+protected:
+    virtual void DoDispose (void);
+
+private:
+    struct Pending {
+        Time at;
+        Ptr<const Packet> packet;
+        uint16_t protocol;
+        Address from;
+    };
+
+    bool Receive (Ptr<NetDevice> device, Ptr<const Packet> packet,
+                  uint16_t protocol, const Address &from);
+    void Deliver (void);
+    void ScheduleHead (void);
+
+    Ptr<NetDevice> m_device;
+    Ptr<RandomVariableStream> m_delay;
+    Time m_resolution;
+
+    std::deque<Pending> m_queue;
+    Time m_last;
+    EventId m_event;
+
+    uint64_t m_nReceived;
+    uint64_t m_nDelivered;
+    uint64_t m_nHeld;
+    uint64_t m_nEvents;
+    uint32_t m_maxQueued;
+};
+
+}
+
+#endif /* DELAY_LINE_H */
@@ -0,0 +1,217 @@
+#include "flow-stats.h"
+#include "ipv4-prefix.h"
+
+#include "ns3/node.h"
+#include "ns3/simulator.h"
+#include "ns3/log.h"
+#include "ns3/fatal-error.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+NS_LOG_COMPONENT_DEFINE ("FlowStats");
+
+namespace ns3 {
+
+bool
+FlowStats::Key::operator< (const Key &o) const
+{
+    if (device != o.device) return device < o.device;
+    if (tx != o.tx) return tx < o.tx;
+    if (protocol != o.protocol) return protocol < o.protocol;
+    if (src != o.src) return src < o.src;
+    if (dst != o.dst) return dst < o.dst;
+    if (sport != o.sport) return sport < o.sport;
+    return dport < o.dport;
+}
+
+FlowStats::FlowStats (Time binWidth)
+    : m_binWidth (binWidth)
+{
+}
+
+void
+FlowStats::Watch (NetDeviceContainer devices, std::string prefix)
+{
+    for (NetDeviceContainer::Iterator it = devices.Begin(); it != devices.End(); ++it) {
+        Ptr<NetDevice> device = *it;
+        std::string type = device->GetInstanceTypeId().GetName();
+        if (type != "ns3::PointToPointNetDevice" && type != "ns3::CsmaNetDevice"
+            && type != "ns3::BroadcastNetDevice") {
+            NS_FATAL_ERROR ("FlowStats can not read " << type << " frames");
+        }
+
+        std::ostringstream name;
+        name << prefix << "-" << device->GetNode()->GetId() << "-" << device->GetIfIndex();
+        m_devices.push_back(name.str());
+        m_ppp.push_back(type == "ns3::PointToPointNetDevice");
+
+        /* Frames as they go on and come off the wire, for this host. */
+        std::ostringstream context;
+        context << m_devices.size() - 1;
+        device->TraceConnect("PhyTxBegin", context.str(), MakeCallback (&FlowStats::Tx, this));
+        device->TraceConnect("MacRx", context.str(), MakeCallback (&FlowStats::Rx, this));
+    }
+}
+
+void
+FlowStats::Tx (std::string context, Ptr<const Packet> packet)
+{
+    Observe(atoi(context.c_str()), true, packet);
+}
+
+void
+FlowStats::Rx (std::string context, Ptr<const Packet> packet)
+{
+    Observe(atoi(context.c_str()), false, packet);
+}
+
+void
+FlowStats::Observe (uint32_t device, bool tx, Ptr<const Packet> packet)
+{
+    uint8_t buf[128];
+    FrameHeaders h;
+    if (!h.Parse(buf, packet->CopyData(buf, sizeof(buf)), m_ppp[device])) {
+        return;
+    }
+
+    Key key;
+    key.device = device;
+    key.tx = tx;
+    key.protocol = h.protocol;
+    key.src = h.src;
+    key.dst = h.dst;
+    key.sport = h.sport;
+    key.dport = h.dport;
+    uint32_t payload = h.payload;
+
+    Flow &flow = GetFlow(key);
+    Bin &bin = GetBin(flow);
+    bin.packets++;
+    bin.bytes += payload;
+    flow.packets++;
+    flow.bytes += payload;
+
+    if (!h.tcp) {
+        return;
+    }
+
+    /* Sent data below the highest sequence is a resend, reordered or not. */
+    if (tx && payload > 0 &&
+        flow.segments.Data(h.seq, payload, Simulator::Now().GetSeconds()) != SegmentTracker::NEW) {
+        bin.retrans++;
+        flow.retrans++;
+    }
+
+    if (!tx && (h.flags & FrameHeaders::TCP_ACK)) {
+        Key reverse = key;
+        reverse.tx = true;
+        reverse.src = key.dst;
+        reverse.dst = key.src;
+        reverse.sport = key.dport;
+        reverse.dport = key.sport;
+        std::map<Key, uint32_t>::iterator it = m_index.find(reverse);
+        if (it != m_index.end()) {
+            Ack(m_flows[it->second], h.ack);
+        }
+    }
+}
+
+void
+FlowStats::Ack (Flow &flow, uint32_t ack)
+{
+    double rtt;
+    if (!flow.segments.Ack(ack, Simulator::Now().GetSeconds(), rtt)) {
+        return;
+    }
+
+    Bin &bin = GetBin(flow);
+    bin.rttSamples++;
+    bin.rttSum += rtt;
+    if (flow.rttSamples == 0 || rtt < flow.rttMin) {
+        flow.rttMin = rtt;
+    }
+    if (flow.rttSamples == 0 || rtt > flow.rttMax) {
+        flow.rttMax = rtt;
+    }
+    flow.rttSamples++;
+    flow.rttSum += rtt;
+}
+
+FlowStats::Flow &
+FlowStats::GetFlow (const Key &key)
+{
+    std::map<Key, uint32_t>::iterator it = m_index.find(key);
+    if (it != m_index.end()) {
+        return m_flows[it->second];
+    }
+
+    Flow flow;
+    flow.key = key;
+    flow.packets = 0;
+    flow.bytes = 0;
+    flow.retrans = 0;
+    flow.rttSamples = 0;
+    flow.rttSum = 0;
+    flow.rttMin = 0;
+    flow.rttMax = 0;
+    m_flows.push_back(flow);
+    m_index[key] = m_flows.size() - 1;
+    return m_flows.back();
+}
+
+FlowStats::Bin &
+FlowStats::GetBin (Flow &flow)
+{
+    uint32_t index = Simulator::Now().GetInteger() / m_binWidth.GetInteger();
+    if (index >= flow.bins.size()) {
+        Bin empty = { 0, 0, 0, 0, 0 };
+        flow.bins.resize(index + 1, empty);
+    }
+    return flow.bins[index];
+}
+
+uint32_t
+FlowStats::GetNFlows (void) const
+{
+    return m_flows.size();
+}
+
+void
+FlowStats::Write (std::string file) const
+{
+    std::ofstream out (file.c_str());
+    if (!out.is_open()) {
+        NS_FATAL_ERROR ("Could not open " << file);
+    }
+
+    for (uint32_t i = 0; i < m_flows.size(); i++) {
+        const Flow &f = m_flows[i];
+        out << "flow " << i << " " << m_devices[f.key.device] << " " << (f.key.tx ? "tx" : "rx")
+            << " " << (uint32_t)f.key.protocol
+            << " " << Ipv4ToString(f.key.src) << ":" << f.key.sport
+            << " " << Ipv4ToString(f.key.dst) << ":" << f.key.dport
+            << " " << f.packets << " " << f.bytes << " " << f.retrans;
+        if (f.rttSamples > 0) {
+            out << " " << f.rttMin << "/" << f.rttSum / f.rttSamples << "/" << f.rttMax;
+        } else {
+            out << " -";
+        }
+        out << "\n";
+
+        for (uint32_t b = 0; b < f.bins.size(); b++) {
+            const Bin &bin = f.bins[b];
+            if (bin.packets == 0 && bin.rttSamples == 0) {
+                continue;
+            }
+            out << "bin " << i << " " << b * m_binWidth.GetSeconds() << " " << bin.packets << " "
+                << bin.bytes << " " << bin.retrans << " " << bin.rttSamples << " "
+                << (bin.rttSamples > 0 ? bin.rttSum / bin.rttSamples : 0) << "\n";
+        }
+    }
+
+    NS_LOG_INFO (file << ": " << m_flows.size() << " flows");
+}
+
+}
@@ -0,0 +1,97 @@
+#ifndef FLOW_STATS_H
+#define FLOW_STATS_H
+
+#include "ns3/net-device-container.h"
+#include "ns3/packet.h"
+#include "ns3/nstime.h"
+
+#include "frame-headers.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * Per flow statistics taken on devices while the simulation runs, for
+ * runs that only kept pcaps to work out throughput and RTT.
+ *
+ * Watch hooks the "PhyTxBegin" and "MacRx" traces of point to point and
+ * CSMA devices and reads just the IPv4 and TCP/UDP headers of each frame.
+ * A flow is one 5-tuple in one direction on one device, so every MPTCP
+ * subflow is a flow of its own. Per flow and per time bin it keeps
+ * packets, payload bytes, retransmissions (TCP data below the highest
+ * sequence already sent) and RTT samples (time from sending data to
+ * the ACK covering it coming back through the same device, retransmitted
+ * data excluded), both from a SegmentTracker as in mptcp-analyzer.
+ * Memory is a few counters per bin and at most
+ * SegmentTracker::MAX_OUTSTANDING unacknowledged segments per flow.
+ *
+ * Write produces one text file:
+ *
+ *   flow <id> <device> <tx|rx> <proto> <src>:<port> <dst>:<port> <packets> <bytes> <retrans> <rtt min/mean/max ms>
+ *   bin <id> <start s> <packets> <bytes> <retrans> <rtt samples> <rtt mean ms>
+ *
+ * with bin lines only for bins that saw packets.
+ */
+class FlowStats
+{
+public:
+    FlowStats (Time binWidth = Seconds (1));
+
+    /* Devices are named <prefix>-<node>-<device>, like their pcaps. */
+    void Watch (NetDeviceContainer devices, std::string prefix);
+
+    void Write (std::string file) const;
+
+    uint32_t GetNFlows (void) const;
+
+private:
+    struct Key {
+        uint32_t device;
+        bool tx;
+        uint8_t protocol;
+        uint32_t src;
+        uint32_t dst;
+        uint16_t sport;
+        uint16_t dport;
+        bool operator< (const Key &o) const;
+    };
+    struct Bin {
+        uint32_t packets;
+        uint64_t bytes;
+        uint32_t retrans;
+        uint32_t rttSamples;
+        double rttSum;
+    };
+    struct Flow {
+        Key key;
+        std::vector<Bin> bins;
+        uint64_t packets;
+        uint64_t bytes;
+        uint32_t retrans;
+        uint32_t rttSamples;
+        double rttSum;
+        double rttMin;
+        double rttMax;
+        SegmentTracker segments;
+    };
+
+    void Tx (std::string context, Ptr<const Packet> packet);
+    void Rx (std::string context, Ptr<const Packet> packet);
+    void Observe (uint32_t device, bool tx, Ptr<const Packet> packet);
+    Flow &GetFlow (const Key &key);
+    Bin &GetBin (Flow &flow);
+    void Ack (Flow &flow, uint32_t ack);
+
+    Time m_binWidth;
+    std::vector<std::string> m_devices;
+    std::vector<bool> m_ppp;
+    std::vector<Flow> m_flows;
+    std::map<Key, uint32_t> m_index;
+};
+
+}
+
+#endif /* FLOW_STATS_H */
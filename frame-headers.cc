@@ -0,0 +1,141 @@
+#include "frame-headers.h"
+
+namespace ns3 {
+
+static uint16_t
+read16 (const uint8_t *p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+static uint32_t
+read32 (const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+bool
+FrameHeaders::Parse (const uint8_t *buf, uint32_t len, bool ppp)
+{
+    uint32_t ip;
+
+    /* PPP: 2 byte protocol, 0x0021 for IPv4. Ethernet: DIX, or LLC/SNAP. Else bare IP. */
+    if (ppp && len >= 2 && read16(buf) == 0x0021) {
+        ip = 2;
+    } else if (!ppp && len >= 14 && read16(buf + 12) == 0x0800) {
+        ip = 14;
+    } else if (!ppp && len >= 22 && buf[14] == 0xaa && buf[15] == 0xaa && read16(buf + 20) == 0x0800) {
+        ip = 22;
+    } else {
+        ip = 0;
+    }
+    if (len < ip + 20 || (buf[ip] >> 4) != 4) {
+        return false;
+    }
+
+    uint32_t ihl = (buf[ip] & 0x0f) * 4;
+    uint32_t total = read16(buf + ip + 2);
+    uint32_t l4 = ip + ihl;
+
+    protocol = buf[ip + 9];
+    src = read32(buf + ip + 12);
+    dst = read32(buf + ip + 16);
+    sport = 0;
+    dport = 0;
+    payload = total > ihl ? total - ihl : 0;
+    tcp = protocol == 6 && len >= l4 + 20;
+    seq = 0;
+    ack = 0;
+    flags = 0;
+    options = 0;
+    optionsLength = 0;
+
+    if (tcp) {
+        sport = read16(buf + l4);
+        dport = read16(buf + l4 + 2);
+        seq = read32(buf + l4 + 4);
+        ack = read32(buf + l4 + 8);
+        uint32_t doff = (buf[l4 + 12] >> 4) * 4;
+        flags = buf[l4 + 13];
+        payload = payload > doff ? payload - doff : 0;
+        if (doff > 20) {
+            options = l4 + 20;
+            optionsLength = len - options < doff - 20 ? len - options : doff - 20;
+        }
+    } else if (protocol == 17 && len >= l4 + 8) {
+        sport = read16(buf + l4);
+        dport = read16(buf + l4 + 2);
+        payload = payload > 8 ? payload - 8 : 0;
+    }
+    return true;
+}
+
+SegmentTracker::SegmentTracker ()
+    : seqBase (false),
+      isn (0),
+      highest (0),
+      acked (0)
+{
+}
+
+void
+SegmentTracker::Syn (uint32_t seq)
+{
+    seqBase = true;
+    isn = seq;
+    highest = 1;
+    acked = 0;
+    outstanding.clear();
+}
+
+SegmentTracker::Kind
+SegmentTracker::Data (uint32_t seq, uint32_t payload, double t)
+{
+    if (!seqBase) {
+        seqBase = true;
+        isn = seq;
+        highest = 0;
+        acked = 0;
+    }
+
+    uint32_t end = seq - isn + payload;
+    if (end <= acked || outstanding.count(end)) {
+        /* Karn: the ACK can not tell which copy it is for. */
+        outstanding.erase(end);
+        return RETRANSMITTED;
+    }
+    if (end <= highest) {
+        return REORDERED;
+    }
+    highest = end;
+    outstanding[end] = t;
+    if (outstanding.size() > MAX_OUTSTANDING) {
+        outstanding.erase(outstanding.begin());
+    }
+    return NEW;
+}
+
+bool
+SegmentTracker::Ack (uint32_t ack, double t, double &rtt)
+{
+    if (!seqBase) {
+        return false;
+    }
+    uint32_t relative = ack - isn;
+    if ((int32_t)(relative - acked) > 0) {
+        acked = relative;
+    }
+
+    std::map<uint32_t, double>::iterator end = outstanding.upper_bound(relative);
+    if (end == outstanding.begin()) {
+        return false;
+    }
+    /* Sample the newest segment this ACK covers, then forget all of them. */
+    std::map<uint32_t, double>::iterator last = end;
+    --last;
+    rtt = (t - last->second) * 1000;
+    outstanding.erase(outstanding.begin(), end);
+    return true;
+}
+
+}
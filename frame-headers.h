@@ -0,0 +1,85 @@
+#ifndef FRAME_HEADERS_H
+#define FRAME_HEADERS_H
+
+#include <stdint.h>
+
+#include <map>
+
+namespace ns3 {
+
+/**
+ * The IPv4 and TCP/UDP header fields of a captured frame, read straight
+ * from its bytes. ppp frames start with a 2 byte PPP protocol, others
+ * with an Ethernet (DIX or LLC/SNAP) header; a frame that starts with
+ * neither is taken to be bare IPv4.
+ */
+struct FrameHeaders
+{
+    enum {
+        TCP_FIN = 0x01,
+        TCP_SYN = 0x02,
+        TCP_RST = 0x04,
+        TCP_ACK = 0x10
+    };
+
+    uint8_t protocol;
+    uint32_t src;
+    uint32_t dst;
+    /* 0 unless TCP or UDP */
+    uint16_t sport;
+    uint16_t dport;
+    /* Transport payload, or IP payload for other protocols */
+    uint32_t payload;
+
+    bool tcp;
+    uint32_t seq;
+    uint32_t ack;
+    uint8_t flags;
+    /* TCP options: offset in the frame and length, cut to what was captured */
+    uint32_t options;
+    uint32_t optionsLength;
+
+    /* False if the frame holds no IPv4 header. */
+    bool Parse (const uint8_t *buf, uint32_t len, bool ppp);
+};
+
+/**
+ * Retransmissions and RTT samples of the data one direction of a TCP
+ * connection carries, as seen at one interface. Sequence numbers are
+ * relative to the SYN, or to the first data if the SYN was not seen;
+ * times are in seconds. Data counts as retransmitted when it was already
+ * ACKed or is still outstanding, and as reordered when it is below the
+ * highest sequence but was not seen before. An ACK samples the RTT of the
+ * newest segment it covers; retransmitted data is not sampled (Karn).
+ * At most MAX_OUTSTANDING unacknowledged segments are kept.
+ */
+struct SegmentTracker
+{
+    static const uint32_t MAX_OUTSTANDING = 4096;
+
+    enum Kind {
+        NEW,
+        RETRANSMITTED,
+        REORDERED
+    };
+
+    SegmentTracker ();
+
+    /* A SYN with sequence number seq restarts the sequence space. */
+    void Syn (uint32_t seq);
+    /* payload bytes of data at seq, seen at t */
+    Kind Data (uint32_t seq, uint32_t payload, double t);
+    /* An ACK for this data seen at t; false if it gave no RTT sample, else rtt in ms. */
+    bool Ack (uint32_t ack, double t, double &rtt);
+
+    bool seqBase;
+    uint32_t isn;
+    uint32_t highest;
+    uint32_t acked;
+    /* Send time of each unacknowledged segment, by its relative end sequence */
+    std::map<uint32_t, double> outstanding;
+};
+
+}
+
+#endif /* FRAME_HEADERS_H */
@@ -0,0 +1,103 @@
+#include "ip-batch-helper.h"
+#include "node-files.h"
+
+#include "ns3/dce-module.h"
+#include "ns3/log.h"
+
+#include <fstream>
+#include <sstream>
+
+NS_LOG_COMPONENT_DEFINE ("IpBatchHelper");
+
+namespace ns3 {
+
+IpBatchHelper::IpBatchHelper ()
+    : m_nCommands (0),
+      m_stackSize (1 << 16)
+{
+}
+
+void
+IpBatchHelper::Add (Ptr<Node> n, Time at, std::string cmd)
+{
+    std::pair<uint32_t, int64_t> key (n->GetId(), at.GetNanoSeconds());
+    Batch &batch = m_batches[key];
+    if (batch.cmds.empty()) {
+        batch.node = n;
+        batch.at = at;
+    }
+    batch.cmds.push_back(cmd);
+    m_nCommands++;
+}
+
+void
+IpBatchHelper::SetStackSize (uint32_t stackSize)
+{
+    m_stackSize = stackSize;
+}
+
+std::string
+IpBatchHelper::WriteBatchFile (const Batch &batch) const
+{
+    std::string dir = "/etc/ip-batch";
+    std::stringstream file;
+    file << "/" << batch.at.GetNanoSeconds() << ".batch";
+
+    std::string hostPath = MakeNodeDirectory(batch.node->GetId(), dir) + file.str();
+    std::ofstream out (hostPath.c_str(), std::ios::out | std::ios::trunc);
+    if (!out.is_open()) {
+        NS_FATAL_ERROR ("Could not write ip batch file " << hostPath);
+    }
+    for (std::vector<std::string>::const_iterator it = batch.cmds.begin(); it != batch.cmds.end(); ++it) {
+        out << *it << "\n";
+    }
+    out.close();
+
+    return dir + file.str();
+}
+
+ApplicationContainer
+IpBatchHelper::Install (void)
+{
+    DceApplicationHelper process;
+    ApplicationContainer apps;
+
+    process.SetBinary ("ip");
+    process.SetStackSize (m_stackSize);
+
+    for (BatchMap::const_iterator it = m_batches.begin(); it != m_batches.end(); ++it) {
+        const Batch &batch = it->second;
+        std::string file = WriteBatchFile(batch);
+
+        NS_LOG_DEBUG ("node " << batch.node->GetId() << " at " << batch.at.GetSeconds()
+                      << "s: " << batch.cmds.size() << " commands in " << file);
+
+        process.ResetArguments ();
+        process.ResetEnvironment ();
+        process.AddArgument ("-force");
+        process.AddArgument ("-batch");
+        process.AddArgument (file);
+
+        ApplicationContainer batchApps = process.Install (batch.node);
+        batchApps.Start (batch.at);
+        apps.Add (batchApps);
+    }
+
+    std::cout << "ip: " << m_nCommands << " commands in " << m_batches.size() << " processes\n";
+
+    return apps;
+}
+
+uint32_t
+IpBatchHelper::GetNCommands (void) const
+{
+    return m_nCommands;
+}
+
+uint32_t
+IpBatchHelper::GetNBatches (void) const
+{
+    return m_batches.size();
+}
+
+}
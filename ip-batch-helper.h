@@ -0,0 +1,66 @@
+#ifndef IP_BATCH_HELPER_H
+#define IP_BATCH_HELPER_H
+
+#include "ns3/node.h"
+#include "ns3/nstime.h"
+#include "ns3/application-container.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * Collects `ip` commands per node and runs them as one `ip -force -batch`
+ * DCE process per node and start time.
+ *
+ * LinuxStackHelper::RunIp starts a separate DCE process for every command,
+ * so configuration cost grows with the number of commands. Commands added
+ * here for the same node and time are written, in order, to a batch file in
+ * that node's DCE file tree (files-<id>/etc/ip-batch/) and executed by a
+ * single process. -force keeps going after a failing line, which matches the
+ * independent RunIp calls it replaces.
+ */
+class IpBatchHelper
+{
+public:
+    IpBatchHelper ();
+
+    /**
+    * Queue an ip command (without the leading "ip"), e.g.
+    * "addr add 10.1.1.1/24 dev sim0", to run on node n at time at.
+    */
+    void Add (Ptr<Node> n, Time at, std::string cmd);
+
+    void SetStackSize (uint32_t stackSize);
+
+    /**
+    * Write out the batch files and schedule one ip process per
+    * (node, time). Call once, after all commands have been added and
+    * after DceManagerHelper::Install.
+    */
+    ApplicationContainer Install (void);
+
+    uint32_t GetNCommands (void) const;
+    uint32_t GetNBatches (void) const;
+
+private:
+    struct Batch {
+        Ptr<Node> node;
+        Time at;
+        std::vector<std::string> cmds;
+    };
+    /* Keyed on (node id, start time) so batches come out ordered by node then time. */
+    typedef std::map<std::pair<uint32_t, int64_t>, Batch> BatchMap;
+
+    std::string WriteBatchFile (const Batch &batch) const;
+
+    BatchMap m_batches;
+    uint32_t m_nCommands;
+    uint32_t m_stackSize;
+};
+
+}
+
+#endif /* IP_BATCH_HELPER_H */
@@ -0,0 +1,141 @@
+#include "ipv4-prefix.h"
+
+#include "ns3/fatal-error.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+
+namespace ns3 {
+
+Ipv4Prefix::Ipv4Prefix ()
+    : network (0),
+      length (0)
+{
+}
+
+Ipv4Prefix::Ipv4Prefix (uint32_t network, uint8_t length)
+    : network (network),
+      length (length)
+{
+    if (length > 32) {
+        NS_FATAL_ERROR ("Invalid IPv4 prefix length " << (uint32_t)length);
+    }
+    this->network &= GetMask();
+}
+
+Ipv4Prefix
+Ipv4Prefix::FromString (std::string prefix)
+{
+    unsigned int a, b, c, d, len;
+    char tail;
+    if (sscanf(prefix.c_str(), "%u.%u.%u.%u/%u%c", &a, &b, &c, &d, &len, &tail) != 5
+        || a > 255 || b > 255 || c > 255 || d > 255 || len > 32) {
+        NS_FATAL_ERROR ("Invalid IPv4 prefix \"" << prefix << "\"");
+    }
+    return Ipv4Prefix ((a << 24) | (b << 16) | (c << 8) | d, len);
+}
+
+uint32_t
+Ipv4Prefix::GetMask (void) const
+{
+    return length == 0 ? 0 : 0xffffffffu << (32 - length);
+}
+
+uint32_t
+Ipv4Prefix::GetSize (void) const
+{
+    return length == 0 ? 0xffffffffu : 1u << (32 - length);
+}
+
+uint32_t
+Ipv4Prefix::GetHost (uint32_t n) const
+{
+    return network + n;
+}
+
+uint32_t
+Ipv4Prefix::GetBroadcast (void) const
+{
+    return network | ~GetMask();
+}
+
+bool
+Ipv4Prefix::Contains (uint32_t address) const
+{
+    return (address & GetMask()) == network;
+}
+
+bool
+Ipv4Prefix::Contains (const Ipv4Prefix &other) const
+{
+    return other.length >= length && Contains(other.network);
+}
+
+std::string
+Ipv4Prefix::ToString (void) const
+{
+    std::stringstream s;
+    s << Ipv4ToString(network) << "/" << (uint32_t)length;
+    return s.str();
+}
+
+std::string
+Ipv4Prefix::GetHostString (uint32_t n) const
+{
+    std::stringstream s;
+    s << Ipv4ToString(GetHost(n)) << "/" << (uint32_t)length;
+    return s.str();
+}
+
+std::string
+Ipv4ToString (uint32_t address)
+{
+    std::stringstream s;
+    s << (address >> 24) << "." << ((address >> 16) & 0xff) << "."
+      << ((address >> 8) & 0xff) << "." << (address & 0xff);
+    return s.str();
+}
+
+void
+SummariseBlocks (uint32_t base, uint8_t blockLength,
+                 uint32_t first, uint32_t count,
+                 std::vector<Ipv4Prefix> &out)
+{
+    uint32_t pos = first;
+    uint32_t end = first + count;
+
+    while (pos < end) {
+        /* Largest power of two block that is aligned at pos and still fits. */
+        uint32_t span = pos == 0 ? 0x80000000u : pos & (~pos + 1);
+        while (span > end - pos) {
+            span >>= 1;
+        }
+        uint8_t bits = 0;
+        while ((1u << bits) < span) {
+            bits++;
+        }
+        out.push_back(Ipv4Prefix (base + (pos << (32 - blockLength)), blockLength - bits));
+        pos += span;
+    }
+}
+
+void
+SummariseBlockSet (uint32_t base, uint8_t blockLength,
+                   std::vector<uint32_t> &indices,
+                   std::vector<Ipv4Prefix> &out)
+{
+    std::sort(indices.begin(), indices.end());
+
+    std::vector<uint32_t>::size_type i = 0;
+    while (i < indices.size()) {
+        std::vector<uint32_t>::size_type j = i + 1;
+        while (j < indices.size() && indices[j] <= indices[j - 1] + 1) {
+            j++;
+        }
+        SummariseBlocks(base, blockLength, indices[i], indices[j - 1] - indices[i] + 1, out);
+        i = j;
+    }
+}
+
+}
@@ -0,0 +1,60 @@
+#ifndef IPV4_PREFIX_H
+#define IPV4_PREFIX_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * An IPv4 network prefix in host byte order, e.g. 10.1.0.0/16, with the
+ * helpers the route and address code needs to print and aggregate them.
+ */
+struct Ipv4Prefix
+{
+    Ipv4Prefix ();
+    Ipv4Prefix (uint32_t network, uint8_t length);
+
+    /* Parse "a.b.c.d/len"; aborts on malformed input. */
+    static Ipv4Prefix FromString (std::string prefix);
+
+    uint32_t GetMask (void) const;
+    uint32_t GetSize (void) const;
+    /* Address of the n-th host, e.g. GetHost(1) for the first usable one. */
+    uint32_t GetHost (uint32_t n) const;
+    uint32_t GetBroadcast (void) const;
+    bool Contains (uint32_t address) const;
+    bool Contains (const Ipv4Prefix &other) const;
+
+    /* "a.b.c.d/len" */
+    std::string ToString (void) const;
+    /* The n-th host with this prefix's length, as used by "addr add". */
+    std::string GetHostString (uint32_t n) const;
+
+    uint32_t network;
+    uint8_t length;
+};
+
+std::string Ipv4ToString (uint32_t address);
+
+/**
+ * Append to out the smallest set of aligned prefixes that exactly covers
+ * blocks [first, first + count) of a pool of equal sized subnets starting
+ * at base, each blockLength bits long (e.g. /24 segments).
+ */
+void SummariseBlocks (uint32_t base, uint8_t blockLength,
+                      uint32_t first, uint32_t count,
+                      std::vector<Ipv4Prefix> &out);
+
+/**
+ * As SummariseBlocks, for an arbitrary set of block indices. indices is
+ * sorted in place; contiguous runs are merged before being summarised.
+ */
+void SummariseBlockSet (uint32_t base, uint8_t blockLength,
+                        std::vector<uint32_t> &indices,
+                        std::vector<Ipv4Prefix> &out);
+
+}
+
+#endif /* IPV4_PREFIX_H */
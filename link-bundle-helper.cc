@@ -0,0 +1,213 @@
+#include "link-bundle-helper.h"
+
+#include "ns3/pointer.h"
+#include "ns3/double.h"
+#include "ns3/enum.h"
+#include "ns3/log.h"
+#include "ns3/fatal-error.h"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+NS_LOG_COMPONENT_DEFINE ("LinkBundleHelper");
+
+namespace ns3 {
+
+LinkBundleHelper::LinkBundleHelper ()
+{
+}
+
+void
+LinkBundleHelper::AddProfile (const PathProfile &profile)
+{
+    if (!m_paths.empty()) {
+        NS_FATAL_ERROR ("LinkBundleHelper: add the profiles before Install");
+    }
+
+    Profile p;
+    p.profile = profile;
+    p.helper.SetDeviceAttribute("DataRate", DataRateValue (profile.rate));
+    p.helper.SetChannelAttribute("Delay", TimeValue (profile.delay));
+
+    /* Set as an attribute of the helper, so every device of the profile gets the same model */
+    if (profile.loss > 0) {
+        p.lossStream = CreateObject<UniformRandomVariable> ();
+        p.lossModel = CreateObject<RateErrorModel> ();
+        p.lossModel->SetAttribute("RanVar", PointerValue (p.lossStream));
+        p.lossModel->SetAttribute("ErrorUnit", EnumValue (RateErrorModel::ERROR_UNIT_PACKET));
+        p.lossModel->SetAttribute("ErrorRate", DoubleValue (profile.loss));
+        p.helper.SetDeviceAttribute("ReceiveErrorModel", PointerValue (p.lossModel));
+    }
+    m_profiles.push_back(p);
+}
+
+uint32_t
+LinkBundleHelper::GetNProfiles (void) const
+{
+    return m_profiles.size();
+}
+
+NetDeviceContainer
+LinkBundleHelper::Install (Ptr<Node> a, Ptr<Node> b, uint32_t nPaths,
+                           AddressPlan &plan, AddressPlan::Tier tier)
+{
+    if (m_profiles.empty()) {
+        NS_FATAL_ERROR ("LinkBundleHelper: no path profiles");
+    }
+    if (!m_paths.empty()) {
+        NS_FATAL_ERROR ("LinkBundleHelper: Install called twice");
+    }
+    m_a = a;
+    m_b = b;
+
+    NetDeviceContainer devices;
+    for (uint32_t i = 0; i < nPaths; i++) {
+        Path path;
+        path.profile = i % m_profiles.size();
+        path.link = plan.Allocate(tier, 30);
+
+        Profile &profile = m_profiles[path.profile];
+        NetDeviceContainer pair = profile.helper.Install(a, b);
+        path.devA = pair.Get(0);
+        path.devB = pair.Get(1);
+
+        if (profile.profile.jitter) {
+            for (uint32_t d = 0; d < pair.GetN(); d++) {
+                Ptr<DelayLine> line = CreateObject<DelayLine> ();
+                line->SetDelay(profile.profile.jitter);
+                line->Install(pair.Get(d));
+                m_delayLines.push_back(line);
+            }
+        }
+
+        m_paths.push_back(path);
+        devices.Add(path.devA);
+    }
+
+    NS_LOG_DEBUG (nPaths << " paths between nodes " << a->GetId() << " and " << b->GetId()
+                  << " over " << m_profiles.size() << " profiles");
+    return devices;
+}
+
+uint32_t
+LinkBundleHelper::GetN (void) const
+{
+    return m_paths.size();
+}
+
+Ipv4Prefix
+LinkBundleHelper::GetLink (uint32_t path) const
+{
+    return m_paths[path].link;
+}
+
+const LinkBundleHelper::PathProfile &
+LinkBundleHelper::GetProfile (uint32_t path) const
+{
+    return m_profiles[m_paths[path].profile].profile;
+}
+
+std::string
+LinkBundleHelper::GetDeviceName (uint32_t path, bool atA) const
+{
+    /* DCE names a node's devices sim<index> */
+    std::ostringstream name;
+    name << "sim" << (atA ? m_paths[path].devA : m_paths[path].devB)->GetIfIndex();
+    return name.str();
+}
+
+NetDeviceContainer
+LinkBundleHelper::GetDevices (void) const
+{
+    NetDeviceContainer devices;
+    for (std::vector<Path>::const_iterator it = m_paths.begin(); it != m_paths.end(); ++it) {
+        devices.Add(it->devA);
+    }
+    return devices;
+}
+
+void
+LinkBundleHelper::Configure (ConfigAgent &agent, Time at, uint32_t firstTable)
+{
+    for (uint32_t i = 0; i < m_paths.size(); i++) {
+        Ipv4Prefix link = m_paths[i].link;
+        std::string devA = GetDeviceName(i, true);
+        std::string devB = GetDeviceName(i, false);
+
+        agent.SetLink (m_a, at, devA, true);
+        agent.AddAddress (m_a, at, devA, link, 2);
+        agent.AddRule (m_a, at, link, "", firstTable + i);
+        agent.AddRoute (m_a, at, Ipv4Prefix (), link.GetHost(1), devA, firstTable + i);
+        agent.AddRoute (m_a, at, link, 0, devA, firstTable + i);
+
+        agent.SetLink (m_b, at, devB, true);
+        agent.AddAddress (m_b, at, devB, link, 1);
+    }
+}
+
+void
+LinkBundleHelper::AddDefaultRoutes (ConfigAgent &agent, Time at)
+{
+    for (uint32_t i = 0; i < m_paths.size(); i++) {
+        agent.AddRoute (m_a, at, Ipv4Prefix (), m_paths[i].link.GetHost(1), GetDeviceName(i, true),
+                        ConfigAgent::MAIN_TABLE, i + 1);
+    }
+}
+
+void
+LinkBundleHelper::AddMultipathRoute (ConfigAgent &agent, Time at)
+{
+    std::vector<ConfigAgent::Nexthop> nexthops;
+    for (uint32_t i = 0; i < m_paths.size(); i++) {
+        ConfigAgent::Nexthop hop;
+        hop.via = m_paths[i].link.GetHost(1);
+        hop.dev = GetDeviceName(i, true);
+        hop.weight = 1;
+        nexthops.push_back(hop);
+    }
+    agent.AddMultipathRoute (m_a, at, Ipv4Prefix (), nexthops);
+}
+
+void
+LinkBundleHelper::EnablePcap (std::string prefix)
+{
+    /* Any point-to-point helper writes pcaps for any point-to-point device */
+    m_profiles[0].helper.EnablePcap(prefix, GetDevices(), false);
+}
+
+std::vector<Ptr<RandomVariableStream> >
+LinkBundleHelper::GetStreams (void) const
+{
+    std::vector<Ptr<RandomVariableStream> > streams;
+    for (std::vector<Profile>::const_iterator it = m_profiles.begin(); it != m_profiles.end(); ++it) {
+        if (it->profile.jitter && std::find(streams.begin(), streams.end(), it->profile.jitter) == streams.end()) {
+            streams.push_back(it->profile.jitter);
+        }
+        if (it->lossStream) {
+            streams.push_back(it->lossStream);
+        }
+    }
+    return streams;
+}
+
+void
+LinkBundleHelper::Report (void) const
+{
+    if (m_delayLines.empty()) {
+        return;
+    }
+
+    uint64_t received = 0, held = 0, events = 0;
+    uint32_t maxQueued = 0;
+    for (std::vector<Ptr<DelayLine> >::const_iterator it = m_delayLines.begin(); it != m_delayLines.end(); ++it) {
+        received += (*it)->GetNReceived();
+        held += (*it)->GetNHeld();
+        events += (*it)->GetNEvents();
+        maxQueued = std::max(maxQueued, (*it)->GetMaxQueued());
+    }
+    std::cout << "Delay lines: " << received << " packets, " << events << " events, "
+              << held << " held to keep order, max queue " << maxQueued << "\n";
+}
+
+}
@@ -0,0 +1,112 @@
+#ifndef LINK_BUNDLE_HELPER_H
+#define LINK_BUNDLE_HELPER_H
+
+#include "address-plan.h"
+#include "config-agent.h"
+#include "delay-line.h"
+#include "ipv4-prefix.h"
+
+#include "ns3/node.h"
+#include "ns3/nstime.h"
+#include "ns3/data-rate.h"
+#include "ns3/net-device-container.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/point-to-point-helper.h"
+#include "ns3/error-model.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * N parallel point-to-point paths between two nodes, as used for MPTCP
+ * subflows, built from a short table of path profiles instead of one
+ * set of helpers and attributes per path.
+ *
+ * Paths take the profiles in turn, path i profile i % GetNProfiles().
+ * Everything a profile needs is built once and shared by its paths: the
+ * configured PointToPointHelper, the loss model every device of the
+ * profile receives through, and the delay stream of its DelayLines.
+ *
+ * Each path gets a /30 from the address plan, host 1 at b and host 2 at
+ * a. Configure adds the configuration of every path to a ConfigAgent,
+ * so it is applied by one agent per node in one batch.
+ */
+class LinkBundleHelper
+{
+public:
+    struct PathProfile {
+        std::string name;
+        DataRate rate;
+        Time delay;
+        /* Extra delay per packet at each end, in ms (DelayLine); 0 for none */
+        Ptr<RandomVariableStream> jitter;
+        /* Fraction of packets lost at each end */
+        double loss;
+    };
+
+    LinkBundleHelper ();
+
+    void AddProfile (const PathProfile &profile);
+    uint32_t GetNProfiles (void) const;
+
+    /**
+    * Build nPaths paths between a and b, allocating their links from
+    * tier of plan. Returns the devices at a, in path order.
+    */
+    NetDeviceContainer Install (Ptr<Node> a, Ptr<Node> b, uint32_t nPaths,
+                                AddressPlan &plan, AddressPlan::Tier tier);
+
+    uint32_t GetN (void) const;
+    Ipv4Prefix GetLink (uint32_t path) const;
+    const PathProfile &GetProfile (uint32_t path) const;
+    /* Kernel device names of the path at a and at b, e.g. "sim3" */
+    std::string GetDeviceName (uint32_t path, bool atA) const;
+    NetDeviceContainer GetDevices (void) const;
+
+    /**
+    * Links up and addresses at both ends, and on a, for every path, a
+    * rule sending traffic from the path's address to table firstTable +
+    * path, which holds the link and a default route via b.
+    */
+    void Configure (ConfigAgent &agent, Time at, uint32_t firstTable);
+    /* A default route per path in a's main table, path i with metric i + 1 */
+    void AddDefaultRoutes (ConfigAgent &agent, Time at);
+    /* One default route in a's main table over all paths, equally weighted */
+    void AddMultipathRoute (ConfigAgent &agent, Time at);
+
+    /* Pcaps of the devices at a */
+    void EnablePcap (std::string prefix);
+
+    /* Delay and loss streams, to re-seed per replication */
+    std::vector<Ptr<RandomVariableStream> > GetStreams (void) const;
+    /* Totals over every path's delay lines, if there are any */
+    void Report (void) const;
+
+private:
+    struct Profile {
+        PathProfile profile;
+        PointToPointHelper helper;
+        Ptr<RateErrorModel> lossModel;
+        Ptr<UniformRandomVariable> lossStream;
+    };
+
+    struct Path {
+        uint32_t profile;
+        Ipv4Prefix link;
+        Ptr<NetDevice> devA;
+        Ptr<NetDevice> devB;
+    };
+
+    Ptr<Node> m_a;
+    Ptr<Node> m_b;
+    std::vector<Profile> m_profiles;
+    std::vector<Path> m_paths;
+    std::vector<Ptr<DelayLine> > m_delayLines;
+};
+
+}
+
+#endif /* LINK_BUNDLE_HELPER_H */
@@ -0,0 +1,683 @@
+/*
+ * Throughput, RTT and reordering of MPTCP subflows from the pcap and
+ * pcapng files the scenarios write, so runs can be analysed where they
+ * ran instead of shipping the captures.
+ *
+ * usage: mptcp-analyzer [-j JOBS] [-b BIN] [-o PREFIX] FILE...
+ *   -j JOBS    files analysed in parallel (default: number of cores)
+ *   -b BIN     bin width in seconds (default: 1)
+ *   -o PREFIX  output files PREFIX-*.csv (default: mptcp-analysis)
+ *
+ * Files are memory mapped and handed to JOBS threads, one file at a time.
+ * A subflow is one TCP 4-tuple carrying data on one interface; every bin
+ * it saw frames in gives a line of PREFIX-subflows.csv with its packets,
+ * payload bytes, retransmissions (data seen before, or already ACKed),
+ * reordered segments (data below the highest sequence that was not seen
+ * before) and RTT (data to the ACK covering it, seen at the same
+ * interface; retransmitted data excluded).
+ *
+ * PREFIX-aggregate.csv sums the subflows per bin over all files, each
+ * 4-tuple counted once, at the first interface of the first file seen on.
+ *
+ * PREFIX-connections.csv is the data level view, per file and per
+ * receiving endpoint: bytes the highest MPTCP data sequence number
+ * advanced by, and bytes of mapped data arriving below it (reordering
+ * between subflows, and reinjections). Only subflows in the same file
+ * are combined, so capture with --pcapMerge=node or all for it to cover
+ * every subflow of a connection.
+ */
+
+#include "frame-headers.h"
+#include "ipv4-prefix.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+
+static const uint8_t TCPOPT_MPTCP = 30;
+static const uint8_t MPTCP_DSS = 2;
+
+struct Bin
+{
+    uint32_t packets;
+    uint64_t bytes;
+    uint32_t retrans;
+    uint32_t reordered;
+    uint32_t rttSamples;
+    double rttSum;
+};
+
+struct Key
+{
+    uint32_t src;
+    uint32_t dst;
+    uint16_t sport;
+    uint16_t dport;
+
+    bool operator< (const Key &o) const
+    {
+        if (src != o.src) return src < o.src;
+        if (dst != o.dst) return dst < o.dst;
+        if (sport != o.sport) return sport < o.sport;
+        return dport < o.dport;
+    }
+    Key Reverse (void) const
+    {
+        Key r = { dst, src, dport, sport };
+        return r;
+    }
+};
+
+struct Subflow
+{
+    Key key;
+    uint32_t interface;
+    /* First interface of the file this 4-tuple was seen on */
+    bool owner;
+    bool mptcp;
+    uint64_t bytes;
+    std::map<uint64_t, Bin> bins;
+
+    bool synSeen;
+    SegmentTracker segments;
+
+    /* Last DSS mapping: data sequence number of relative subflow sequence ssn */
+    bool mapped;
+    uint64_t dsn;
+    uint32_t ssn;
+    uint32_t mapLength;
+};
+
+struct Connection
+{
+    uint32_t subflows;
+    bool dsnBase;
+    uint64_t highest;
+    std::map<uint64_t, std::pair<uint64_t, uint64_t> > bins;
+};
+
+struct Interface
+{
+    std::string name;
+    bool supported;
+    bool ppp;
+    /* Seconds per timestamp unit */
+    double resolution;
+};
+
+struct FileResult
+{
+    std::string file;
+    std::string error;
+    uint64_t frames;
+    std::vector<Interface> interfaces;
+    std::vector<Subflow> subflows;
+    std::map<std::pair<uint32_t, Key>, uint32_t> index;
+    std::map<Key, uint32_t> owners;
+    /* Receiving endpoint (address << 16 | port) to its data level view */
+    std::map<uint64_t, Connection> connections;
+};
+
+class Analyzer
+{
+public:
+    Analyzer (double binWidth);
+
+    void Analyze (FileResult &result);
+
+private:
+    void ReadPcap (FileResult &r, const uint8_t *p, size_t size);
+    void ReadPcapng (FileResult &r, const uint8_t *p, size_t size);
+    void Frame (FileResult &r, uint32_t interface, double t, const uint8_t *buf, uint32_t len);
+    Subflow &GetSubflow (FileResult &r, uint32_t interface, const Key &key);
+    Bin &GetBin (Subflow &s, double t);
+    void Dss (FileResult &r, Subflow &s, const FrameHeaders &h, const uint8_t *opt, uint32_t len, double t);
+
+    double m_binWidth;
+};
+
+static uint16_t
+get16 (const uint8_t *p, bool swap)
+{
+    uint16_t v;
+    memcpy(&v, p, sizeof(v));
+    return swap ? (v >> 8) | (v << 8) : v;
+}
+
+static uint32_t
+get32 (const uint8_t *p, bool swap)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return swap ? __builtin_bswap32(v) : v;
+}
+
+static uint32_t
+read32 (const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static uint64_t
+read64 (const uint8_t *p)
+{
+    return ((uint64_t)read32(p) << 32) | read32(p + 4);
+}
+
+static Interface
+makeInterface (std::string name, uint32_t linkType, double resolution)
+{
+    Interface i;
+    i.name = name;
+    /* Ethernet, PPP and raw IPv4; FrameHeaders takes what is neither as bare IP. */
+    i.supported = linkType == 1 || linkType == 9 || linkType == 101 || linkType == 228;
+    i.ppp = linkType == 9;
+    i.resolution = resolution;
+    return i;
+}
+
+Analyzer::Analyzer (double binWidth)
+    : m_binWidth (binWidth)
+{
+}
+
+void
+Analyzer::Analyze (FileResult &r)
+{
+    r.frames = 0;
+
+    int fd = open(r.file.c_str(), O_RDONLY);
+    if (fd < 0) {
+        r.error = strerror(errno);
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < 4) {
+        r.error = "empty or unreadable";
+        close(fd);
+        return;
+    }
+    void *map = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        r.error = strerror(errno);
+        return;
+    }
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+    const uint8_t *p = (const uint8_t *)map;
+    if (get32(p, false) == 0x0a0d0d0a) {
+        ReadPcapng(r, p, st.st_size);
+    } else {
+        ReadPcap(r, p, st.st_size);
+    }
+    munmap(map, st.st_size);
+}
+
+void
+Analyzer::ReadPcap (FileResult &r, const uint8_t *p, size_t size)
+{
+    if (size < 24) {
+        r.error = "truncated pcap header";
+        return;
+    }
+
+    uint32_t magic = get32(p, false);
+    bool swap;
+    double resolution;
+    switch (magic) {
+    case 0xa1b2c3d4: swap = false; resolution = 1e-6; break;
+    case 0xd4c3b2a1: swap = true; resolution = 1e-6; break;
+    case 0xa1b23c4d: swap = false; resolution = 1e-9; break;
+    case 0x4d3cb2a1: swap = true; resolution = 1e-9; break;
+    default:
+        r.error = "not a pcap or pcapng file";
+        return;
+    }
+
+    std::string name = r.file.substr(r.file.rfind('/') + 1);
+    if (name.size() > 5 && name.compare(name.size() - 5, 5, ".pcap") == 0) {
+        name.erase(name.size() - 5);
+    }
+    r.interfaces.push_back(makeInterface(name, get32(p + 20, swap), resolution));
+    if (!r.interfaces[0].supported) {
+        r.error = "unsupported link type";
+        return;
+    }
+
+    size_t at = 24;
+    while (at + 16 <= size) {
+        uint32_t sec = get32(p + at, swap);
+        uint32_t frac = get32(p + at + 4, swap);
+        uint32_t caplen = get32(p + at + 8, swap);
+        at += 16;
+        if (caplen > size - at) {
+            r.error = "truncated frame";
+            break;
+        }
+        Frame(r, 0, sec + frac * resolution, p + at, caplen);
+        at += caplen;
+    }
+}
+
+void
+Analyzer::ReadPcapng (FileResult &r, const uint8_t *p, size_t size)
+{
+    bool swap = false;
+    /* Interfaces are numbered per section */
+    uint32_t first = 0;
+
+    size_t at = 0;
+    while (at + 12 <= size) {
+        uint32_t type = get32(p + at, swap);
+        if (type == 0x0a0d0d0a) {
+            swap = get32(p + at + 8, false) != 0x1a2b3c4d;
+            first = r.interfaces.size();
+        }
+        uint32_t length = get32(p + at + 4, swap);
+        if (length < 12 || length % 4 != 0 || length > size - at) {
+            r.error = "truncated block";
+            break;
+        }
+        const uint8_t *body = p + at + 8;
+        uint32_t bodyLength = length - 12;
+
+        if (type == 1 && bodyLength >= 8) {
+            std::ostringstream name;
+            name << r.file << "#" << r.interfaces.size() - first;
+            double resolution = 1e-6;
+
+            /* Options: if_name (2) and if_tsresol (9) */
+            uint32_t o = 8;
+            while (o + 4 <= bodyLength) {
+                uint16_t code = get16(body + o, swap);
+                uint16_t len = get16(body + o + 2, swap);
+                if (code == 0 || o + 4 + len > bodyLength) {
+                    break;
+                }
+                if (code == 2) {
+                    name.str(std::string((const char *)body + o + 4, len));
+                } else if (code == 9 && len >= 1) {
+                    uint8_t v = body[o + 4];
+                    resolution = v & 0x80 ? std::pow(2.0, -(double)(v & 0x7f)) : std::pow(10.0, -(double)v);
+                }
+                o += 4 + ((len + 3) & ~3);
+            }
+            r.interfaces.push_back(makeInterface(name.str(), get16(body, swap), resolution));
+        } else if (type == 6 && bodyLength >= 20) {
+            uint32_t interface = first + get32(body, swap);
+            uint64_t ts = ((uint64_t)get32(body + 4, swap) << 32) | get32(body + 8, swap);
+            uint32_t caplen = get32(body + 12, swap);
+            if (interface < r.interfaces.size() && r.interfaces[interface].supported
+                && caplen <= bodyLength - 20) {
+                Frame(r, interface, ts * r.interfaces[interface].resolution, body + 20, caplen);
+            }
+        }
+        at += length;
+    }
+}
+
+void
+Analyzer::Frame (FileResult &r, uint32_t interface, double t, const uint8_t *buf, uint32_t len)
+{
+    r.frames++;
+
+    FrameHeaders h;
+    if (!h.Parse(buf, len, r.interfaces[interface].ppp) || !h.tcp) {
+        return;
+    }
+
+    Key key = { h.src, h.dst, h.sport, h.dport };
+    Subflow &s = GetSubflow(r, interface, key);
+
+    if (h.flags & FrameHeaders::TCP_SYN) {
+        s.synSeen = true;
+        s.segments.Syn(h.seq);
+    }
+
+    const uint8_t *opt = buf + h.options;
+    const uint8_t *dss = 0;
+    uint32_t dssLength = 0;
+    for (uint32_t o = 0; o < h.optionsLength;) {
+        uint8_t kind = opt[o];
+        if (kind == 0) {
+            break;
+        }
+        if (kind == 1) {
+            o++;
+            continue;
+        }
+        if (o + 2 > h.optionsLength || opt[o + 1] < 2 || o + opt[o + 1] > h.optionsLength) {
+            break;
+        }
+        if (kind == TCPOPT_MPTCP && opt[o + 1] >= 3) {
+            s.mptcp = true;
+            if ((opt[o + 2] >> 4) == MPTCP_DSS) {
+                dss = opt + o;
+                dssLength = opt[o + 1];
+            }
+        }
+        o += opt[o + 1];
+    }
+
+    if (h.payload > 0) {
+        Bin &bin = GetBin(s, t);
+        bin.packets++;
+        bin.bytes += h.payload;
+        s.bytes += h.payload;
+
+        SegmentTracker::Kind kind = s.segments.Data(h.seq, h.payload, t);
+        if (kind == SegmentTracker::RETRANSMITTED) {
+            bin.retrans++;
+        } else if (kind == SegmentTracker::REORDERED) {
+            bin.reordered++;
+        }
+
+        if (dss || s.mapped) {
+            Dss(r, s, h, dss, dssLength, t);
+        }
+    } else {
+        GetBin(s, t).packets++;
+    }
+
+    if (h.flags & FrameHeaders::TCP_ACK) {
+        std::map<std::pair<uint32_t, Key>, uint32_t>::iterator it =
+            r.index.find(std::make_pair(interface, key.Reverse()));
+        if (it == r.index.end()) {
+            return;
+        }
+        Subflow &data = r.subflows[it->second];
+        double rtt;
+        if (data.segments.Ack(h.ack, t, rtt)) {
+            Bin &bin = GetBin(data, t);
+            bin.rttSamples++;
+            bin.rttSum += rtt;
+        }
+    }
+}
+
+void
+Analyzer::Dss (FileResult &r, Subflow &s, const FrameHeaders &h, const uint8_t *opt, uint32_t len, double t)
+{
+    if (!s.owner) {
+        return;
+    }
+    uint64_t endpoint = ((uint64_t)h.dst << 16) | h.dport;
+    Connection &c = r.connections[endpoint];
+    uint32_t seq = h.seq - s.segments.isn;
+
+    if (opt) {
+        /* Flags: A data ACK, a 8 byte data ACK, M mapping, m 8 byte DSN */
+        uint8_t flags = opt[3];
+        uint32_t o = 4;
+        if (flags & 0x01) {
+            o += flags & 0x02 ? 8 : 4;
+        }
+        uint32_t dsnSize = flags & 0x08 ? 8 : 4;
+        if ((flags & 0x04) && o + dsnSize + 6 <= len) {
+            uint64_t dsn;
+            if (dsnSize == 8) {
+                dsn = read64(opt + o);
+            } else {
+                /* Closest to the highest sequence number seen, for wraps */
+                dsn = (c.highest & ~(uint64_t)0xffffffff) | read32(opt + o);
+                if (c.dsnBase && dsn + 0x80000000ULL < c.highest) {
+                    dsn += 0x100000000ULL;
+                }
+            }
+            if (!s.mapped) {
+                c.subflows++;
+            }
+            s.mapped = true;
+            s.dsn = dsn;
+            /* Without the SYN sequence numbers are relative to this segment's. */
+            s.ssn = s.synSeen ? read32(opt + o + dsnSize) : seq;
+            s.mapLength = (opt[o + dsnSize + 4] << 8) | opt[o + dsnSize + 5];
+        }
+    }
+
+    if (!s.mapped || seq - s.ssn >= s.mapLength) {
+        return;
+    }
+    uint64_t start = s.dsn + (seq - s.ssn);
+    uint64_t end = start + h.payload;
+
+    std::pair<uint64_t, uint64_t> &bin = c.bins[(uint64_t)(t / m_binWidth)];
+    if (!c.dsnBase) {
+        c.dsnBase = true;
+        c.highest = start;
+    }
+    if (end > c.highest) {
+        bin.first += end - std::max(start, c.highest);
+        c.highest = end;
+    } else {
+        bin.second += h.payload;
+    }
+}
+
+Subflow &
+Analyzer::GetSubflow (FileResult &r, uint32_t interface, const Key &key)
+{
+    std::pair<uint32_t, Key> id (interface, key);
+    std::map<std::pair<uint32_t, Key>, uint32_t>::iterator it = r.index.find(id);
+    if (it != r.index.end()) {
+        return r.subflows[it->second];
+    }
+
+    Subflow s;
+    s.key = key;
+    s.interface = interface;
+    s.owner = r.owners.insert(std::make_pair(key, interface)).first->second == interface;
+    s.mptcp = false;
+    s.bytes = 0;
+    s.synSeen = false;
+    s.mapped = false;
+    s.dsn = 0;
+    s.ssn = 0;
+    s.mapLength = 0;
+    r.subflows.push_back(s);
+    r.index[id] = r.subflows.size() - 1;
+    return r.subflows.back();
+}
+
+Bin &
+Analyzer::GetBin (Subflow &s, double t)
+{
+    uint64_t index = (uint64_t)(t / m_binWidth);
+    std::map<uint64_t, Bin>::iterator it = s.bins.find(index);
+    if (it == s.bins.end()) {
+        Bin empty = { 0, 0, 0, 0, 0, 0 };
+        it = s.bins.insert(std::make_pair(index, empty)).first;
+    }
+    return it->second;
+}
+
+/* Work shared by the threads: the next file to take, under mutex. */
+struct Work
+{
+    Analyzer *analyzer;
+    std::vector<FileResult> *results;
+    uint32_t next;
+    pthread_mutex_t mutex;
+};
+
+static void *
+worker (void *arg)
+{
+    Work *work = (Work *)arg;
+    for (;;) {
+        pthread_mutex_lock(&work->mutex);
+        uint32_t i = work->next++;
+        pthread_mutex_unlock(&work->mutex);
+        if (i >= work->results->size()) {
+            return 0;
+        }
+        work->analyzer->Analyze((*work->results)[i]);
+    }
+}
+
+static void
+usage (void)
+{
+    std::cerr << "usage: mptcp-analyzer [-j JOBS] [-b BIN] [-o PREFIX] FILE...\n";
+    exit(1);
+}
+
+static std::string
+endpointToString (uint64_t endpoint)
+{
+    std::ostringstream s;
+    s << Ipv4ToString(endpoint >> 16) << ":" << (endpoint & 0xffff);
+    return s.str();
+}
+
+int
+main (int argc, char *argv[])
+{
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    double binWidth = 1;
+    std::string prefix = "mptcp-analysis";
+
+    int opt;
+    while ((opt = getopt(argc, argv, "j:b:o:")) != -1) {
+        switch (opt) {
+        case 'j': jobs = atol(optarg); break;
+        case 'b': binWidth = atof(optarg); break;
+        case 'o': prefix = optarg; break;
+        default: usage();
+        }
+    }
+    if (optind >= argc || jobs < 1 || binWidth <= 0) {
+        usage();
+    }
+
+    struct timeval start, end;
+    gettimeofday(&start, 0);
+
+    std::vector<FileResult> results (argc - optind);
+    for (uint32_t i = 0; i < results.size(); i++) {
+        results[i].file = argv[optind + i];
+    }
+
+    Analyzer analyzer (binWidth);
+    Work work;
+    work.analyzer = &analyzer;
+    work.results = &results;
+    work.next = 0;
+    pthread_mutex_init(&work.mutex, 0);
+
+    std::vector<pthread_t> threads (std::min((size_t)jobs, results.size()));
+    for (uint32_t i = 0; i < threads.size(); i++) {
+        if (pthread_create(&threads[i], 0, &worker, &work) != 0) {
+            std::cerr << "Could not start analysis thread " << i << "\n";
+            return 1;
+        }
+    }
+    for (uint32_t i = 0; i < threads.size(); i++) {
+        pthread_join(threads[i], 0);
+    }
+    pthread_mutex_destroy(&work.mutex);
+
+    std::string subflowsFile = prefix + "-subflows.csv";
+    std::string aggregateFile = prefix + "-aggregate.csv";
+    std::string connectionsFile = prefix + "-connections.csv";
+    std::ofstream subflows (subflowsFile.c_str());
+    std::ofstream aggregate (aggregateFile.c_str());
+    std::ofstream connections (connectionsFile.c_str());
+    if (!subflows.is_open() || !aggregate.is_open() || !connections.is_open()) {
+        std::cerr << "Could not open " << prefix << "-*.csv\n";
+        return 1;
+    }
+
+    subflows << "file,interface,src,sport,dst,dport,mptcp,time,packets,bytes,mbps,retrans,reordered,rtt_samples,rtt_ms\n";
+    connections << "file,endpoint,subflows,time,data_bytes,data_mbps,below_bytes\n";
+
+    /* Aggregate bins, and the subflows active in each */
+    std::map<uint64_t, std::pair<Bin, uint32_t> > total;
+    std::map<Key, bool> counted;
+    uint64_t frames = 0, nSubflows = 0;
+    int failed = 0;
+
+    for (uint32_t i = 0; i < results.size(); i++) {
+        const FileResult &r = results[i];
+        frames += r.frames;
+        if (!r.error.empty()) {
+            std::cerr << r.file << ": " << r.error << "\n";
+            failed++;
+        }
+
+        for (std::vector<Subflow>::const_iterator s = r.subflows.begin(); s != r.subflows.end(); ++s) {
+            if (s->bytes == 0) {
+                continue;
+            }
+            nSubflows++;
+            bool count = s->owner && counted.insert(std::make_pair(s->key, true)).second;
+
+            for (std::map<uint64_t, Bin>::const_iterator b = s->bins.begin(); b != s->bins.end(); ++b) {
+                const Bin &bin = b->second;
+                subflows << r.file << "," << r.interfaces[s->interface].name
+                         << "," << Ipv4ToString(s->key.src) << "," << s->key.sport
+                         << "," << Ipv4ToString(s->key.dst) << "," << s->key.dport
+                         << "," << s->mptcp << "," << b->first * binWidth
+                         << "," << bin.packets << "," << bin.bytes
+                         << "," << bin.bytes * 8 / binWidth / 1e6
+                         << "," << bin.retrans << "," << bin.reordered << "," << bin.rttSamples
+                         << "," << (bin.rttSamples > 0 ? bin.rttSum / bin.rttSamples : 0) << "\n";
+
+                if (count) {
+                    std::pair<Bin, uint32_t> &t = total[b->first];
+                    t.first.packets += bin.packets;
+                    t.first.bytes += bin.bytes;
+                    t.first.retrans += bin.retrans;
+                    t.first.reordered += bin.reordered;
+                    t.first.rttSamples += bin.rttSamples;
+                    t.first.rttSum += bin.rttSum;
+                    t.second += bin.bytes > 0;
+                }
+            }
+        }
+
+        for (std::map<uint64_t, Connection>::const_iterator c = r.connections.begin(); c != r.connections.end(); ++c) {
+            for (std::map<uint64_t, std::pair<uint64_t, uint64_t> >::const_iterator b = c->second.bins.begin();
+                 b != c->second.bins.end(); ++b) {
+                connections << r.file << "," << endpointToString(c->first) << "," << c->second.subflows
+                            << "," << b->first * binWidth << "," << b->second.first
+                            << "," << b->second.first * 8 / binWidth / 1e6 << "," << b->second.second << "\n";
+            }
+        }
+    }
+
+    aggregate << "time,subflows,packets,bytes,mbps,retrans,reordered,rtt_samples,rtt_ms\n";
+    for (std::map<uint64_t, std::pair<Bin, uint32_t> >::const_iterator t = total.begin(); t != total.end(); ++t) {
+        const Bin &bin = t->second.first;
+        aggregate << t->first * binWidth << "," << t->second.second << "," << bin.packets
+                  << "," << bin.bytes << "," << bin.bytes * 8 / binWidth / 1e6
+                  << "," << bin.retrans << "," << bin.reordered << "," << bin.rttSamples
+                  << "," << (bin.rttSamples > 0 ? bin.rttSum / bin.rttSamples : 0) << "\n";
+    }
+
+    gettimeofday(&end, 0);
+    std::cout << results.size() << " files, " << frames << " frames, " << nSubflows << " subflows in "
+              << (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6 << "s, "
+              << threads.size() << " threads\n";
+
+    return failed > 0 ? 1 : 0;
+}
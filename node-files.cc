@@ -0,0 +1,31 @@
+#include "node-files.h"
+
+#include "ns3/fatal-error.h"
+
+#include <errno.h>
+#include <sstream>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+namespace ns3 {
+
+std::string
+MakeNodeDirectory (uint32_t node, std::string dir)
+{
+    /* DCE maps a node's "/" onto files-<node id> in the working directory. */
+    std::stringstream root;
+    root << "files-" << node;
+    std::string path = root.str() + dir;
+
+    for (std::string::size_type i = 1; i <= path.size(); i++) {
+        if (i == path.size() || path[i] == '/') {
+            std::string sub = path.substr(0, i);
+            if (mkdir(sub.c_str(), 0755) != 0 && errno != EEXIST) {
+                NS_FATAL_ERROR ("Could not create directory " << sub);
+            }
+        }
+    }
+    return path;
+}
+
+}
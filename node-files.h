@@ -0,0 +1,18 @@
+#ifndef NODE_FILES_H
+#define NODE_FILES_H
+
+#include <stdint.h>
+#include <string>
+
+namespace ns3 {
+
+/**
+ * Create directory dir, e.g. "/etc/ip-batch", with any missing parents in
+ * node's DCE file tree, and return its path from the working directory.
+ * Aborts if a directory can not be created.
+ */
+std::string MakeNodeDirectory (uint32_t node, std::string dir);
+
+}
+
+#endif /* NODE_FILES_H */
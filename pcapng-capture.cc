@@ -0,0 +1,210 @@
+#include "pcapng-capture.h"
+
+#include "ns3/node.h"
+#include "ns3/simulator.h"
+#include "ns3/log.h"
+#include "ns3/fatal-error.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+
+#include <unistd.h>
+
+NS_LOG_COMPONENT_DEFINE ("PcapngCapture");
+
+namespace ns3 {
+
+/* Block types and options, in host byte order (the section header says which) */
+static const uint32_t BLOCK_SECTION_HEADER = 0x0a0d0d0a;
+static const uint32_t BLOCK_INTERFACE = 0x00000001;
+static const uint32_t BLOCK_ENHANCED_PACKET = 0x00000006;
+static const uint16_t OPT_END = 0;
+static const uint16_t OPT_IF_NAME = 2;
+
+static const uint16_t LINKTYPE_ETHERNET = 1;
+static const uint16_t LINKTYPE_PPP = 9;
+
+static void
+put16 (std::string &out, uint16_t v)
+{
+    out.append((const char *)&v, sizeof(v));
+}
+
+static void
+put32 (std::string &out, uint32_t v)
+{
+    out.append((const char *)&v, sizeof(v));
+}
+
+static void
+pad (std::string &out, uint32_t len)
+{
+    out.append((4 - len % 4) % 4, '\0');
+}
+
+/* Wrap body in a block: type, total length, body, total length. */
+static void
+putBlock (std::string &out, uint32_t type, const std::string &body)
+{
+    uint32_t total = 12 + body.size();
+    put32(out, type);
+    put32(out, total);
+    out += body;
+    put32(out, total);
+}
+
+PcapngCapture::PcapngCapture (std::string prefix, Grouping grouping, uint32_t snaplen)
+    : m_prefix (prefix),
+      m_grouping (grouping),
+      m_snaplen (snaplen)
+{
+}
+
+PcapngCapture::~PcapngCapture ()
+{
+    Close();
+}
+
+void
+PcapngCapture::Watch (NetDeviceContainer devices, std::string name, bool promiscuous)
+{
+    for (NetDeviceContainer::Iterator it = devices.Begin(); it != devices.End(); ++it) {
+        Ptr<NetDevice> device = *it;
+        uint32_t node = device->GetNode()->GetId();
+        std::string type = device->GetInstanceTypeId().GetName();
+
+        uint16_t linkType;
+        if (type == "ns3::PointToPointNetDevice") {
+            linkType = LINKTYPE_PPP;
+        } else if (type == "ns3::CsmaNetDevice" || type == "ns3::BroadcastNetDevice") {
+            linkType = LINKTYPE_ETHERNET;
+        } else {
+            NS_FATAL_ERROR ("PcapngCapture can not capture " << type);
+        }
+
+        uint32_t key = m_grouping == PER_NODE ? node : 0;
+        std::map<uint32_t, uint32_t>::iterator fit = m_fileIndex.find(key);
+        if (fit == m_fileIndex.end()) {
+            std::ostringstream name;
+            name << m_prefix;
+            if (m_grouping == PER_NODE) {
+                name << "-" << node;
+            }
+            name << ".pcapng";
+
+            File file;
+            file.name = name.str();
+            file.nInterfaces = 0;
+            file.f = 0;
+            file.pid = 0;
+
+            std::string shb;
+            put32(shb, 0x1a2b3c4d);
+            put16(shb, 1);
+            put16(shb, 0);
+            /* Section length unknown */
+            put32(shb, 0xffffffff);
+            put32(shb, 0xffffffff);
+            putBlock(file.headers, BLOCK_SECTION_HEADER, shb);
+
+            m_files.push_back(file);
+            fit = m_fileIndex.insert(std::make_pair(key, m_files.size() - 1)).first;
+        }
+        File &file = m_files[fit->second];
+
+        std::ostringstream ifName;
+        ifName << name << "-" << node << "-" << device->GetIfIndex();
+        std::string idb;
+        put16(idb, linkType);
+        put16(idb, 0);
+        put32(idb, m_snaplen);
+        put16(idb, OPT_IF_NAME);
+        put16(idb, ifName.str().size());
+        idb += ifName.str();
+        pad(idb, ifName.str().size());
+        put16(idb, OPT_END);
+        put16(idb, 0);
+
+        /* Interfaces come before any frames, so they can go with the headers. */
+        putBlock(file.headers, BLOCK_INTERFACE, idb);
+        m_interfaces.push_back(std::make_pair(fit->second, file.nInterfaces++));
+
+        std::ostringstream context;
+        context << m_interfaces.size() - 1;
+        device->TraceConnect(promiscuous ? "PromiscSniffer" : "Sniffer", context.str(),
+                             MakeCallback (&PcapngCapture::Capture, this));
+    }
+}
+
+void
+PcapngCapture::Capture (std::string context, Ptr<const Packet> packet)
+{
+    const std::pair<uint32_t, uint32_t> &iface = m_interfaces[atoi(context.c_str())];
+    File &file = m_files[iface.first];
+
+    uint64_t us = Simulator::Now().GetMicroSeconds();
+    uint32_t len = packet->GetSize();
+    uint32_t caplen = std::min(len, m_snaplen);
+    uint32_t total = 32 + caplen + (4 - caplen % 4) % 4;
+
+    /* Built in place: this runs for every frame. */
+    std::string &out = file.buffer;
+    put32(out, BLOCK_ENHANCED_PACKET);
+    put32(out, total);
+    put32(out, iface.second);
+    put32(out, us >> 32);
+    put32(out, us & 0xffffffff);
+    put32(out, caplen);
+    put32(out, len);
+    size_t at = out.size();
+    out.resize(at + caplen);
+    if (caplen > 0) {
+        packet->CopyData((uint8_t *)&out[at], caplen);
+    }
+    pad(out, caplen);
+    put32(out, total);
+
+    if (out.size() >= BUFFER_SIZE) {
+        Flush(file);
+    }
+}
+
+void
+PcapngCapture::Flush (PcapngCapture::File &file)
+{
+    if (file.f && file.pid != getpid()) {
+        /* Forked since it was opened: that handle is the parent's. */
+        file.f = 0;
+    }
+    if (!file.f) {
+        file.f = fopen(file.name.c_str(), "wb");
+        if (!file.f) {
+            NS_FATAL_ERROR ("Could not open " << file.name);
+        }
+        file.pid = getpid();
+        fwrite(file.headers.data(), 1, file.headers.size(), file.f);
+    }
+    fwrite(file.buffer.data(), 1, file.buffer.size(), file.f);
+    file.buffer.clear();
+}
+
+void
+PcapngCapture::Close (void)
+{
+    for (std::vector<File>::iterator it = m_files.begin(); it != m_files.end(); ++it) {
+        if (it->f && it->pid != getpid()) {
+            it->f = 0;
+        }
+        if (!it->buffer.empty() || !it->f) {
+            Flush(*it);
+        }
+        fclose(it->f);
+        it->f = 0;
+    }
+    m_files.clear();
+    m_fileIndex.clear();
+    m_interfaces.clear();
+}
+
+}
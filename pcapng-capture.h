@@ -0,0 +1,74 @@
+#ifndef PCAPNG_CAPTURE_H
+#define PCAPNG_CAPTURE_H
+
+#include "ns3/net-device-container.h"
+#include "ns3/packet.h"
+
+#include <sys/types.h>
+#include <stdio.h>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * Captures many devices into a few pcapng files instead of one pcap
+ * file each.
+ *
+ * With PER_NODE every node gets <prefix>-<node>.pcapng, with MERGED the
+ * whole scenario shares <prefix>.pcapng. Each device is an interface
+ * of its file, named <name>-<node>-<device> like the pcap it replaces,
+ * with that pcap's link type. Frames are appended to an in memory
+ * buffer per file and written BUFFER_SIZE bytes at a time.
+ *
+ * A file is only opened at its first write, and reopened (headers
+ * included) by a process forked after that (Replicator), so each
+ * replication writes its own.
+ */
+class PcapngCapture
+{
+public:
+    enum Grouping {
+        PER_NODE,
+        MERGED
+    };
+
+    static const uint32_t BUFFER_SIZE = 1 << 20;
+
+    PcapngCapture (std::string prefix, Grouping grouping, uint32_t snaplen = 65535);
+    ~PcapngCapture ();
+
+    /* Capture what PcapHelper::EnablePcap (name, devices, promiscuous) would. */
+    void Watch (NetDeviceContainer devices, std::string name, bool promiscuous);
+
+    /* Write what is buffered and close the files; call after Simulator::Run. */
+    void Close (void);
+
+private:
+    struct File {
+        std::string name;
+        std::string headers;
+        std::string buffer;
+        uint32_t nInterfaces;
+        FILE *f;
+        pid_t pid;
+    };
+
+    void Capture (std::string context, Ptr<const Packet> packet);
+    void Flush (File &file);
+
+    std::string m_prefix;
+    Grouping m_grouping;
+    uint32_t m_snaplen;
+
+    std::vector<File> m_files;
+    /* Node id (0 when merged) to file */
+    std::map<uint32_t, uint32_t> m_fileIndex;
+    /* Per watched device: file and interface id */
+    std::vector<std::pair<uint32_t, uint32_t> > m_interfaces;
+};
+
+}
+
+#endif /* PCAPNG_CAPTURE_H */
@@ -0,0 +1,211 @@
+#include "process-log.h"
+
+#include "ns3/dce-application.h"
+#include "ns3/node.h"
+#include "ns3/simulator.h"
+#include "ns3/log.h"
+#include "ns3/fatal-error.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+#include <unistd.h>
+
+NS_LOG_COMPONENT_DEFINE ("ProcessLog");
+
+namespace ns3 {
+
+/* Scale of the unit prefix iperf prints, for bytes (binary) or bits (decimal). */
+static double
+unitScale (const char *unit, bool bytes)
+{
+    double base = bytes ? 1024 : 1000;
+    switch (unit[0]) {
+    case 'K': return base;
+    case 'M': return base * base;
+    case 'G': return base * base * base;
+    default: return 1;
+    }
+}
+
+ProcessLog::ProcessLog (std::string file, Time interval)
+    : m_file (file),
+      m_interval (interval),
+      m_out (0),
+      m_pid (0),
+      m_nRows (0)
+{
+}
+
+ProcessLog::~ProcessLog ()
+{
+    Close();
+}
+
+void
+ProcessLog::Watch (ApplicationContainer apps, std::string name, Format format)
+{
+    Source source;
+    source.name = name;
+    source.format = format;
+    m_sources.push_back(source);
+
+    for (ApplicationContainer::Iterator it = apps.Begin(); it != apps.End(); ++it) {
+        Ptr<DceApplication> app = DynamicCast<DceApplication> (*it);
+        if (!app) {
+            NS_FATAL_ERROR ("ProcessLog " << name << ": only DCE applications have a log");
+        }
+        /* The context carries the node and the source into ProcessStarted. */
+        std::ostringstream context;
+        context << app->GetNode()->GetId() << " " << m_sources.size() - 1;
+        app->TraceConnect("ProcessStarted", context.str(),
+                          MakeCallback (&ProcessLog::ProcessStarted, this));
+    }
+}
+
+void
+ProcessLog::Install (void)
+{
+    Simulator::Schedule(m_interval, &ProcessLog::Poll, this);
+}
+
+void
+ProcessLog::ProcessStarted (std::string context, uint16_t pid)
+{
+    Process process;
+    std::istringstream in (context);
+    in >> process.node >> process.source;
+    process.pid = pid;
+    process.offset = 0;
+
+    /* DCE maps a node's "/" onto files-<node id> in the working directory. */
+    std::ostringstream path;
+    path << "files-" << process.node << "/var/log/" << pid << "/stdout";
+    process.path = path.str();
+    m_processes.push_back(process);
+}
+
+void
+ProcessLog::Poll (void)
+{
+    for (std::vector<Process>::iterator it = m_processes.begin(); it != m_processes.end(); ++it) {
+        Read(*it);
+    }
+    Simulator::Schedule(m_interval, &ProcessLog::Poll, this);
+}
+
+void
+ProcessLog::Read (Process &process)
+{
+    FILE *f = fopen(process.path.c_str(), "r");
+    if (!f) {
+        return;
+    }
+    if (fseek(f, process.offset, SEEK_SET) != 0) {
+        fclose(f);
+        return;
+    }
+
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        process.offset += n;
+        process.partial.append(buf, n);
+    }
+    fclose(f);
+
+    /* Complete lines only; the rest waits for the next read. */
+    size_t start = 0, end;
+    while ((end = process.partial.find('\n', start)) != std::string::npos) {
+        std::string line = process.partial.substr(start, end - start);
+        if (m_sources[process.source].format == IPERF) {
+            ParseIperf(process, line);
+        } else {
+            ParsePing(process, line);
+        }
+        start = end + 1;
+    }
+    process.partial.erase(0, start);
+}
+
+void
+ProcessLog::ParseIperf (const Process &process, const std::string &line)
+{
+    /* [  3]  0.0- 1.0 sec  1.12 MBytes  9.44 Mbits/sec, or [SUM] for -P */
+    char id[16], amountUnit[16], rateUnit[16];
+    double start, end, amount, rate;
+    if (sscanf(line.c_str(), " [%15[^]]] %lf-%lf sec %lf %15s %lf %15s",
+               id, &start, &end, &amount, amountUnit, &rate, rateUnit) != 7
+        || strstr(rateUnit, "bits/sec") == 0) {
+        return;
+    }
+    char *trimmed = id;
+    while (*trimmed == ' ') {
+        trimmed++;
+    }
+
+    FILE *out = Row(process);
+    fprintf(out, "iperf,%s,%g,%g,%.0f,%.0f,,,\n", trimmed, start, end,
+            amount * unitScale(amountUnit, true), rate * unitScale(rateUnit, false));
+}
+
+void
+ProcessLog::ParsePing (const Process &process, const std::string &line)
+{
+    /* 64 bytes from 10.1.1.2: icmp_seq=1 ttl=63 time=100 ms */
+    const char *seq = strstr(line.c_str(), "icmp_seq=");
+    const char *ttl = strstr(line.c_str(), "ttl=");
+    const char *time = strstr(line.c_str(), "time=");
+    if (!seq || !ttl || !time) {
+        return;
+    }
+
+    FILE *out = Row(process);
+    fprintf(out, "ping,,,,,,%d,%d,%g\n", atoi(seq + 9), atoi(ttl + 4), atof(time + 5));
+}
+
+FILE *
+ProcessLog::Row (const Process &process)
+{
+    if (m_out && m_pid != getpid()) {
+        /* Forked since it was opened: that stream is the parent's. */
+        m_out = 0;
+    }
+    if (!m_out) {
+        m_out = fopen(m_file.c_str(), "w");
+        if (!m_out) {
+            NS_FATAL_ERROR ("Could not open " << m_file);
+        }
+        m_pid = getpid();
+        fprintf(m_out, "time,node,pid,name,kind,id,start,end,bytes,bits_per_second,seq,ttl,rtt_ms\n");
+    }
+
+    m_nRows++;
+    fprintf(m_out, "%g,%u,%u,%s,", Simulator::Now().GetSeconds(), process.node,
+            (uint32_t)process.pid, m_sources[process.source].name.c_str());
+    return m_out;
+}
+
+uint64_t
+ProcessLog::GetNRows (void) const
+{
+    return m_nRows;
+}
+
+void
+ProcessLog::Close (void)
+{
+    for (std::vector<Process>::iterator it = m_processes.begin(); it != m_processes.end(); ++it) {
+        Read(*it);
+    }
+    m_processes.clear();
+
+    if (m_out && m_pid == getpid()) {
+        fclose(m_out);
+        NS_LOG_INFO (m_file << ": " << m_nRows << " rows");
+    }
+    m_out = 0;
+}
+
+}
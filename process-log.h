@@ -0,0 +1,87 @@
+#ifndef PROCESS_LOG_H
+#define PROCESS_LOG_H
+
+#include "ns3/application-container.h"
+#include "ns3/nstime.h"
+
+#include <sys/types.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * Collects the results DCE processes print into one CSV file while the
+ * simulation runs, instead of leaving them in files-<node>/var/log/<pid>/stdout.
+ *
+ * Every interval the stdout of each watched process is read from where
+ * the last read stopped, and each complete line its parser recognises
+ * becomes a row:
+ *
+ *   time,node,pid,name,kind,id,start,end,bytes,bits_per_second,seq,ttl,rtt_ms
+ *
+ * where time is the simulation time the line was read at, kind is iperf
+ * (interval and summary lines: id, start, end, bytes, bits_per_second)
+ * or ping (replies: seq, ttl, rtt_ms), and columns of the other kind
+ * are empty. The logs themselves are left as they are.
+ *
+ * The file is only opened at the first row, and reopened by a process
+ * forked after that (Replicator), so each replication writes its own.
+ */
+class ProcessLog
+{
+public:
+    enum Format {
+        IPERF,
+        PING
+    };
+
+    ProcessLog (std::string file, Time interval = Seconds (1));
+    ~ProcessLog ();
+
+    /* Parse the output of the DCE applications in apps as format. */
+    void Watch (ApplicationContainer apps, std::string name, Format format);
+
+    /* Start reading; call once, before Simulator::Run. */
+    void Install (void);
+
+    /* Read what the processes wrote last and close the file; call after Simulator::Run. */
+    void Close (void);
+
+    uint64_t GetNRows (void) const;
+
+private:
+    struct Source {
+        std::string name;
+        Format format;
+    };
+    struct Process {
+        uint32_t node;
+        uint16_t pid;
+        uint32_t source;
+        std::string path;
+        long offset;
+        std::string partial;
+    };
+
+    void ProcessStarted (std::string context, uint16_t pid);
+    void Poll (void);
+    void Read (Process &process);
+    void ParseIperf (const Process &process, const std::string &line);
+    void ParsePing (const Process &process, const std::string &line);
+    FILE *Row (const Process &process);
+
+    std::string m_file;
+    Time m_interval;
+    FILE *m_out;
+    pid_t m_pid;
+    uint64_t m_nRows;
+
+    std::vector<Source> m_sources;
+    std::vector<Process> m_processes;
+};
+
+}
+
+#endif /* PROCESS_LOG_H */
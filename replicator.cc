@@ -0,0 +1,189 @@
+#include "replicator.h"
+#include "trace-rtt-random-variable.h"
+
+#include "ns3/rng-seed-manager.h"
+#include "ns3/simulator.h"
+#include "ns3/log.h"
+#include "ns3/fatal-error.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+NS_LOG_COMPONENT_DEFINE ("Replicator");
+
+namespace ns3 {
+
+Replicator::Replicator (uint32_t replications, Time checkpoint)
+    : m_replications (replications > 0 ? replications : 1),
+      m_checkpoint (checkpoint),
+      m_replication (0),
+      m_forked (false),
+      m_stdout (-1),
+      m_stderr (-1)
+{
+}
+
+void
+Replicator::AddStream (Ptr<RandomVariableStream> stream)
+{
+    if (stream) {
+        m_streams.push_back(stream);
+    }
+}
+
+void
+Replicator::Install (void)
+{
+    if (IsEnabled()) {
+        /* Streams created before the checkpoint keep their draws; only those re-seeded differ. */
+        if (m_streams.empty()) {
+            NS_FATAL_ERROR ("Replicator: " << m_replications << " replications but no random streams"
+                            " to re-seed, so every replication would be the same");
+        }
+        Simulator::Schedule(m_checkpoint, &Replicator::Fork, this);
+    }
+}
+
+bool
+Replicator::IsEnabled (void) const
+{
+    return m_replications > 1;
+}
+
+Time
+Replicator::GetCheckpoint (void) const
+{
+    return m_checkpoint;
+}
+
+uint32_t
+Replicator::GetReplication (void) const
+{
+    return m_replication;
+}
+
+void
+Replicator::Fork (void)
+{
+    NS_LOG_INFO ("checkpoint at " << Simulator::Now().GetSeconds() << "s, forking "
+                 << m_replications - 1 << " replications");
+
+    /* Anything still buffered would be written once per process. */
+    std::cout.flush();
+    std::cerr.flush();
+    fflush(NULL);
+
+    m_forked = true;
+    for (uint32_t i = 1; i < m_replications; i++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            NS_FATAL_ERROR ("fork for replication " << i << " failed: " << strerror(errno));
+        }
+        if (pid == 0) {
+            m_children.clear();
+            Enter(i);
+            return;
+        }
+        m_children.push_back(pid);
+    }
+
+    /* Keep the parent's terminal for the summary in Finish. */
+    m_stdout = dup(STDOUT_FILENO);
+    m_stderr = dup(STDERR_FILENO);
+    Enter(0);
+}
+
+void
+Replicator::Enter (uint32_t replication)
+{
+    m_replication = replication;
+
+    std::ostringstream dir;
+    dir << "rep-" << replication;
+    if (mkdir(dir.str().c_str(), 0755) != 0 && errno != EEXIST) {
+        NS_FATAL_ERROR ("Could not create " << dir.str() << ": " << strerror(errno));
+    }
+    if (chdir(dir.str().c_str()) != 0) {
+        NS_FATAL_ERROR ("Could not enter " << dir.str() << ": " << strerror(errno));
+    }
+
+    int fd = open("stdout", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        NS_FATAL_ERROR ("Could not open " << dir.str() << "/stdout: " << strerror(errno));
+    }
+    dup2(fd, STDOUT_FILENO);
+    dup2(fd, STDERR_FILENO);
+    close(fd);
+
+    if (replication == 0) {
+        return;
+    }
+
+    RngSeedManager::SetRun(RngSeedManager::GetRun() + replication);
+    for (std::vector<Ptr<RandomVariableStream> >::iterator it = m_streams.begin(); it != m_streams.end(); ++it) {
+        /* Rebuilds the generator from the current seed and run. */
+        (*it)->SetStream((*it)->GetStream());
+        Ptr<TraceRttRandomVariable> rtt = DynamicCast<TraceRttRandomVariable> (*it);
+        if (rtt) {
+            rtt->Flush();
+        }
+    }
+    NS_LOG_INFO ("replication " << replication << ": run " << RngSeedManager::GetRun());
+}
+
+int
+Replicator::Finish (void)
+{
+    if (!m_forked) {
+        return 0;
+    }
+
+    std::cout.flush();
+    std::cerr.flush();
+    fflush(NULL);
+
+    if (m_replication != 0) {
+        exit(0);
+    }
+
+    dup2(m_stdout, STDOUT_FILENO);
+    dup2(m_stderr, STDERR_FILENO);
+    close(m_stdout);
+    close(m_stderr);
+    if (chdir("..") != 0) {
+        NS_LOG_WARN ("Could not leave rep-0: " << strerror(errno));
+    }
+
+    std::cout << "Replication 0: done" << std::endl;
+
+    int failed = 0;
+    for (uint32_t i = 0; i < m_children.size(); i++) {
+        int status;
+        if (waitpid(m_children[i], &status, 0) < 0) {
+            NS_FATAL_ERROR ("waitpid for replication " << i + 1 << " failed: " << strerror(errno));
+        }
+        std::cout << "Replication " << i + 1 << ": ";
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+            std::cout << "done";
+        } else if (WIFEXITED(status)) {
+            std::cout << "exit status " << WEXITSTATUS(status);
+            failed++;
+        } else {
+            std::cout << "killed by signal " << WTERMSIG(status);
+            failed++;
+        }
+        std::cout << std::endl;
+    }
+    return failed;
+}
+
+}
@@ -0,0 +1,67 @@
+#ifndef REPLICATOR_H
+#define REPLICATOR_H
+
+#include "ns3/nstime.h"
+#include "ns3/random-variable-stream.h"
+
+#include <sys/types.h>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * Runs several replications of a scenario from one configured state.
+ *
+ * Setup (ip, sysctl, iptables...) is the same for every seed, so the run
+ * is only built and configured once. At the checkpoint the process forks
+ * one child per extra replication. Replication i works in "rep-<i>/",
+ * with stdout and stderr sent to rep-<i>/stdout, RNG run number
+ * base run + i and every stream given to AddStream re-seeded for that
+ * run. Replication 0 is the parent and draws exactly what an
+ * unreplicated run would. All replications then run concurrently.
+ *
+ * The checkpoint must come after setup and before any long running DCE
+ * process starts, since open files are shared with the children, and
+ * DCE must use the UcontextFiberManager, since threads do not survive
+ * fork. Files opened before the checkpoint (pcaps, config stores) are
+ * written once, by the parent, outside the replica directories.
+ */
+class Replicator
+{
+public:
+    Replicator (uint32_t replications, Time checkpoint);
+
+    /* Re-seed stream with each replication's run number after the fork. */
+    void AddStream (Ptr<RandomVariableStream> stream);
+
+    /* Schedule the fork; call before Simulator::Run. */
+    void Install (void);
+
+    bool IsEnabled (void) const;
+    Time GetCheckpoint (void) const;
+    /* 0 in the parent, i in the child running replication i. */
+    uint32_t GetReplication (void) const;
+
+    /**
+     * Call after Simulator::Destroy. Children exit here; the parent
+     * waits for them, prints their status and returns how many failed.
+     */
+    int Finish (void);
+
+private:
+    void Fork (void);
+    void Enter (uint32_t replication);
+
+    uint32_t m_replications;
+    Time m_checkpoint;
+    uint32_t m_replication;
+    bool m_forked;
+    int m_stdout;
+    int m_stderr;
+    std::vector<pid_t> m_children;
+    std::vector<Ptr<RandomVariableStream> > m_streams;
+};
+
+}
+
+#endif /* REPLICATOR_H */
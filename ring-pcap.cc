@@ -0,0 +1,350 @@
+#include "ring-pcap.h"
+#include "frame-headers.h"
+
+#include "ns3/node.h"
+#include "ns3/simulator.h"
+#include "ns3/log.h"
+#include "ns3/fatal-error.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+#include <unistd.h>
+
+NS_LOG_COMPONENT_DEFINE ("RingPcap");
+
+namespace ns3 {
+
+/* Data link types of the pcap header */
+static const uint32_t LINKTYPE_ETHERNET = 1;
+static const uint32_t LINKTYPE_PPP = 9;
+
+/* Queue a post trigger block once it is this large. */
+static const uint32_t BLOCK_SIZE = 64 * 1024;
+
+RingPcap::RingPcap (uint32_t snaplen, uint32_t capacity)
+    : m_snaplen (std::max(snaplen, (uint32_t)64)),
+      m_capacity (std::max(capacity, (uint32_t)1)),
+      m_postTrigger (std::max(capacity / 4, (uint32_t)1)),
+      m_maxTriggers (10),
+      m_nTriggers (0),
+      m_onReset (false),
+      m_fraction (0),
+      m_intervalBytes (0),
+      m_average (0),
+      m_writerPid (0),
+      m_closing (false)
+{
+}
+
+RingPcap::~RingPcap ()
+{
+    Close();
+}
+
+void
+RingPcap::Watch (NetDeviceContainer devices, std::string prefix, bool promiscuous)
+{
+    for (NetDeviceContainer::Iterator it = devices.Begin(); it != devices.End(); ++it) {
+        Ptr<NetDevice> device = *it;
+        std::string type = device->GetInstanceTypeId().GetName();
+
+        Ring ring;
+        if (type == "ns3::PointToPointNetDevice") {
+            ring.linkType = LINKTYPE_PPP;
+            ring.ppp = true;
+        } else if (type == "ns3::CsmaNetDevice" || type == "ns3::BroadcastNetDevice") {
+            ring.linkType = LINKTYPE_ETHERNET;
+            ring.ppp = false;
+        } else {
+            NS_FATAL_ERROR ("RingPcap can not capture " << type);
+        }
+
+        std::ostringstream file;
+        file << prefix << "-" << device->GetNode()->GetId() << "-" << device->GetIfIndex() << ".pcap";
+        ring.file = file.str();
+        ring.data.resize((size_t)m_capacity * m_snaplen);
+        ring.records.resize(m_capacity);
+        ring.head = 0;
+        ring.count = 0;
+        ring.post = 0;
+        m_rings.push_back(ring);
+
+        /* The trace sources PcapHelper uses, so frames carry the same headers. */
+        std::ostringstream context;
+        context << m_rings.size() - 1;
+        device->TraceConnect(promiscuous ? "PromiscSniffer" : "Sniffer", context.str(),
+                             MakeCallback (&RingPcap::Capture, this));
+    }
+}
+
+void
+RingPcap::SetPostTrigger (uint32_t frames)
+{
+    m_postTrigger = frames;
+}
+
+void
+RingPcap::SetMaxTriggers (uint32_t maxTriggers)
+{
+    m_maxTriggers = maxTriggers;
+}
+
+void
+RingPcap::TriggerOnReset (void)
+{
+    m_onReset = true;
+}
+
+void
+RingPcap::TriggerOnCollapse (Time interval, double fraction, Time notBefore, Time until)
+{
+    m_interval = interval;
+    m_fraction = fraction;
+    m_until = until;
+    Simulator::Schedule(notBefore, &RingPcap::StartCollapse, this);
+}
+
+uint32_t
+RingPcap::GetNTriggers (void) const
+{
+    return m_nTriggers;
+}
+
+void
+RingPcap::Capture (std::string context, Ptr<const Packet> packet)
+{
+    uint32_t index = atoi(context.c_str());
+    Ring &ring = m_rings[index];
+
+    Record record;
+    record.us = Simulator::Now().GetMicroSeconds();
+    record.len = packet->GetSize();
+    record.caplen = std::min(record.len, m_snaplen);
+    m_intervalBytes += record.len;
+
+    uint8_t *data;
+    std::vector<uint8_t> direct;
+    if (ring.post > 0) {
+        direct.resize(record.caplen);
+        data = direct.empty() ? 0 : &direct[0];
+    } else {
+        data = &ring.data[(size_t)ring.head * m_snaplen];
+        ring.records[ring.head] = record;
+        ring.head = (ring.head + 1) % m_capacity;
+        ring.count = std::min(ring.count + 1, m_capacity);
+    }
+    packet->CopyData(data, record.caplen);
+
+    if (ring.post > 0) {
+        Append(ring.pending, record, data);
+        if (--ring.post == 0 || ring.pending.size() >= BLOCK_SIZE) {
+            Queue(index, ring.pending);
+        }
+    }
+
+    if (m_onReset) {
+        FrameHeaders h;
+        if (h.Parse(data, record.caplen, ring.ppp) && h.tcp && (h.flags & FrameHeaders::TCP_RST)) {
+            std::ostringstream reason;
+            reason << "TCP reset " << h.sport << " > " << h.dport << " on " << ring.file;
+            Trigger(reason.str());
+        }
+    }
+}
+
+void
+RingPcap::StartCollapse (void)
+{
+    /* Bytes from before notBefore would make the first interval look longer than it is. */
+    m_intervalBytes = 0;
+    m_average = 0;
+    if (Simulator::Now() + m_interval <= m_until) {
+        Simulator::Schedule(m_interval, &RingPcap::CheckCollapse, this);
+    }
+}
+
+void
+RingPcap::CheckCollapse (void)
+{
+    double bytes = m_intervalBytes;
+    m_intervalBytes = 0;
+
+    if (m_average > 0 && bytes < m_fraction * m_average) {
+        std::ostringstream reason;
+        reason << "throughput collapse, " << bytes << " bytes against " << m_average << " average";
+        Trigger(reason.str());
+    }
+    m_average = m_average > 0 ? 0.8 * m_average + 0.2 * bytes : bytes;
+
+    if (Simulator::Now() + m_interval <= m_until) {
+        Simulator::Schedule(m_interval, &RingPcap::CheckCollapse, this);
+    }
+}
+
+void
+RingPcap::Trigger (std::string reason)
+{
+    if (m_nTriggers >= m_maxTriggers) {
+        NS_LOG_INFO ("ignoring trigger, " << m_maxTriggers << " already: " << reason);
+        return;
+    }
+    for (std::vector<Ring>::const_iterator it = m_rings.begin(); it != m_rings.end(); ++it) {
+        if (it->post > 0) {
+            NS_LOG_INFO ("ignoring trigger while writing the last one: " << reason);
+            return;
+        }
+    }
+
+    m_nTriggers++;
+    std::cout << "PCAP: trigger " << m_nTriggers << " at " << Simulator::Now().GetSeconds()
+              << "s: " << reason << std::endl;
+
+    for (uint32_t i = 0; i < m_rings.size(); i++) {
+        Flush(i);
+    }
+}
+
+void
+RingPcap::Flush (uint32_t index)
+{
+    Ring &ring = m_rings[index];
+    std::string out;
+
+    for (uint32_t i = 0; i < ring.count; i++) {
+        uint32_t slot = (ring.head + m_capacity - ring.count + i) % m_capacity;
+        Append(out, ring.records[slot], &ring.data[(size_t)slot * m_snaplen]);
+    }
+    ring.count = 0;
+    ring.post = m_postTrigger;
+
+    Queue(index, out);
+}
+
+void
+RingPcap::Append (std::string &out, const Record &record, const uint8_t *data) const
+{
+    uint32_t header[4];
+    header[0] = record.us / 1000000;
+    header[1] = record.us % 1000000;
+    header[2] = record.caplen;
+    header[3] = record.len;
+    out.append((const char *)header, sizeof(header));
+    out.append((const char *)data, record.caplen);
+}
+
+void
+RingPcap::Queue (uint32_t index, std::string &data)
+{
+    if (data.empty()) {
+        return;
+    }
+    if (m_writerPid != getpid()) {
+        StartWriter();
+    }
+
+    Block block;
+    block.ring = index;
+    pthread_mutex_lock(&m_mutex);
+    m_queue.push_back(block);
+    m_queue.back().data.swap(data);
+    pthread_cond_signal(&m_cond);
+    pthread_mutex_unlock(&m_mutex);
+}
+
+void
+RingPcap::StartWriter (void)
+{
+    /* Also after a fork (Replicator): the thread did not come along and the files belong to the parent. */
+    m_writerPid = getpid();
+    m_closing = false;
+    m_queue.clear();
+    m_files.assign(m_rings.size(), (FILE *)0);
+    pthread_mutex_init(&m_mutex, 0);
+    pthread_cond_init(&m_cond, 0);
+    if (pthread_create(&m_thread, 0, &RingPcap::WriterMain, this) != 0) {
+        NS_FATAL_ERROR ("Could not start the pcap writer thread");
+    }
+}
+
+void *
+RingPcap::WriterMain (void *arg)
+{
+    RingPcap *self = (RingPcap *)arg;
+
+    pthread_mutex_lock(&self->m_mutex);
+    for (;;) {
+        while (self->m_queue.empty() && !self->m_closing) {
+            pthread_cond_wait(&self->m_cond, &self->m_mutex);
+        }
+        if (self->m_queue.empty()) {
+            break;
+        }
+        Block block;
+        block.ring = self->m_queue.front().ring;
+        block.data.swap(self->m_queue.front().data);
+        self->m_queue.pop_front();
+
+        pthread_mutex_unlock(&self->m_mutex);
+        self->WriteBlock(block);
+        pthread_mutex_lock(&self->m_mutex);
+    }
+    pthread_mutex_unlock(&self->m_mutex);
+    return 0;
+}
+
+void
+RingPcap::WriteBlock (const Block &block)
+{
+    const Ring &ring = m_rings[block.ring];
+    FILE *&f = m_files[block.ring];
+
+    if (!f) {
+        f = fopen(ring.file.c_str(), "wb");
+        if (!f) {
+            NS_LOG_WARN ("Could not open " << ring.file);
+            return;
+        }
+        /* Host byte order, microsecond timestamps, version 2.4 */
+        uint32_t magic = 0xa1b2c3d4;
+        uint16_t version[2] = { 2, 4 };
+        uint32_t rest[4] = { 0, 0, m_snaplen, ring.linkType };
+        fwrite(&magic, sizeof(magic), 1, f);
+        fwrite(version, sizeof(version), 1, f);
+        fwrite(rest, sizeof(rest), 1, f);
+    }
+    fwrite(block.data.data(), 1, block.data.size(), f);
+}
+
+void
+RingPcap::Close (void)
+{
+    if (m_writerPid != getpid()) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < m_rings.size(); i++) {
+        Queue(i, m_rings[i].pending);
+    }
+
+    pthread_mutex_lock(&m_mutex);
+    m_closing = true;
+    pthread_cond_signal(&m_cond);
+    pthread_mutex_unlock(&m_mutex);
+    pthread_join(m_thread, 0);
+
+    for (std::vector<FILE *>::iterator it = m_files.begin(); it != m_files.end(); ++it) {
+        if (*it) {
+            fclose(*it);
+        }
+    }
+    m_files.clear();
+    pthread_mutex_destroy(&m_mutex);
+    pthread_cond_destroy(&m_cond);
+    m_writerPid = 0;
+}
+
+}
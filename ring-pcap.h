@@ -0,0 +1,121 @@
+#ifndef RING_PCAP_H
+#define RING_PCAP_H
+
+#include "ns3/net-device-container.h"
+#include "ns3/packet.h"
+#include "ns3/nstime.h"
+
+#include <pthread.h>
+#include <sys/types.h>
+#include <stdio.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * Pcap capture that only keeps what is needed to debug an event.
+ *
+ * Each watched device has a ring of the last "capacity" frames, cut to
+ * snaplen bytes (headers only by default), in memory allocated up front.
+ * Nothing is written until a trigger: then every ring is written out and
+ * the next post trigger frames of each device go straight to its file,
+ * after which capture goes back to the ring. Triggers are Trigger calls
+ * from the scenario, a TCP reset in a captured frame (TriggerOnReset),
+ * or the captured bytes per interval falling below a fraction of their
+ * running average (TriggerOnCollapse).
+ *
+ * The event loop only copies frames; files are written by a background
+ * thread, started at the first trigger. Files are <prefix>-<node>-<device>.pcap,
+ * as with PcapHelper, and only exist for runs that triggered.
+ */
+class RingPcap
+{
+public:
+    RingPcap (uint32_t snaplen = 96, uint32_t capacity = 4096);
+    ~RingPcap ();
+
+    /* Capture what PcapHelper::EnablePcap (prefix, devices, promiscuous) would. */
+    void Watch (NetDeviceContainer devices, std::string prefix, bool promiscuous);
+
+    /* Frames written per device after a trigger; default capacity / 4. */
+    void SetPostTrigger (uint32_t frames);
+    /* Triggers after the first maxTriggers are ignored; default 10. */
+    void SetMaxTriggers (uint32_t maxTriggers);
+
+    void TriggerOnReset (void);
+    /**
+     * Between notBefore and until, trigger when an interval captures less
+     * than fraction of the running average of the intervals before it.
+     * Intervals are counted from notBefore.
+     */
+    void TriggerOnCollapse (Time interval, double fraction, Time notBefore, Time until);
+
+    void Trigger (std::string reason);
+
+    uint32_t GetNTriggers (void) const;
+
+    /* Write what is pending and stop the writer; call after Simulator::Run. */
+    void Close (void);
+
+private:
+    struct Record {
+        int64_t us;
+        uint32_t caplen;
+        uint32_t len;
+    };
+    struct Ring {
+        std::string file;
+        uint32_t linkType;
+        bool ppp;
+        std::vector<uint8_t> data;
+        std::vector<Record> records;
+        uint32_t head;
+        uint32_t count;
+        uint32_t post;
+        std::string pending;
+    };
+    struct Block {
+        uint32_t ring;
+        std::string data;
+    };
+
+    void Capture (std::string context, Ptr<const Packet> packet);
+    void StartCollapse (void);
+    void CheckCollapse (void);
+    void Flush (uint32_t index);
+    void Append (std::string &out, const Record &record, const uint8_t *data) const;
+    void Queue (uint32_t index, std::string &data);
+    void StartWriter (void);
+    static void *WriterMain (void *arg);
+    void WriteBlock (const Block &block);
+
+    uint32_t m_snaplen;
+    uint32_t m_capacity;
+    uint32_t m_postTrigger;
+    uint32_t m_maxTriggers;
+    uint32_t m_nTriggers;
+    bool m_onReset;
+
+    Time m_interval;
+    double m_fraction;
+    Time m_until;
+    uint64_t m_intervalBytes;
+    double m_average;
+
+    std::vector<Ring> m_rings;
+
+    /* Writer thread; m_queue and m_closing are shared with it under m_mutex. */
+    pid_t m_writerPid;
+    pthread_t m_thread;
+    pthread_mutex_t m_mutex;
+    pthread_cond_t m_cond;
+    std::deque<Block> m_queue;
+    bool m_closing;
+    std::vector<FILE *> m_files;
+};
+
+}
+
+#endif /* RING_PCAP_H */
@@ -0,0 +1,275 @@
+#include "run-cache.h"
+
+#include "ns3/core-module.h"
+#include "ns3/log.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+NS_LOG_COMPONENT_DEFINE ("RunCache");
+
+namespace ns3 {
+
+static const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+static const uint64_t FNV_PRIME = 1099511628211ULL;
+
+static uint64_t
+fnv1a (uint64_t hash, const void *data, size_t len)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= p[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+static uint64_t
+fnv1a_string (uint64_t hash, std::string s)
+{
+    /* Include the terminator so "ab","c" and "a","bc" differ. */
+    return fnv1a(hash, s.c_str(), s.size() + 1);
+}
+
+/* Hash the contents of path; false, with the hash unchanged, if it can not be read. */
+static bool
+fnv1a_file (uint64_t &hash, std::string path)
+{
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f) {
+        return false;
+    }
+    char buf[1 << 16];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        hash = fnv1a(hash, buf, n);
+    }
+    fclose(f);
+    return true;
+}
+
+/* What DCE may load into a run, looked up on DCE_PATH and LD_LIBRARY_PATH as DCE does. */
+static const char *dceFiles[] = {
+    "liblinux.so", "cfg-agent", "ip", "iperf", "mpdd", "ping", "xtables-multi", 0
+};
+
+/*
+ * Hash the path, size and modification time of every shared library mapped
+ * into this process, so rebuilding ns-3 or DCE without relinking the
+ * scenario still changes the key. Contents would be exact but these
+ * libraries run to hundreds of megabytes in debug builds.
+ */
+static bool
+fnv1a_libraries (uint64_t &hash)
+{
+    std::ifstream maps ("/proc/self/maps");
+    if (!maps.is_open()) {
+        return false;
+    }
+    /* Sorted, as the mapping order and addresses change from run to run */
+    std::set<std::string> libraries;
+    std::string line;
+    while (std::getline(maps, line)) {
+        std::string::size_type path = line.find('/');
+        if (path != std::string::npos && line.find(".so", path) != std::string::npos) {
+            libraries.insert(line.substr(path));
+        }
+    }
+    for (std::set<std::string>::const_iterator it = libraries.begin(); it != libraries.end(); ++it) {
+        struct stat st;
+        hash = fnv1a_string(hash, *it);
+        if (stat(it->c_str(), &st) == 0) {
+            int64_t size = st.st_size;
+            int64_t mtime = st.st_mtime;
+            hash = fnv1a(hash, &size, sizeof(size));
+            hash = fnv1a(hash, &mtime, sizeof(mtime));
+        }
+    }
+    return true;
+}
+
+static std::string
+shell_quote (std::string s)
+{
+    std::string out = "'";
+    for (std::string::size_type i = 0; i < s.size(); i++) {
+        if (s[i] == '\'') {
+            out += "'\\''";
+        } else {
+            out += s[i];
+        }
+    }
+    return out + "'";
+}
+
+static bool
+run_shell (std::string cmd)
+{
+    NS_LOG_DEBUG (cmd);
+    return system(cmd.c_str()) == 0;
+}
+
+RunCache::RunCache ()
+    : m_key (FNV_OFFSET)
+{
+    m_outputs.push_back("files-*");
+    m_outputs.push_back("*.pcap");
+    m_outputs.push_back("*.pcapng");
+}
+
+void
+RunCache::Configure (std::string dir, int argc, char *argv[])
+{
+    m_dir = dir;
+    if (!IsEnabled()) {
+        return;
+    }
+
+    uint64_t hash = FNV_OFFSET;
+
+    /* argv[0] depends on how the binary was started, the binary itself is hashed below. */
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--cache=", 8) == 0) {
+            continue;
+        }
+        hash = fnv1a_string(hash, argv[i]);
+    }
+
+    if (!fnv1a_file(hash, "/proc/self/exe")) {
+        NS_FATAL_ERROR ("Could not read /proc/self/exe to identify the build");
+    }
+    if (!fnv1a_libraries(hash)) {
+        NS_FATAL_ERROR ("Could not read /proc/self/maps to identify the ns-3 and DCE libraries");
+    }
+
+    /* The first of each found on the search path, or a marker that it was not found */
+    const char *dcePath = getenv("DCE_PATH");
+    const char *libraryPath = getenv("LD_LIBRARY_PATH");
+    std::string path = std::string (dcePath ? dcePath : "") + ":" + (libraryPath ? libraryPath : "");
+    for (const char **file = dceFiles; *file; file++) {
+        bool found = false;
+        std::stringstream dirs (path);
+        std::string dir;
+        while (!found && std::getline(dirs, dir, ':')) {
+            if (!dir.empty()) {
+                found = fnv1a_file(hash, dir + "/" + *file);
+            }
+        }
+        hash = fnv1a_string(hash, std::string (*file) + (found ? "" : " missing"));
+    }
+
+    uint32_t seed = RngSeedManager::GetSeed();
+    uint64_t run = RngSeedManager::GetRun();
+    hash = fnv1a(hash, &seed, sizeof(seed));
+    hash = fnv1a(hash, &run, sizeof(run));
+
+    const char *globals = getenv("NS_GLOBAL_VALUE");
+    hash = fnv1a_string(hash, globals ? globals : "");
+    const char *defaults = getenv("NS_ATTRIBUTE_DEFAULT");
+    hash = fnv1a_string(hash, defaults ? defaults : "");
+
+    m_key = hash;
+}
+
+void
+RunCache::AddInput (std::string file)
+{
+    if (!IsEnabled() || file.empty()) {
+        return;
+    }
+    if (!fnv1a_file(m_key, file)) {
+        NS_FATAL_ERROR ("Could not read " << file << ", an input of this run");
+    }
+    m_key = fnv1a_string(m_key, file);
+}
+
+void
+RunCache::AddOutput (std::string pattern)
+{
+    m_outputs.push_back(pattern);
+}
+
+bool
+RunCache::IsEnabled (void) const
+{
+    return !m_dir.empty();
+}
+
+std::string
+RunCache::GetKey (void) const
+{
+    char key[17];
+    snprintf(key, sizeof(key), "%016llx", (unsigned long long)m_key);
+    return key;
+}
+
+std::string
+RunCache::GetEntry (void) const
+{
+    return m_dir + "/" + GetKey();
+}
+
+bool
+RunCache::Restore (void) const
+{
+    if (!IsEnabled()) {
+        return false;
+    }
+
+    /* Entries only appear, by rename, once they are complete. */
+    struct stat st;
+    if (stat(GetEntry().c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+        std::cout << "cache: miss " << GetKey() << "\n";
+        return false;
+    }
+
+    if (!run_shell("cp -a " + shell_quote(GetEntry()) + "/. .")) {
+        NS_LOG_WARN ("Could not restore cache entry " << GetEntry() << ", running instead");
+        return false;
+    }
+    std::cout << "cache: hit " << GetKey() << ", restored results from " << GetEntry() << "\n";
+    return true;
+}
+
+void
+RunCache::Store (void) const
+{
+    if (!IsEnabled()) {
+        return;
+    }
+
+    std::stringstream tmp;
+    tmp << GetEntry() << ".tmp." << getpid();
+
+    if (!run_shell("mkdir -p " + shell_quote(tmp.str()))) {
+        NS_LOG_WARN ("Could not create cache entry " << tmp.str());
+        return;
+    }
+
+    /* Patterns are left unquoted so the shell expands them; no match is not an error. */
+    std::string cmd;
+    for (std::vector<std::string>::const_iterator it = m_outputs.begin(); it != m_outputs.end(); ++it) {
+        cmd += "for f in " + *it + "; do if [ -e \"$f\" ]; then cp -a \"$f\" " + shell_quote(tmp.str()) + "/ || exit 1; fi; done; ";
+    }
+    if (!run_shell(cmd + "true")) {
+        NS_LOG_WARN ("Could not copy results into " << tmp.str());
+        run_shell("rm -rf " + shell_quote(tmp.str()));
+        return;
+    }
+
+    /* Another run may have stored the same key meanwhile; either copy will do. */
+    if (rename(tmp.str().c_str(), GetEntry().c_str()) != 0) {
+        run_shell("rm -rf " + shell_quote(tmp.str()));
+        return;
+    }
+    std::cout << "cache: stored " << GetKey() << "\n";
+}
+
+}
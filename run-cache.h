@@ -0,0 +1,61 @@
+#ifndef RUN_CACHE_H
+#define RUN_CACHE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * Result cache for whole scenario runs, keyed on everything that decides
+ * what a run produces: the command line (minus --cache), the contents of
+ * the scenario binary and of the DCE programs and liblinux.so it may
+ * load, the path, size and modification time of the ns-3, DCE and other
+ * shared libraries it runs with, the RNG seed and run number,
+ * NS_GLOBAL_VALUE and NS_ATTRIBUTE_DEFAULT, and any input files given to
+ * AddInput.
+ *
+ * After a run completes, Store copies its outputs (files-* and pcaps by
+ * default) into <dir>/<key>/. Restore copies them back into the working
+ * directory, so a scenario can return before building anything:
+ *
+ *   cache.Configure (cacheDir, argc, argv);
+ *   if (cache.Restore ()) return 0;
+ *   ...
+ *   Simulator::Destroy ();
+ *   cache.Store ();
+ *
+ * An empty directory disables the cache.
+ */
+class RunCache
+{
+public:
+    RunCache ();
+
+    /* Call after CommandLine::Parse, so argv and the seed are final. */
+    void Configure (std::string dir, int argc, char *argv[]);
+    /* A file the run reads, e.g. a trace; call after Configure, before Restore. */
+    void AddInput (std::string file);
+    /* Extra shell glob, relative to the working directory, to cache. */
+    void AddOutput (std::string pattern);
+
+    bool IsEnabled (void) const;
+    std::string GetKey (void) const;
+
+    /* Copy a completed result for this key into the working directory. */
+    bool Restore (void) const;
+    /* Save this run's outputs; call after Simulator::Destroy. */
+    void Store (void) const;
+
+private:
+    std::string GetEntry (void) const;
+
+    std::string m_dir;
+    uint64_t m_key;
+    std::vector<std::string> m_outputs;
+};
+
+}
+
+#endif /* RUN_CACHE_H */
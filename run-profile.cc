@@ -0,0 +1,150 @@
+#include "run-profile.h"
+#include "counting-scheduler.h"
+
+#include "ns3/object-factory.h"
+#include "ns3/boolean.h"
+#include "ns3/string.h"
+#include "ns3/fatal-error.h"
+#include "ns3/config.h"
+#include "ns3/simulator.h"
+#include "ns3/log.h"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+#include <sys/resource.h>
+#include <sys/time.h>
+
+NS_LOG_COMPONENT_DEFINE ("RunProfile");
+
+namespace ns3 {
+
+RunProfile::RunProfile (std::string program)
+    : m_program (program),
+      m_scheduler ("map"),
+      m_schedulerStats (false),
+      m_start (Now()),
+      m_phaseStart (m_start),
+      m_simulated (Seconds (0)),
+      m_phaseEvents (0),
+      m_phase ("build"),
+      m_nProcesses (0)
+{
+}
+
+double
+RunProfile::Now (void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, 0);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+void
+RunProfile::AddOptions (CommandLine &cmd)
+{
+    cmd.AddValue("scheduler", "Event scheduler: map, heap, calendar or list", m_scheduler);
+    cmd.AddValue("schedulerStats", "Report the event queue depth and the cost of inserts and removals", m_schedulerStats);
+}
+
+void
+RunProfile::Install (void)
+{
+    std::string type;
+    if (m_scheduler == "map") {
+        type = "ns3::MapScheduler";
+    } else if (m_scheduler == "heap") {
+        type = "ns3::HeapScheduler";
+    } else if (m_scheduler == "calendar") {
+        type = "ns3::CalendarScheduler";
+    } else if (m_scheduler == "list") {
+        type = "ns3::ListScheduler";
+    } else {
+        NS_FATAL_ERROR ("Unknown scheduler " << m_scheduler << ", expected map, heap, calendar or list");
+    }
+
+    ObjectFactory factory;
+    factory.SetTypeId("ns3::CountingScheduler");
+    factory.Set("Scheduler", StringValue (type));
+    factory.Set("Timing", BooleanValue (m_schedulerStats));
+    Simulator::SetScheduler(factory);
+}
+
+void
+RunProfile::Phase (std::string name)
+{
+    double now = Now();
+    uint64_t events = CountingScheduler::GetNEvents();
+    m_simulated = std::max(m_simulated, Simulator::Now());
+
+    Timing t;
+    t.name = m_phase;
+    t.wall = now - m_phaseStart;
+    t.events = events - m_phaseEvents;
+    m_timings.push_back(t);
+    NS_LOG_INFO (m_phase << ": " << t.wall << "s, " << t.events << " events");
+
+    m_phase = name;
+    m_phaseStart = now;
+    m_phaseEvents = events;
+}
+
+void
+RunProfile::PhaseAt (Time at, std::string name)
+{
+    Simulator::Schedule(at, &RunProfile::Phase, this, name);
+}
+
+void
+RunProfile::CountProcesses (void)
+{
+    Config::Connect("/NodeList/*/ApplicationList/*/$ns3::DceApplication/ProcessStarted",
+                    MakeCallback (&RunProfile::ProcessStarted, this));
+}
+
+void
+RunProfile::ProcessStarted (std::string context, uint16_t pid)
+{
+    m_nProcesses++;
+}
+
+void
+RunProfile::Report (void)
+{
+    Phase("");
+
+    double wall = Now() - m_start;
+    double eventWall = 0;
+    uint64_t events = 0;
+    std::ostringstream phases;
+    for (std::vector<Timing>::const_iterator it = m_timings.begin(); it != m_timings.end(); ++it) {
+        phases << " " << it->name << "_s=" << it->wall;
+        if (it->events > 0) {
+            eventWall += it->wall;
+            events += it->events;
+        }
+    }
+
+    /* ru_maxrss is in kilobytes on Linux */
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    std::cout << "PERF program=" << m_program << " scheduler=" << m_scheduler
+              << " wall_s=" << wall << phases.str()
+              << " sim_s=" << m_simulated.GetSeconds()
+              << " events=" << events
+              << " events_per_s=" << (eventWall > 0 ? (uint64_t)(events / eventWall) : 0)
+              << " processes=" << m_nProcesses
+              << " peak_rss_kb=" << usage.ru_maxrss;
+    if (m_schedulerStats) {
+        const CountingScheduler::Stats &stats = CountingScheduler::GetStats();
+        std::cout << " queue_max=" << stats.maxDepth
+                  << " queue_mean=" << (stats.inserts > 0 ? stats.depthSum / stats.inserts : 0)
+                  << " insert_ns=" << (stats.inserts > 0 ? stats.insertNs / stats.inserts : 0)
+                  << " remove_ns=" << (stats.removes > 0 ? stats.removeNs / stats.removes : 0);
+    }
+    std::cout << std::endl;
+}
+
+}
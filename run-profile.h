@@ -0,0 +1,75 @@
+#ifndef RUN_PROFILE_H
+#define RUN_PROFILE_H
+
+#include "ns3/nstime.h"
+#include "ns3/command-line.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * Where the wall clock time of a scenario run goes, printed as one line
+ * at exit so runs can be compared:
+ *
+ *   PERF program=<name> scheduler=<name> wall_s=<total> <phase>_s=<wall> ...
+ *        sim_s=<simulated> events=<n> events_per_s=<n> processes=<n> peak_rss_kb=<n>
+ *        [queue_max=<n> queue_mean=<n> insert_ns=<n> remove_ns=<n>]
+ *
+ * Phases follow each other: Phase ends the current one and starts the
+ * next, either right away (in main, e.g. "build" and "destroy") or at a
+ * simulation time (PhaseAt, e.g. "configure" at 0 and "traffic" once the
+ * applications start). Events are counted by CountingScheduler, which
+ * Install makes the simulator's scheduler, passing the work on to the
+ * one chosen with --scheduler; events_per_s is over the phases that ran
+ * events. With --schedulerStats the line ends with the event queue depth
+ * and the mean cost per insert and removal.
+ */
+class RunProfile
+{
+public:
+    /* Starts the clock and the first phase, "build". */
+    RunProfile (std::string program);
+
+    /* --scheduler=map|heap|calendar|list and --schedulerStats */
+    void AddOptions (CommandLine &cmd);
+
+    /* Count events on the chosen scheduler; call after parsing, before anything is scheduled. */
+    void Install (void);
+
+    void Phase (std::string name);
+    void PhaseAt (Time at, std::string name);
+
+    /* Count the DCE processes of the applications installed so far. */
+    void CountProcesses (void);
+
+    /* End the last phase and print the PERF line. */
+    void Report (void);
+
+private:
+    struct Timing {
+        std::string name;
+        double wall;
+        uint64_t events;
+    };
+
+    static double Now (void);
+    void ProcessStarted (std::string context, uint16_t pid);
+
+    std::string m_program;
+    std::string m_scheduler;
+    bool m_schedulerStats;
+    double m_start;
+    double m_phaseStart;
+    Time m_simulated;
+    uint64_t m_phaseEvents;
+    std::string m_phase;
+    std::vector<Timing> m_timings;
+    uint32_t m_nProcesses;
+};
+
+}
+
+#endif /* RUN_PROFILE_H */
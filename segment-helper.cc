@@ -0,0 +1,74 @@
+#include "segment-helper.h"
+#include "broadcast-channel.h"
+
+#include "ns3/mac48-address.h"
+#include "ns3/trace-helper.h"
+#include "ns3/log.h"
+#include "ns3/fatal-error.h"
+
+NS_LOG_COMPONENT_DEFINE ("SegmentHelper");
+
+namespace ns3 {
+
+SegmentHelper::SegmentHelper (std::string type)
+    : m_broadcast (type == "broadcast")
+{
+    if (type != "csma" && type != "broadcast") {
+        NS_FATAL_ERROR ("Unknown segment " << type << ", expected csma or broadcast");
+    }
+    m_channelFactory.SetTypeId("ns3::BroadcastChannel");
+    m_deviceFactory.SetTypeId("ns3::BroadcastNetDevice");
+}
+
+void
+SegmentHelper::SetChannelAttribute (std::string name, const AttributeValue &value)
+{
+    m_csma.SetChannelAttribute(name, value);
+    m_channelFactory.Set(name, value);
+}
+
+NetDeviceContainer
+SegmentHelper::Install (const NodeContainer &nodes)
+{
+    if (!m_broadcast) {
+        return m_csma.Install(nodes);
+    }
+
+    Ptr<BroadcastChannel> channel = m_channelFactory.Create<BroadcastChannel> ();
+    NetDeviceContainer devices;
+    for (NodeContainer::Iterator it = nodes.Begin(); it != nodes.End(); ++it) {
+        Ptr<BroadcastNetDevice> device = m_deviceFactory.Create<BroadcastNetDevice> ();
+        device->SetAddress(Mac48Address::Allocate());
+        (*it)->AddDevice(device);
+        device->Attach(channel);
+        devices.Add(device);
+    }
+    NS_LOG_DEBUG ("broadcast segment of " << nodes.GetN() << " devices");
+    return devices;
+}
+
+void
+SegmentHelper::EnablePcap (std::string prefix, NetDeviceContainer devices, bool promiscuous)
+{
+    if (!m_broadcast) {
+        m_csma.EnablePcap(prefix, devices, promiscuous);
+        return;
+    }
+
+    /* What CsmaHelper does, on the same trace sources */
+    PcapHelper pcapHelper;
+    for (NetDeviceContainer::Iterator it = devices.Begin(); it != devices.End(); ++it) {
+        Ptr<BroadcastNetDevice> device = DynamicCast<BroadcastNetDevice> (*it);
+        std::string file = pcapHelper.GetFilenameFromDevice(prefix, device);
+        Ptr<PcapFileWrapper> wrapper = pcapHelper.CreateFile(file, std::ios::out, PcapHelper::DLT_EN10MB);
+        pcapHelper.HookDefaultSink<BroadcastNetDevice> (device, promiscuous ? "PromiscSniffer" : "Sniffer", wrapper);
+    }
+}
+
+bool
+SegmentHelper::IsBroadcast (void) const
+{
+    return m_broadcast;
+}
+
+}
@@ -0,0 +1,44 @@
+#ifndef SEGMENT_HELPER_H
+#define SEGMENT_HELPER_H
+
+#include "ns3/node-container.h"
+#include "ns3/net-device-container.h"
+#include "ns3/object-factory.h"
+#include "ns3/csma-helper.h"
+
+#include <string>
+
+namespace ns3 {
+
+/**
+ * Builds the shared segments of a tree either as CSMA channels or as
+ * BroadcastChannels (broadcast-channel.h), chosen by name so scenarios
+ * can take it from the command line. Both take the "DataRate" and
+ * "Delay" channel attributes, and their devices are both named sim<i>
+ * in the kernel and carry Ethernet frames.
+ */
+class SegmentHelper
+{
+public:
+    /* "csma" or "broadcast" */
+    SegmentHelper (std::string type);
+
+    void SetChannelAttribute (std::string name, const AttributeValue &value);
+
+    /* One segment joining nodes; devices in the order of nodes. */
+    NetDeviceContainer Install (const NodeContainer &nodes);
+
+    void EnablePcap (std::string prefix, NetDeviceContainer devices, bool promiscuous);
+
+    bool IsBroadcast (void) const;
+
+private:
+    bool m_broadcast;
+    CsmaHelper m_csma;
+    ObjectFactory m_channelFactory;
+    ObjectFactory m_deviceFactory;
+};
+
+}
+
+#endif /* SEGMENT_HELPER_H */
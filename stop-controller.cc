@@ -0,0 +1,246 @@
+#include "stop-controller.h"
+
+#include "ns3/dce-application.h"
+#include "ns3/dce-manager.h"
+#include "ns3/node.h"
+#include "ns3/simulator.h"
+#include "ns3/log.h"
+#include "ns3/fatal-error.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+NS_LOG_COMPONENT_DEFINE ("StopController");
+
+namespace ns3 {
+
+StopController::StopController (Time horizon)
+    : m_horizon (horizon),
+      m_grace (Seconds (1)),
+      m_installed (false),
+      m_stoppedAt (Seconds (0))
+{
+}
+
+void
+StopController::SetGrace (Time grace)
+{
+    m_grace = grace;
+}
+
+void
+StopController::AddWorkload (ApplicationContainer apps, std::string name)
+{
+    Workload w;
+    w.name = name;
+    w.nApps = 0;
+    w.nExited = 0;
+    w.doneAt = Seconds (-1);
+    m_workloads.push_back(w);
+    uint32_t index = m_workloads.size() - 1;
+
+    for (ApplicationContainer::Iterator it = apps.Begin(); it != apps.End(); ++it) {
+        Ptr<DceApplication> app = DynamicCast<DceApplication> (*it);
+        if (!app) {
+            NS_FATAL_ERROR ("Workload " << name << ": only DCE applications report their exit");
+        }
+        Ptr<Node> node = app->GetNode();
+        uint32_t nodeId = node->GetId();
+
+        /* The context carries the node and the workload into ProcessStarted. */
+        std::ostringstream context;
+        context << nodeId << " " << index;
+        app->TraceConnect("ProcessStarted", context.str(),
+                          MakeCallback (&StopController::ProcessStarted, this));
+
+        if (!m_exitConnected[nodeId]) {
+            std::ostringstream nodeContext;
+            nodeContext << nodeId;
+            node->GetObject<DceManager> ()->TraceConnect("Exit", nodeContext.str(),
+                    MakeCallback (&StopController::ProcessExited, this));
+            m_exitConnected[nodeId] = true;
+        }
+        m_workloads[index].nApps++;
+    }
+
+    /* Nothing to wait for, e.g. no ping sources in this topology */
+    if (m_workloads[index].nApps == 0) {
+        m_workloads[index].doneAt = Seconds (0);
+    }
+    NS_LOG_DEBUG ("workload " << name << ": " << m_workloads[index].nApps << " applications");
+}
+
+void
+StopController::AddDeadline (Time at, std::string name)
+{
+    Workload w;
+    w.name = name;
+    w.nApps = 0;
+    w.nExited = 0;
+    w.doneAt = Seconds (-1);
+    m_workloads.push_back(w);
+    Simulator::Schedule(at, &StopController::Deadline, this, m_workloads.size() - 1);
+}
+
+void
+StopController::AddQuiescence (NetDeviceContainer devices, std::string name, Time notBefore,
+                               Time interval, uint32_t threshold, uint32_t windows)
+{
+    Quiescence q;
+    q.name = name;
+    q.interval = interval;
+    q.threshold = threshold;
+    q.windows = windows > 0 ? windows : 1;
+    q.count = 0;
+    q.quiet = 0;
+    q.doneAt = Seconds (-1);
+    m_quiescence.push_back(q);
+    uint32_t index = m_quiescence.size() - 1;
+
+    for (NetDeviceContainer::Iterator it = devices.Begin(); it != devices.End(); ++it) {
+        if (m_deviceQuiescence.find(*it) != m_deviceQuiescence.end()) {
+            NS_FATAL_ERROR ("Device already watched by " << m_quiescence[m_deviceQuiescence[*it]].name);
+        }
+        m_deviceQuiescence[*it] = index;
+        (*it)->GetNode()->RegisterProtocolHandler(MakeCallback (&StopController::Sniff, this),
+                                                  0, *it, true);
+    }
+
+    Simulator::Schedule(notBefore + interval, &StopController::CheckQuiet, this, index);
+}
+
+void
+StopController::Install (void)
+{
+    if (m_installed) {
+        NS_FATAL_ERROR ("StopController installed twice");
+    }
+    m_installed = true;
+    m_stop = Simulator::Schedule(m_horizon, &StopController::Stop, this);
+}
+
+void
+StopController::Deadline (uint32_t index)
+{
+    m_workloads[index].doneAt = Simulator::Now();
+    CheckDone();
+}
+
+void
+StopController::ProcessStarted (std::string context, uint16_t pid)
+{
+    std::istringstream in (context);
+    uint32_t nodeId, index;
+    in >> nodeId >> index;
+    m_running[std::make_pair(nodeId, pid)] = index;
+}
+
+void
+StopController::ProcessExited (std::string context, uint16_t pid, int status)
+{
+    uint32_t nodeId = atoi(context.c_str());
+    std::map<std::pair<uint32_t, uint16_t>, uint32_t>::iterator it =
+        m_running.find(std::make_pair(nodeId, pid));
+    if (it == m_running.end()) {
+        /* Some other process on the same node. */
+        return;
+    }
+
+    Workload &w = m_workloads[it->second];
+    m_running.erase(it);
+    w.nExited++;
+    NS_LOG_DEBUG (w.name << ": node " << nodeId << " pid " << pid << " exited with " << status
+                  << ", " << w.nExited << "/" << w.nApps);
+
+    if (w.nExited == w.nApps) {
+        w.doneAt = Simulator::Now();
+        CheckDone();
+    }
+}
+
+void
+StopController::Sniff (Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol,
+                       const Address &from, const Address &to, NetDevice::PacketType type)
+{
+    m_quiescence[m_deviceQuiescence[device]].count++;
+}
+
+void
+StopController::CheckQuiet (uint32_t index)
+{
+    Quiescence &q = m_quiescence[index];
+
+    if (q.count <= q.threshold) {
+        q.quiet++;
+    } else {
+        q.quiet = 0;
+    }
+    NS_LOG_DEBUG (q.name << ": " << q.count << " packets, quiet for " << q.quiet << "/" << q.windows);
+    q.count = 0;
+
+    if (q.quiet >= q.windows) {
+        /* When it went quiet, not when that was confirmed. */
+        q.doneAt = Simulator::Now() - Seconds (q.interval.GetSeconds() * q.windows);
+        CheckDone();
+        return;
+    }
+    Simulator::Schedule(q.interval, &StopController::CheckQuiet, this, index);
+}
+
+void
+StopController::CheckDone (void)
+{
+    for (std::vector<Workload>::const_iterator it = m_workloads.begin(); it != m_workloads.end(); ++it) {
+        if (it->doneAt < Seconds (0)) {
+            return;
+        }
+    }
+    for (std::vector<Quiescence>::const_iterator it = m_quiescence.begin(); it != m_quiescence.end(); ++it) {
+        if (it->doneAt < Seconds (0)) {
+            return;
+        }
+    }
+
+    if (Simulator::Now() + m_grace < m_horizon) {
+        m_stop.Cancel();
+        m_stop = Simulator::Schedule(m_grace, &StopController::Stop, this);
+    }
+}
+
+void
+StopController::Stop (void)
+{
+    m_stoppedAt = Simulator::Now();
+    Simulator::Stop();
+}
+
+void
+StopController::Report (void) const
+{
+    if (m_stoppedAt < m_horizon) {
+        std::cout << "STOP: complete at " << m_stoppedAt.GetSeconds() << "s (horizon "
+                  << m_horizon.GetSeconds() << "s)" << std::endl;
+    } else {
+        std::cout << "STOP: horizon " << m_horizon.GetSeconds() << "s reached" << std::endl;
+    }
+
+    for (std::vector<Workload>::const_iterator it = m_workloads.begin(); it != m_workloads.end(); ++it) {
+        if (it->doneAt < Seconds (0)) {
+            std::cout << "  " << it->name << ": pending, " << it->nExited << "/"
+                      << it->nApps << " exited" << std::endl;
+        } else {
+            std::cout << "  " << it->name << ": done at " << it->doneAt.GetSeconds() << "s" << std::endl;
+        }
+    }
+    for (std::vector<Quiescence>::const_iterator it = m_quiescence.begin(); it != m_quiescence.end(); ++it) {
+        if (it->doneAt < Seconds (0)) {
+            std::cout << "  " << it->name << ": pending, still above "
+                      << it->threshold << " packets per " << it->interval.GetSeconds() << "s" << std::endl;
+        } else {
+            std::cout << "  " << it->name << ": quiet from " << it->doneAt.GetSeconds() << "s" << std::endl;
+        }
+    }
+}
+
+}
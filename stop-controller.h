@@ -0,0 +1,105 @@
+#ifndef STOP_CONTROLLER_H
+#define STOP_CONTROLLER_H
+
+#include "ns3/application-container.h"
+#include "ns3/net-device-container.h"
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+#include "ns3/net-device.h"
+#include "ns3/packet.h"
+#include "ns3/address.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * Stops the simulation as soon as everything it was run for is done,
+ * instead of at a fixed time.
+ *
+ * Two kinds of completion are tracked:
+ *  - workloads: DCE applications (iperf clients, pings with -c, ...) are
+ *    done once every one of their processes has exited;
+ *  - quiescence: a set of devices, e.g. an MPDD dissemination tree, is
+ *    done once it has carried at most a threshold number of packets per
+ *    interval for a number of intervals in a row.
+ *
+ * Once all of them are done the simulation stops after a short grace
+ * period. The horizon is kept as a safety cap, so nothing ever runs
+ * longer than it did with a plain Simulator::Stop.
+ */
+class StopController
+{
+public:
+    StopController (Time horizon);
+
+    /* Time to keep running after the last completion, e.g. for iperf servers to log. */
+    void SetGrace (Time grace);
+
+    /* Done once every process started by apps has exited. */
+    void AddWorkload (ApplicationContainer apps, std::string name);
+    /* Done at a fixed time, for applications that stop on their own (e.g. BulkSender). */
+    void AddDeadline (Time at, std::string name);
+
+    /**
+     * Done once devices receive at most threshold packets (all of them
+     * together) in each of windows consecutive intervals, counting from
+     * notBefore.
+     */
+    void AddQuiescence (NetDeviceContainer devices, std::string name, Time notBefore,
+                        Time interval = Seconds (1), uint32_t threshold = 0,
+                        uint32_t windows = 3);
+
+    /* Schedule the horizon; call once, after the Add calls, before Simulator::Run. */
+    void Install (void);
+
+    /* Print when and why the run stopped; call after Simulator::Run. */
+    void Report (void) const;
+
+private:
+    struct Workload {
+        std::string name;
+        uint32_t nApps;
+        uint32_t nExited;
+        Time doneAt;
+    };
+    struct Quiescence {
+        std::string name;
+        Time interval;
+        uint32_t threshold;
+        uint32_t windows;
+        uint32_t count;
+        uint32_t quiet;
+        Time doneAt;
+    };
+
+    void Deadline (uint32_t index);
+    void ProcessStarted (std::string context, uint16_t pid);
+    void ProcessExited (std::string context, uint16_t pid, int status);
+    void Sniff (Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol,
+                const Address &from, const Address &to, NetDevice::PacketType type);
+    void CheckQuiet (uint32_t index);
+    void CheckDone (void);
+    void Stop (void);
+
+    Time m_horizon;
+    Time m_grace;
+    bool m_installed;
+    Time m_stoppedAt;
+    EventId m_stop;
+
+    std::vector<Workload> m_workloads;
+    std::vector<Quiescence> m_quiescence;
+
+    /* (node id, pid) of running workload processes, to their workload. */
+    std::map<std::pair<uint32_t, uint16_t>, uint32_t> m_running;
+    /* Nodes whose DceManager "Exit" trace is connected. */
+    std::map<uint32_t, bool> m_exitConnected;
+    std::map<Ptr<NetDevice>, uint32_t> m_deviceQuiescence;
+};
+
+}
+
+#endif /* STOP_CONTROLLER_H */
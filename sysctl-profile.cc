@@ -0,0 +1,162 @@
+#include "sysctl-profile.h"
+
+#include "ns3/linux-socket-fd-factory.h"
+#include "ns3/simulator.h"
+#include "ns3/log.h"
+#include "ns3/fatal-error.h"
+
+#include <iostream>
+
+NS_LOG_COMPONENT_DEFINE ("SysctlProfile");
+
+namespace ns3 {
+
+SysctlProfile::SysctlProfile (std::string name)
+    : m_name (name)
+{
+}
+
+SysctlProfile
+SysctlProfile::Lookup (std::string name)
+{
+    SysctlProfile p (name);
+
+    if (name == "router") {
+        p.Set(".net.ipv4.conf.all.forwarding", "1");
+        p.Set(".net.ipv6.conf.all.disable_ipv6", "1");
+    } else if (name == "high-bdp-tcp") {
+        p.Set(".net.ipv4.tcp_low_latency", "1");
+        p.Set(".net.ipv4.tcp_no_metrics_save", "1");
+        p.Set(".net.ipv4.tcp_timestamps", "1");
+        p.Set(".net.ipv4.tcp_sack", "1");
+        p.Set(".net.ipv4.tcp_mem", "768174 10242330 15363480");
+        p.Set(".net.ipv4.tcp_rmem", "4096 524288 204217728");
+        p.Set(".net.ipv4.tcp_wmem", "4096 524288 204217728");
+        p.Set(".net.core.wmem_max", "5242870");
+        p.Set(".net.core.rmem_max", "5242870");
+        p.Set(".net.core.optmem_max", "5242870");
+        p.Set(".net.core.netdev_max_backlog", "25000000");
+    } else if (name == "tcp") {
+        p.Set(".net.mptcp.mptcp_enabled", "0");
+    } else if (name == "mptcp-fullmesh") {
+        p.Set(".net.mptcp.mptcp_enabled", "1");
+        p.Set(".net.mptcp.mptcp_path_manager", "fullmesh");
+    } else if (name == "mptcp-ndiffports") {
+        p.Set(".net.mptcp.mptcp_enabled", "1");
+        p.Set(".net.mptcp.mptcp_path_manager", "ndiffports");
+    } else {
+        NS_FATAL_ERROR ("Unknown sysctl profile \"" << name << "\"");
+    }
+
+    return p;
+}
+
+SysctlProfile &
+SysctlProfile::Set (std::string key, std::string value)
+{
+    /* LinuxSocketFdFactory::Set wants ".a.b.c"; catch "net/ipv4/x" and typos here, not mid-run. */
+    if (key.size() < 2 || key[0] != '.'
+        || key.find_first_not_of("abcdefghijklmnopqrstuvwxyz0123456789_.-") != std::string::npos) {
+        NS_FATAL_ERROR ("Invalid sysctl key \"" << key << "\" in profile " << m_name);
+    }
+    if (value.empty()) {
+        NS_FATAL_ERROR ("Empty value for sysctl " << key << " in profile " << m_name);
+    }
+
+    for (Entries::iterator it = m_entries.begin(); it != m_entries.end(); ++it) {
+        if (it->first == key) {
+            it->second = value;
+            return *this;
+        }
+    }
+    m_entries.push_back(std::make_pair(key, value));
+    return *this;
+}
+
+SysctlProfile &
+SysctlProfile::Add (const SysctlProfile &other)
+{
+    for (Entries::const_iterator it = other.m_entries.begin(); it != other.m_entries.end(); ++it) {
+        Set(it->first, it->second);
+    }
+    m_name += "+" + other.m_name;
+    return *this;
+}
+
+std::string
+SysctlProfile::GetName (void) const
+{
+    return m_name;
+}
+
+const SysctlProfile::Entries &
+SysctlProfile::GetEntries (void) const
+{
+    return m_entries;
+}
+
+std::vector<std::string>
+SysctlProfile::GetKeys (void) const
+{
+    std::vector<std::string> keys;
+    for (Entries::const_iterator it = m_entries.begin(); it != m_entries.end(); ++it) {
+        keys.push_back(it->first);
+    }
+    return keys;
+}
+
+Ptr<LinuxSocketFdFactory>
+SysctlProfile::GetStack (Ptr<Node> node)
+{
+    Ptr<LinuxSocketFdFactory> stack = node->GetObject<LinuxSocketFdFactory> ();
+    if (!stack) {
+        NS_FATAL_ERROR ("Node " << node->GetId() << " has no Linux stack; install DCE first");
+    }
+    return stack;
+}
+
+void
+SysctlProfile::Apply (NodeContainer nodes, Time at) const
+{
+    for (NodeContainer::Iterator it = nodes.Begin(); it != nodes.End(); ++it) {
+        Apply(*it, at);
+    }
+}
+
+void
+SysctlProfile::Apply (Ptr<Node> node, Time at) const
+{
+    NS_LOG_DEBUG ("node " << node->GetId() << ": " << m_name << ", " << m_entries.size() << " values");
+    Simulator::ScheduleWithContext (node->GetId(), at, &SysctlProfile::DoApply, GetStack(node), m_entries);
+}
+
+void
+SysctlProfile::DoApply (Ptr<LinuxSocketFdFactory> stack, Entries entries)
+{
+    for (Entries::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+        stack->Set(it->first, it->second);
+    }
+}
+
+void
+SysctlProfile::Print (Ptr<Node> node, Time at) const
+{
+    Print(node, at, GetKeys());
+}
+
+void
+SysctlProfile::Print (Ptr<Node> node, Time at, std::vector<std::string> keys)
+{
+    Simulator::ScheduleWithContext (node->GetId(), at, &SysctlProfile::DoPrint, GetStack(node), node->GetId(), keys);
+}
+
+void
+SysctlProfile::DoPrint (Ptr<LinuxSocketFdFactory> stack, uint32_t nodeId,
+                        std::vector<std::string> keys)
+{
+    for (std::vector<std::string>::const_iterator it = keys.begin(); it != keys.end(); ++it) {
+        std::cout << "NODE " << nodeId << ": " << *it << "=" << stack->Get(*it);
+    }
+}
+
+}
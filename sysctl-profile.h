@@ -0,0 +1,69 @@
+#ifndef SYSCTL_PROFILE_H
+#define SYSCTL_PROFILE_H
+
+#include "ns3/node.h"
+#include "ns3/node-container.h"
+#include "ns3/nstime.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ns3 {
+
+class LinuxSocketFdFactory;
+
+/**
+ * A named, ordered set of Linux sysctl values.
+ *
+ * LinuxStackHelper::SysctlSet schedules a separate event per key and
+ * node. A profile checks its keys once, when they are set, and Apply
+ * writes all of them to a node from a single event. Built in profiles:
+ *
+ *   router            IPv4 forwarding on, IPv6 off
+ *   high-bdp-tcp      large socket buffers, SACK, timestamps, low latency
+ *   tcp               MPTCP off
+ *   mptcp-fullmesh    MPTCP with the fullmesh path manager
+ *   mptcp-ndiffports  MPTCP with the ndiffports path manager
+ */
+class SysctlProfile
+{
+public:
+    typedef std::vector<std::pair<std::string, std::string> > Entries;
+
+    SysctlProfile (std::string name);
+
+    /* Built in profile by name; unknown names are fatal. */
+    static SysctlProfile Lookup (std::string name);
+
+    /* Set key (e.g. ".net.ipv4.tcp_sack") to value, replacing any earlier value. */
+    SysctlProfile &Set (std::string key, std::string value);
+    /* Set every entry of other, in order; the name becomes "this+other". */
+    SysctlProfile &Add (const SysctlProfile &other);
+
+    std::string GetName (void) const;
+    const Entries &GetEntries (void) const;
+    std::vector<std::string> GetKeys (void) const;
+
+    /* Write all entries on each node at time at, one event per node. */
+    void Apply (NodeContainer nodes, Time at = Seconds (0.1)) const;
+    void Apply (Ptr<Node> node, Time at = Seconds (0.1)) const;
+
+    /* Print the node's current values of this profile's keys at time at. */
+    void Print (Ptr<Node> node, Time at) const;
+    /* Print the node's current values of keys at time at, from a single event. */
+    static void Print (Ptr<Node> node, Time at, std::vector<std::string> keys);
+
+private:
+    static Ptr<LinuxSocketFdFactory> GetStack (Ptr<Node> node);
+    static void DoApply (Ptr<LinuxSocketFdFactory> stack, Entries entries);
+    static void DoPrint (Ptr<LinuxSocketFdFactory> stack, uint32_t nodeId,
+                         std::vector<std::string> keys);
+
+    std::string m_name;
+    Entries m_entries;
+};
+
+}
+
+#endif /* SYSCTL_PROFILE_H */
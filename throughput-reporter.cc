@@ -0,0 +1,123 @@
+#include "throughput-reporter.h"
+
+#include "ns3/packet-sink.h"
+#include "ns3/simulator.h"
+#include "ns3/log.h"
+#include "ns3/fatal-error.h"
+
+#include <cstdio>
+
+NS_LOG_COMPONENT_DEFINE ("ThroughputReporter");
+
+namespace ns3 {
+
+ThroughputReporter::ThroughputReporter (std::string file, Time interval)
+    : m_file (file),
+      m_interval (interval),
+      m_start (Seconds (0)),
+      m_last (Seconds (0))
+{
+}
+
+void
+ThroughputReporter::Watch (ApplicationContainer sinks)
+{
+    for (ApplicationContainer::Iterator it = sinks.Begin(); it != sinks.End(); ++it) {
+        Ptr<PacketSink> sink = DynamicCast<PacketSink> (*it);
+        if (!sink) {
+            NS_FATAL_ERROR ("ThroughputReporter only watches PacketSink applications");
+        }
+        sink->TraceConnectWithoutContext("Rx", MakeCallback (&ThroughputReporter::Rx, this));
+    }
+}
+
+void
+ThroughputReporter::Start (Time at)
+{
+    m_start = at;
+    m_last = at;
+    Simulator::Schedule(at + m_interval, &ThroughputReporter::Tick, this);
+}
+
+void
+ThroughputReporter::Rx (Ptr<const Packet> packet, const Address &from)
+{
+    std::map<Address, uint32_t>::iterator it = m_index.find(from);
+    if (it == m_index.end()) {
+        Connection c;
+        /* iperf numbers its first connection 3 */
+        c.id = m_connections.size() + 3;
+        c.interval = 0;
+        c.total = 0;
+        m_connections.push_back(c);
+        it = m_index.insert(std::make_pair(from, m_connections.size() - 1)).first;
+    }
+    m_connections[it->second].interval += packet->GetSize();
+    m_connections[it->second].total += packet->GetSize();
+}
+
+void
+ThroughputReporter::Tick (void)
+{
+    Time now = Simulator::Now();
+    uint64_t sum = 0;
+
+    for (std::vector<Connection>::iterator it = m_connections.begin(); it != m_connections.end(); ++it) {
+        char id[8];
+        snprintf(id, sizeof(id), "%3u", it->id);
+        Line(id, m_last, now, it->interval);
+        sum += it->interval;
+        it->interval = 0;
+    }
+    if (m_connections.size() > 1) {
+        Line("SUM", m_last, now, sum);
+    }
+
+    m_last = now;
+    Simulator::Schedule(m_interval, &ThroughputReporter::Tick, this);
+}
+
+void
+ThroughputReporter::Report (void)
+{
+    Time now = Simulator::Now();
+    uint64_t sum = 0;
+
+    for (std::vector<Connection>::const_iterator it = m_connections.begin(); it != m_connections.end(); ++it) {
+        char id[8];
+        snprintf(id, sizeof(id), "%3u", it->id);
+        Line(id, m_start, now, it->total);
+        sum += it->total;
+    }
+    if (m_connections.size() > 1) {
+        Line("SUM", m_start, now, sum);
+    }
+    m_out.flush();
+}
+
+void
+ThroughputReporter::Line (std::string id, Time from, Time to, uint64_t bytes)
+{
+    if (!m_out.is_open()) {
+        Open();
+    }
+
+    double seconds = (to - from).GetSeconds();
+    double mbits = seconds > 0 ? bytes * 8 / seconds / 1e6 : 0;
+    char line[128];
+    snprintf(line, sizeof(line), "[%s] %4.1f-%4.1f sec  %6.2f MBytes  %6.2f Mbits/sec",
+             id.c_str(), (from - m_start).GetSeconds(), (to - m_start).GetSeconds(),
+             bytes / 1048576.0, mbits);
+    m_out << line << "\n";
+}
+
+void
+ThroughputReporter::Open (void)
+{
+    m_out.open(m_file.c_str());
+    if (!m_out.is_open()) {
+        NS_FATAL_ERROR ("Could not open " << m_file);
+    }
+}
+
+}
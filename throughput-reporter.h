@@ -0,0 +1,63 @@
+#ifndef THROUGHPUT_REPORTER_H
+#define THROUGHPUT_REPORTER_H
+
+#include "ns3/application-container.h"
+#include "ns3/address.h"
+#include "ns3/packet.h"
+#include "ns3/nstime.h"
+
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * Per interval throughput of PacketSink receivers, in the layout of
+ * iperf -s -i, so native runs read like iperf ones:
+ *
+ *   [  3]  0.0- 1.0 sec  1.12 MBytes  9.38 Mbits/sec
+ *
+ * Each remote address and port is a connection with its own id; with
+ * more than one, a [SUM] line follows. Intervals count from the time
+ * given to Start. The file is opened at the first report, so a run
+ * forked before that (Replicator) gets its own.
+ */
+class ThroughputReporter
+{
+public:
+    ThroughputReporter (std::string file, Time interval);
+
+    /* Count what the PacketSink applications in sinks receive. */
+    void Watch (ApplicationContainer sinks);
+    /* Report every interval from at on. */
+    void Start (Time at);
+    /* Write the whole run totals; call after Simulator::Run. */
+    void Report (void);
+
+private:
+    struct Connection {
+        uint32_t id;
+        uint64_t interval;
+        uint64_t total;
+    };
+
+    void Rx (Ptr<const Packet> packet, const Address &from);
+    void Tick (void);
+    void Line (std::string id, Time from, Time to, uint64_t bytes);
+    void Open (void);
+
+    std::string m_file;
+    Time m_interval;
+    Time m_start;
+    Time m_last;
+    std::ofstream m_out;
+
+    std::map<Address, uint32_t> m_index;
+    std::vector<Connection> m_connections;
+};
+
+}
+
+#endif /* THROUGHPUT_REPORTER_H */
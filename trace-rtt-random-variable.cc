@@ -0,0 +1,269 @@
+#include "trace-rtt-random-variable.h"
+
+#include "ns3/log.h"
+#include "ns3/double.h"
+#include "ns3/uinteger.h"
+#include "ns3/string.h"
+#include "ns3/fatal-error.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+NS_LOG_COMPONENT_DEFINE ("TraceRttRandomVariable");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (TraceRttRandomVariable);
+
+/* Standard normal quantile, P. J. Acklam's rational approximation (rel. error < 1.2e-9). */
+static double
+normal_quantile (double p)
+{
+    static const double a[] = { -3.969683028665376e+01, 2.209460984245205e+02,
+                                -2.759285104469687e+02, 1.383577518672690e+02,
+                                -3.066479806614716e+01, 2.506628277459239e+00 };
+    static const double b[] = { -5.447609879822406e+01, 1.615858368580409e+02,
+                                -1.556989798598866e+02, 6.680131188771972e+01,
+                                -1.328068155288572e+01 };
+    static const double c[] = { -7.784894002430293e-03, -3.223964580411365e-01,
+                                -2.400758277161838e+00, -2.549732539343734e+00,
+                                4.374664141464968e+00, 2.938163982698783e+00 };
+    static const double d[] = { 7.784695709041462e-03, 3.224671290700398e-01,
+                                2.445134137142996e+00, 3.754408661907416e+00 };
+    const double low = 0.02425;
+
+    if (p < low) {
+        double q = sqrt(-2 * log(p));
+        return (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+               ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+    }
+    if (p > 1 - low) {
+        double q = sqrt(-2 * log(1 - p));
+        return -(((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+                ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+    }
+    double q = p - 0.5;
+    double r = q * q;
+    return (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q /
+           (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1);
+}
+
+TypeId
+TraceRttRandomVariable::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::TraceRttRandomVariable")
+        .SetParent<RandomVariableStream> ()
+        .AddConstructor<TraceRttRandomVariable> ()
+        .AddAttribute ("File",
+                       "RTT samples in ms, one per line; empty to fit the summary attributes.",
+                       StringValue (""),
+                       MakeStringAccessor (&TraceRttRandomVariable::m_file),
+                       MakeStringChecker ())
+        .AddAttribute ("Min", "Smallest RTT in ms, when there is no file.",
+                       DoubleValue (0),
+                       MakeDoubleAccessor (&TraceRttRandomVariable::m_min),
+                       MakeDoubleChecker<double> (0))
+        .AddAttribute ("Max", "Largest RTT in ms, when there is no file.",
+                       DoubleValue (0),
+                       MakeDoubleAccessor (&TraceRttRandomVariable::m_max),
+                       MakeDoubleChecker<double> (0))
+        .AddAttribute ("Mean", "Mean RTT in ms, when there is no file.",
+                       DoubleValue (0),
+                       MakeDoubleAccessor (&TraceRttRandomVariable::m_mean),
+                       MakeDoubleChecker<double> (0))
+        .AddAttribute ("Deviation", "Standard deviation of the RTT in ms, when there is no file.",
+                       DoubleValue (0),
+                       MakeDoubleAccessor (&TraceRttRandomVariable::m_deviation),
+                       MakeDoubleChecker<double> (0))
+        .AddAttribute ("Scale", "Factor applied to every value returned.",
+                       DoubleValue (1.0),
+                       MakeDoubleAccessor (&TraceRttRandomVariable::m_scale),
+                       MakeDoubleChecker<double> (0))
+        .AddAttribute ("TableSize", "Steps in the inverse CDF table.",
+                       UintegerValue (4096),
+                       MakeUintegerAccessor (&TraceRttRandomVariable::m_tableSize),
+                       MakeUintegerChecker<uint32_t> (2))
+        .AddAttribute ("BatchSize", "Values generated per refill.",
+                       UintegerValue (1024),
+                       MakeUintegerAccessor (&TraceRttRandomVariable::m_batchSize),
+                       MakeUintegerChecker<uint32_t> (1))
+        ;
+    return tid;
+}
+
+TraceRttRandomVariable::TraceRttRandomVariable ()
+    : m_nSamples (0),
+      m_next (0)
+{
+}
+
+void
+TraceRttRandomVariable::Build (void)
+{
+    if (m_file.empty()) {
+        BuildFromSummary();
+        return;
+    }
+
+    std::ifstream in (m_file.c_str());
+    if (!in.is_open()) {
+        NS_FATAL_ERROR ("Could not open RTT trace " << m_file);
+    }
+
+    std::vector<double> samples;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        /* ping prints "... time=61.9 ms"; other lines count only if they are just a number, in ms */
+        const char *start = line.c_str();
+        const char *time = strstr(start, "time=");
+        if (time) {
+            start = time + 5;
+        }
+        char *end;
+        double v = strtod(start, &end);
+        if (end == start || v < 0) {
+            continue;
+        }
+        if (!time) {
+            while (isspace((unsigned char)*end)) {
+                end++;
+            }
+            if (strncmp(end, "ms", 2) == 0) {
+                end += 2;
+            }
+            while (isspace((unsigned char)*end)) {
+                end++;
+            }
+            if (*end != '\0') {
+                continue;
+            }
+        }
+        samples.push_back(v);
+    }
+
+    if (samples.empty()) {
+        NS_FATAL_ERROR ("No RTT samples in " << m_file);
+    }
+    BuildFromSamples(samples);
+}
+
+void
+TraceRttRandomVariable::BuildFromSamples (std::vector<double> &samples)
+{
+    std::sort(samples.begin(), samples.end());
+    m_nSamples = samples.size();
+    m_table.resize(m_tableSize);
+
+    /* Empirical quantiles, interpolated between neighbouring order statistics. */
+    for (uint32_t i = 0; i < m_tableSize; i++) {
+        double pos = (double)i * (samples.size() - 1) / (m_tableSize - 1);
+        uint32_t lo = (uint32_t)pos;
+        uint32_t hi = std::min(lo + 1, (uint32_t)samples.size() - 1);
+        m_table[i] = samples[lo] + (samples[hi] - samples[lo]) * (pos - lo);
+    }
+
+    NS_LOG_DEBUG (m_file << ": " << m_nSamples << " samples, " << samples.front()
+                  << " to " << samples.back() << " ms");
+}
+
+void
+TraceRttRandomVariable::BuildFromSummary (void)
+{
+    if (m_mean <= 0) {
+        NS_FATAL_ERROR ("TraceRttRandomVariable needs either File or Mean");
+    }
+    m_nSamples = 0;
+    m_table.assign(m_tableSize, m_mean);
+
+    double excess = m_mean - m_min;
+    if (m_deviation <= 0 || excess <= 0) {
+        return;
+    }
+
+    /* Lognormal of (rtt - min) with the given mean and deviation. */
+    double sigma2 = log(1 + (m_deviation * m_deviation) / (excess * excess));
+    double sigma = sqrt(sigma2);
+    double mu = log(excess) - sigma2 / 2;
+    double max = m_max > m_min ? m_max : HUGE_VAL;
+
+    for (uint32_t i = 0; i < m_tableSize; i++) {
+        /* Pull the two ends in by half a step to keep them finite. */
+        double p = (double)i / (m_tableSize - 1);
+        p = std::max(0.5 / m_tableSize, std::min(1 - 0.5 / m_tableSize, p));
+        m_table[i] = std::min(m_min + exp(mu + sigma * normal_quantile(p)), max);
+    }
+}
+
+double
+TraceRttRandomVariable::Lookup (double u) const
+{
+    double pos = u * (m_table.size() - 1);
+    uint32_t i = (uint32_t)pos;
+    if (i >= m_table.size() - 1) {
+        return m_table.back();
+    }
+    return m_table[i] + (m_table[i + 1] - m_table[i]) * (pos - i);
+}
+
+void
+TraceRttRandomVariable::Refill (void)
+{
+    if (m_table.empty()) {
+        Build();
+    }
+    m_batch.resize(m_batchSize);
+    for (uint32_t i = 0; i < m_batchSize; i++) {
+        double u = Peek()->RandU01();
+        if (IsAntithetic()) {
+            u = 1 - u;
+        }
+        m_batch[i] = Lookup(u) * m_scale;
+    }
+    m_next = 0;
+}
+
+double
+TraceRttRandomVariable::GetValue (void)
+{
+    if (m_next >= m_batch.size()) {
+        Refill();
+    }
+    return m_batch[m_next++];
+}
+
+uint32_t
+TraceRttRandomVariable::GetInteger (void)
+{
+    return (uint32_t)(GetValue() + 0.5);
+}
+
+uint32_t
+TraceRttRandomVariable::GetNSamples (void) const
+{
+    return m_nSamples;
+}
+
+double
+TraceRttRandomVariable::GetQuantile (double p)
+{
+    if (m_table.empty()) {
+        Build();
+    }
+    return Lookup(std::max(0.0, std::min(1.0, p)));
+}
+
+void
+TraceRttRandomVariable::Flush (void)
+{
+    m_batch.clear();
+    m_next = 0;
+}
+
+}
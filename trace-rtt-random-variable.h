@@ -0,0 +1,68 @@
+#ifndef TRACE_RTT_RANDOM_VARIABLE_H
+#define TRACE_RTT_RANDOM_VARIABLE_H
+
+#include "ns3/random-variable-stream.h"
+
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * Delays drawn from a measured RTT distribution.
+ *
+ * The distribution comes from "File", one sample in milliseconds per line
+ * (plain numbers or ping output; lines starting with # are skipped). With
+ * no file it is fitted to "Min", "Max", "Mean" and "Deviation" as a
+ * lognormal shifted to start at Min and cut off at Max, which follows the
+ * long right tail of cellular RTTs far better than a bounded normal.
+ *
+ * Either way the distribution is reduced once to an inverse CDF table of
+ * "TableSize" steps, so a draw is one uniform and one interpolated table
+ * lookup. Values are produced "BatchSize" at a time and every value is
+ * multiplied by "Scale", e.g. 0.5 for a one-way delay from RTTs.
+ */
+class TraceRttRandomVariable : public RandomVariableStream
+{
+public:
+    static TypeId GetTypeId (void);
+
+    TraceRttRandomVariable ();
+
+    virtual double GetValue (void);
+    virtual uint32_t GetInteger (void);
+
+    /* Number of samples the table was built from; 0 if fitted to the summary. */
+    uint32_t GetNSamples (void) const;
+    /* Value at cumulative probability p, 0 <= p <= 1, before Scale. */
+    double GetQuantile (double p);
+    /* Drop values already drawn, e.g. after the stream was re-seeded. */
+    void Flush (void);
+
+private:
+    void Build (void);
+    void BuildFromSamples (std::vector<double> &samples);
+    void BuildFromSummary (void);
+    void Refill (void);
+    double Lookup (double u) const;
+
+    std::string m_file;
+    double m_min;
+    double m_max;
+    double m_mean;
+    double m_deviation;
+    double m_scale;
+    uint32_t m_tableSize;
+    uint32_t m_batchSize;
+
+    /* m_table[i] is the value at cumulative probability i / (size - 1). */
+    std::vector<double> m_table;
+    uint32_t m_nSamples;
+
+    std::vector<double> m_batch;
+    uint32_t m_next;
+};
+
+}
+
+#endif /* TRACE_RTT_RANDOM_VARIABLE_H */
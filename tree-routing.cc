@@ -0,0 +1,78 @@
+#include "tree-routing.h"
+
+#include "ns3/log.h"
+
+NS_LOG_COMPONENT_DEFINE ("TreeRouting");
+
+namespace ns3 {
+
+TreeRouting::TreeRouting (const TreeTopology &tree, uint32_t base, uint8_t segmentLength,
+                          const std::vector<uint32_t> &segmentIndex)
+    : m_tree (tree),
+      m_base (base),
+      m_segmentLength (segmentLength),
+      m_segmentIndex (segmentIndex),
+      m_routes (tree.GetN()),
+      m_nRoutes (0)
+{
+    std::vector<uint32_t> segments;
+    std::vector<Ipv4Prefix> prefixes;
+
+    for (uint32_t i = 0; i < tree.GetN(); i++) {
+        uint32_t first = tree.GetFirstChild(i);
+        for (uint32_t c = first; c < first + tree.GetNChildren(i); c++) {
+            segments.clear();
+            prefixes.clear();
+            CollectSegments(c, segments);
+            SummariseBlockSet(m_base, m_segmentLength, segments, prefixes);
+            for (std::vector<Ipv4Prefix>::const_iterator it = prefixes.begin(); it != prefixes.end(); ++it) {
+                Route r;
+                r.prefix = *it;
+                r.nextHop = c;
+                m_routes[i].push_back(r);
+            }
+        }
+        m_nRoutes += m_routes[i].size();
+    }
+
+    NS_LOG_DEBUG (m_nRoutes << " routes for " << tree.GetN() << " nodes");
+}
+
+void
+TreeRouting::CollectSegments (uint32_t node, std::vector<uint32_t> &out) const
+{
+    /* A subtree is a contiguous run of preorder positions. */
+    uint32_t first = m_tree.GetPreorder(node);
+    uint32_t last = first + m_tree.GetSubtreeSize(node);
+    for (uint32_t pos = first; pos < last; pos++) {
+        uint32_t segment = m_segmentIndex[m_tree.GetNodeAtPreorder(pos)];
+        if (segment != NO_SEGMENT) {
+            out.push_back(segment);
+        }
+    }
+}
+
+const std::vector<TreeRouting::Route> &
+TreeRouting::GetRoutes (uint32_t node) const
+{
+    return m_routes[node];
+}
+
+std::vector<Ipv4Prefix>
+TreeRouting::GetSubtreePrefixes (uint32_t node) const
+{
+    std::vector<uint32_t> segments;
+    std::vector<Ipv4Prefix> prefixes;
+
+    CollectSegments(node, segments);
+    SummariseBlockSet(m_base, m_segmentLength, segments, prefixes);
+    return prefixes;
+}
+
+uint32_t
+TreeRouting::GetNRoutes (void) const
+{
+    return m_nRoutes;
+}
+
+}
@@ -0,0 +1,59 @@
+#ifndef TREE_ROUTING_H
+#define TREE_ROUTING_H
+
+#include "tree-topology.h"
+#include "ipv4-prefix.h"
+
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * Next-hop tables for a TreeTopology whose nodes each own one equal sized
+ * segment subnet out of a common pool (base + index * segment size).
+ *
+ * Rather than one route per (node, descendant) pair, every node gets one
+ * route per child covering that child's whole subtree, summarised into
+ * the fewest aligned prefixes. All tables are built once in the
+ * constructor, so installing them is a single pass with no recursion.
+ */
+class TreeRouting
+{
+public:
+    /* segmentIndex value for nodes that own no segment (leaves). */
+    static const uint32_t NO_SEGMENT = 0xffffffff;
+
+    struct Route {
+        Ipv4Prefix prefix;
+        /* Tree node to forward to; always a child of the table's owner. */
+        uint32_t nextHop;
+    };
+
+    /**
+    * segmentIndex[i] is the pool index of node i's segment, or NO_SEGMENT;
+    * the pool starts at base and each segment is segmentLength bits long.
+    */
+    TreeRouting (const TreeTopology &tree, uint32_t base, uint8_t segmentLength,
+                 const std::vector<uint32_t> &segmentIndex);
+
+    /* Routes from node towards the segments of all its strict descendants. */
+    const std::vector<Route> &GetRoutes (uint32_t node) const;
+    /* Prefixes covering the segments of node and all its descendants. */
+    std::vector<Ipv4Prefix> GetSubtreePrefixes (uint32_t node) const;
+
+    uint32_t GetNRoutes (void) const;
+
+private:
+    void CollectSegments (uint32_t node, std::vector<uint32_t> &out) const;
+
+    const TreeTopology &m_tree;
+    uint32_t m_base;
+    uint8_t m_segmentLength;
+    std::vector<uint32_t> m_segmentIndex;
+    std::vector<std::vector<Route> > m_routes;
+    uint32_t m_nRoutes;
+};
+
+}
+
+#endif /* TREE_ROUTING_H */
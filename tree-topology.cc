@@ -0,0 +1,162 @@
+#include "tree-topology.h"
+
+#include "ns3/log.h"
+#include "ns3/fatal-error.h"
+
+NS_LOG_COMPONENT_DEFINE ("TreeTopology");
+
+namespace ns3 {
+
+TreeTopology::TreeTopology (uint32_t nNodes, uint32_t stride)
+    : m_nNodes (nNodes),
+      m_stride (stride),
+      m_height (0),
+      m_nLeaves (0),
+      m_parent (nNodes, -1),
+      m_nChildren (nNodes, 0),
+      m_depth (nNodes, 0),
+      m_preorder (nNodes, 0),
+      m_subtreeSize (nNodes, 1),
+      m_byPreorder (nNodes, 0)
+{
+    if (stride == 0) {
+        NS_FATAL_ERROR ("Tree stride must be at least 1");
+    }
+
+    /* Heap order puts every parent before its children, so one forward pass fills parent and depth. */
+    for (uint32_t i = 1; i < nNodes; i++) {
+        uint32_t p = (i - 1) / stride;
+        m_parent[i] = p;
+        m_nChildren[p]++;
+        m_depth[i] = m_depth[p] + 1;
+        if (m_depth[i] > m_height) {
+            m_height = m_depth[i];
+        }
+    }
+
+    /* ...and a backward pass accumulates subtree sizes. */
+    for (uint32_t i = nNodes; i-- > 1;) {
+        m_subtreeSize[m_parent[i]] += m_subtreeSize[i];
+    }
+
+    /* A child's preorder position follows its parent's, then its older siblings' subtrees. */
+    for (uint32_t i = 0; i < nNodes; i++) {
+        if (m_nChildren[i] == 0) {
+            m_nLeaves++;
+            continue;
+        }
+        uint32_t next = m_preorder[i] + 1;
+        uint32_t first = GetFirstChild(i);
+        for (uint32_t c = first; c < first + m_nChildren[i]; c++) {
+            m_preorder[c] = next;
+            next += m_subtreeSize[c];
+        }
+    }
+
+    for (uint32_t i = 0; i < nNodes; i++) {
+        m_byPreorder[m_preorder[i]] = i;
+    }
+
+    NS_LOG_DEBUG ("tree of " << nNodes << " nodes, stride " << stride
+                  << ": height " << m_height << ", " << m_nLeaves << " leaves");
+}
+
+uint32_t
+TreeTopology::GetN (void) const
+{
+    return m_nNodes;
+}
+
+uint32_t
+TreeTopology::GetStride (void) const
+{
+    return m_stride;
+}
+
+int32_t
+TreeTopology::GetParent (uint32_t node) const
+{
+    return m_parent[node];
+}
+
+uint32_t
+TreeTopology::GetFirstChild (uint32_t node) const
+{
+    return node * m_stride + 1;
+}
+
+uint32_t
+TreeTopology::GetNChildren (uint32_t node) const
+{
+    return m_nChildren[node];
+}
+
+bool
+TreeTopology::IsLeaf (uint32_t node) const
+{
+    return m_nChildren[node] == 0;
+}
+
+uint32_t
+TreeTopology::GetDepth (uint32_t node) const
+{
+    return m_depth[node];
+}
+
+uint32_t
+TreeTopology::GetHeight (void) const
+{
+    return m_height;
+}
+
+uint32_t
+TreeTopology::GetNLeaves (void) const
+{
+    return m_nLeaves;
+}
+
+uint32_t
+TreeTopology::GetPreorder (uint32_t node) const
+{
+    return m_preorder[node];
+}
+
+uint32_t
+TreeTopology::GetSubtreeSize (uint32_t node) const
+{
+    return m_subtreeSize[node];
+}
+
+uint32_t
+TreeTopology::GetNodeAtPreorder (uint32_t position) const
+{
+    return m_byPreorder[position];
+}
+
+bool
+TreeTopology::IsInSubtree (uint32_t node, uint32_t descendant) const
+{
+    uint32_t pos = m_preorder[descendant];
+    return pos >= m_preorder[node] && pos < m_preorder[node] + m_subtreeSize[node];
+}
+
+uint32_t
+TreeTopology::GetChildToward (uint32_t node, uint32_t descendant) const
+{
+    /* Children's preorder ranges are consecutive, so find the last child starting at or before descendant. */
+    uint32_t pos = m_preorder[descendant];
+    uint32_t lo = GetFirstChild(node);
+    uint32_t hi = lo + m_nChildren[node] - 1;
+
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo + 1) / 2;
+        if (m_preorder[mid] <= pos) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
+}
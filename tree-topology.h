@@ -0,0 +1,69 @@
+#ifndef TREE_TOPOLOGY_H
+#define TREE_TOPOLOGY_H
+
+#include <stdint.h>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * A k-ary tree of n nodes in heap order: node 0 is the root and the
+ * children of node i are i*k+1 .. i*k+k (those below n).
+ *
+ * Everything is computed once in the constructor into flat arrays using
+ * integer arithmetic only, so building a tree is O(n) and every query
+ * below is O(1) except GetChildToward, which is O(log k).
+ *
+ * Nodes are also numbered in depth-first preorder, which makes every
+ * subtree a contiguous range [GetPreorder(i), GetPreorder(i) +
+ * GetSubtreeSize(i)) of preorder positions.
+ */
+class TreeTopology
+{
+public:
+    TreeTopology (uint32_t nNodes, uint32_t stride);
+
+    uint32_t GetN (void) const;
+    uint32_t GetStride (void) const;
+
+    /* Parent of node, or -1 for the root. */
+    int32_t GetParent (uint32_t node) const;
+    /* node*stride+1; may be >= GetN() when the node has no children. */
+    uint32_t GetFirstChild (uint32_t node) const;
+    uint32_t GetNChildren (uint32_t node) const;
+    bool IsLeaf (uint32_t node) const;
+
+    /* Depth of node (root is 0) and of the deepest node. */
+    uint32_t GetDepth (uint32_t node) const;
+    uint32_t GetHeight (void) const;
+    uint32_t GetNLeaves (void) const;
+
+    uint32_t GetPreorder (uint32_t node) const;
+    uint32_t GetSubtreeSize (uint32_t node) const;
+    uint32_t GetNodeAtPreorder (uint32_t position) const;
+
+    /* True if descendant is in the subtree rooted at node (inclusive). */
+    bool IsInSubtree (uint32_t node, uint32_t descendant) const;
+    /**
+    * The child of node whose subtree contains descendant, i.e. the next
+    * hop from node towards it. descendant must be a strict descendant.
+    */
+    uint32_t GetChildToward (uint32_t node, uint32_t descendant) const;
+
+private:
+    uint32_t m_nNodes;
+    uint32_t m_stride;
+    uint32_t m_height;
+    uint32_t m_nLeaves;
+
+    std::vector<int32_t> m_parent;
+    std::vector<uint32_t> m_nChildren;
+    std::vector<uint32_t> m_depth;
+    std::vector<uint32_t> m_preorder;
+    std::vector<uint32_t> m_subtreeSize;
+    std::vector<uint32_t> m_byPreorder;
+};
+
+}
+
+#endif /* TREE_TOPOLOGY_H */